@@ -0,0 +1,386 @@
+#include "../include/Seam_Carving_Sequential.h"
+#include "../include/Seam_Carving_Parallel.h"
+#include "../include/Seam_Carving_Engine.h"
+
+#include <time.h>
+
+// Per-stage timings of both back ends on synthetic images, written as CSV or JSON
+
+#define BENCH_MAX_SIZES 16
+#define BENCH_MAX_THREADS 16
+#define BENCH_CARVE_SEAMS 32
+#define BENCH_PYRAMID_LEVELS 2
+
+typedef enum {
+    STAGE_WRITE,
+    STAGE_READ,
+    STAGE_STREAM,
+    STAGE_ENERGY,
+    STAGE_DP,
+    STAGE_BACKTRACK,
+    STAGE_SEAM,
+    STAGE_FUSED,
+    STAGE_FORWARD,
+    STAGE_PYRAMID,
+    STAGE_REMOVAL,
+    STAGE_CARVE,
+    STAGE_COUNT
+} bench_stage;
+
+static const char* stage_names[STAGE_COUNT] = { "write", "read", "stream", "energy", "dp", "backtrack", "seam", "fused", "forward", "pyramid", "removal", "carve" };
+
+typedef struct {
+    int width;
+    int height;
+} bench_size;
+
+typedef struct {
+    bench_size sizes[BENCH_MAX_SIZES];
+    int size_count;
+    int channels[3];
+    int channel_count;
+    int threads[BENCH_MAX_THREADS];
+    int thread_count;
+    int repetitions;
+    int json;
+    const char* output;
+    const char* scratch_file;
+} bench_config;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Smooth gradients with a few hard edges and some noise, so seams have something to avoid
+static unsigned char* generate_image(int width, int height, int channels) {
+    unsigned char* image_data = malloc((size_t)width * height * channels);
+    if (!image_data)
+        return NULL;
+
+    unsigned int state = 12345u;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            state = state * 1664525u + 1013904223u;
+            int noise = (state >> 24) & 15;
+            int band = ((x / 97) + (y / 61)) & 1 ? 80 : 0;
+            for (int c = 0; c < channels; c++) {
+                int value = (x * (c + 1) * 255 / width + y * 255 / height) / 2 + band + noise;
+                image_data[((size_t)y * width + x) * channels + c] = (unsigned char)(c == 3 ? 255 : value);
+            }
+        }
+    }
+
+    return image_data;
+}
+
+// Times one configuration; samples[stage] gets one entry per repetition
+static int run_configuration(const bench_config* config, int width, int height, int channels, carve_mode mode, double samples[STAGE_COUNT][64]) {
+    int parallel = mode == CARVE_MODE_PARALLEL;
+    size_t cells = (size_t)width * height;
+    unsigned char* image_data = generate_image(width, height, channels);
+    unsigned char* scratch = malloc(cells * channels);
+    unsigned char* energy_map = malloc(cells);
+    unsigned char* energy_row = malloc(width);
+    int* dp = malloc(cells * sizeof(int));
+    signed char* backtrack = malloc(cells);
+    uint32_t* cost_rows = malloc(2 * (size_t)width * sizeof(uint32_t));
+    unsigned char* steps = malloc((size_t)height * SEAM_STEP_ROW_BYTES(width));
+    int* seam = malloc(height * sizeof(int));
+    void* pyramid_workspace = malloc(seam_pyramid_bytes(width, height, BENCH_PYRAMID_LEVELS, PYRAMID_DEFAULT_BAND));
+    // Reused across repetitions, so only the first carve pays for its working memory
+    seam_carver carver;
+    seam_carver_init(&carver);
+    int status = -1;
+    if (!image_data || !scratch || !energy_map || !energy_row || !dp || !backtrack || !cost_rows || !steps || !seam || !pyramid_workspace)
+        goto cleanup;
+
+    for (int r = 0; r < config->repetitions; r++) {
+        double start;
+
+        start = now_seconds();
+        if (parallel)
+            write_png_parallel(config->scratch_file, image_data, width, height, channels);
+        else
+            write_png_sequential(config->scratch_file, image_data, width, height, channels);
+        samples[STAGE_WRITE][r] = now_seconds() - start;
+
+        int read_width, read_height, read_channels;
+        start = now_seconds();
+        unsigned char* decoded = parallel
+            ? read_png_parallel(config->scratch_file, &read_width, &read_height, &read_channels)
+            : read_png_sequential(config->scratch_file, &read_width, &read_height, &read_channels);
+        samples[STAGE_READ][r] = now_seconds() - start;
+        if (!decoded)
+            goto cleanup;
+        free(decoded);
+
+        // Decode with the energy map computed as the rows arrive
+        unsigned char* streamed;
+        unsigned char* streamed_energy;
+        start = now_seconds();
+        int stream_status = parallel
+            ? read_png_streaming_parallel(config->scratch_file, &streamed, &streamed_energy, &read_width, &read_height, &read_channels)
+            : read_png_streaming_sequential(config->scratch_file, &streamed, &streamed_energy, &read_width, &read_height, &read_channels);
+        samples[STAGE_STREAM][r] = now_seconds() - start;
+        if (stream_status != 0)
+            goto cleanup;
+        free(streamed);
+        free(streamed_energy);
+
+        start = now_seconds();
+        if (parallel)
+            compute_energy_map_parallel(image_data, width, height, channels, energy_map);
+        else
+            compute_energy_map_sequential(image_data, width, height, channels, energy_map);
+        samples[STAGE_ENERGY][r] = now_seconds() - start;
+
+        start = now_seconds();
+        if (parallel)
+            compute_seam_table_parallel(energy_map, width, height, dp, backtrack);
+        else
+            compute_seam_table_sequential(energy_map, width, height, dp, backtrack);
+        samples[STAGE_DP][r] = now_seconds() - start;
+
+        start = now_seconds();
+        if (parallel)
+            trace_seam_parallel(dp, backtrack, width, height, seam);
+        else
+            trace_seam_sequential(dp, backtrack, width, height, seam);
+        samples[STAGE_BACKTRACK][r] = now_seconds() - start;
+
+        // DP and backtrack again, with rolling cost rows and packed steps instead of the full table
+        start = now_seconds();
+        if (parallel)
+            compute_seam_compact_parallel(energy_map, width, height, cost_rows, steps, seam);
+        else
+            compute_seam_compact_sequential(energy_map, width, height, cost_rows, steps, seam);
+        samples[STAGE_SEAM][r] = now_seconds() - start;
+
+        // Energy and seam search in one pass over the image, without the energy map
+        start = now_seconds();
+        if (parallel)
+            compute_seam_fused_parallel(image_data, width, height, channels, energy_row, cost_rows, steps, seam);
+        else
+            compute_seam_fused_sequential(image_data, width, height, channels, energy_row, cost_rows, steps, seam);
+        samples[STAGE_FUSED][r] = now_seconds() - start;
+
+        // Seam search under forward energy, also straight from the image
+        start = now_seconds();
+        if (parallel)
+            compute_seam_forward_parallel(image_data, width, height, channels, cost_rows, steps, seam);
+        else
+            compute_seam_forward_sequential(image_data, width, height, channels, cost_rows, steps, seam);
+        samples[STAGE_FORWARD][r] = now_seconds() - start;
+
+        // Approximate seam, coarse-to-fine
+        start = now_seconds();
+        if (parallel)
+            compute_seam_pyramid_parallel(energy_map, width, height, BENCH_PYRAMID_LEVELS, PYRAMID_DEFAULT_BAND, pyramid_workspace, seam);
+        else
+            compute_seam_pyramid_sequential(energy_map, width, height, BENCH_PYRAMID_LEVELS, PYRAMID_DEFAULT_BAND, pyramid_workspace, seam);
+        samples[STAGE_PYRAMID][r] = now_seconds() - start;
+
+        start = now_seconds();
+        if (parallel)
+            remove_seam_parallel(image_data, scratch, width, height, channels, seam);
+        else
+            remove_seam_sequential(image_data, scratch, width, height, channels, seam);
+        samples[STAGE_REMOVAL][r] = now_seconds() - start;
+
+        // End to end through the engine, so the incremental energy and table paths are covered too
+        unsigned char* carved = malloc(cells * channels);
+        if (!carved)
+            goto cleanup;
+        memcpy(carved, image_data, cells * channels);
+        int carved_width = width;
+        carve_options options;
+        carve_options_init(&options, mode);
+        options.carver = &carver;
+        start = now_seconds();
+        int carve_status = carve_seams(&carved, &carved_width, height, channels, BENCH_CARVE_SEAMS, &options);
+        samples[STAGE_CARVE][r] = now_seconds() - start;
+        free(carved);
+        if (carve_status != 0)
+            goto cleanup;
+    }
+    status = 0;
+
+cleanup:
+    free(image_data);
+    free(scratch);
+    free(energy_map);
+    free(energy_row);
+    free(dp);
+    free(backtrack);
+    free(cost_rows);
+    free(steps);
+    free(seam);
+    free(pyramid_workspace);
+    seam_carver_free(&carver);
+    return status;
+}
+
+static void print_header(FILE* out, const bench_config* config) {
+    if (config->json)
+        fprintf(out, "[\n");
+    else
+        fprintf(out, "width,height,channels,mode,threads,stage,median_ms,min_ms\n");
+}
+
+// One record per stage: median and best of the repetitions
+static void print_results(FILE* out, const bench_config* config, int width, int height, int channels, carve_mode mode, int threads, double samples[STAGE_COUNT][64], int* first) {
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        double* values = samples[stage];
+        qsort(values, config->repetitions, sizeof(double), compare_doubles);
+        double median = values[config->repetitions / 2] * 1000;
+        double best = values[0] * 1000;
+        const char* mode_name = mode == CARVE_MODE_PARALLEL ? "parallel" : "sequential";
+
+        if (config->json) {
+            fprintf(out, "%s  {\"width\": %d, \"height\": %d, \"channels\": %d, \"mode\": \"%s\", \"threads\": %d, "
+                         "\"stage\": \"%s\", \"median_ms\": %.3f, \"min_ms\": %.3f}",
+                    *first ? "" : ",\n", width, height, channels, mode_name, threads, stage_names[stage], median, best);
+        } else {
+            fprintf(out, "%d,%d,%d,%s,%d,%s,%.3f,%.3f\n", width, height, channels, mode_name, threads, stage_names[stage], median, best);
+        }
+        *first = 0;
+    }
+    fflush(out);
+}
+
+// Parses "a,b,c" into at most max integers; returns the count
+static int parse_int_list(const char* text, int* values, int max) {
+    int count = 0;
+    while (*text && count < max) {
+        values[count++] = atoi(text);
+        const char* comma = strchr(text, ',');
+        if (!comma)
+            break;
+        text = comma + 1;
+    }
+    return count;
+}
+
+// Parses "WxH,WxH,..." into the size list; returns the count
+static int parse_sizes(const char* text, bench_size* sizes, int max) {
+    int count = 0;
+    while (*text && count < max) {
+        if (sscanf(text, "%dx%d", &sizes[count].width, &sizes[count].height) == 2 && sizes[count].width > 1 && sizes[count].height > 0)
+            count++;
+        const char* comma = strchr(text, ',');
+        if (!comma)
+            break;
+        text = comma + 1;
+    }
+    return count;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --sizes WxH,...     image sizes (default: 512x512,1920x1080,3840x2160,7680x4320)\n"
+        "  --channels 1,3,4    channel counts (default: 1,3,4)\n"
+        "  --threads 1,2,4     thread counts swept for the parallel back end (default: 1 up to the core count)\n"
+        "  --repetitions N     runs per configuration (default: 3)\n"
+        "  --format csv|json   output format (default: csv)\n"
+        "  --output FILE       write results to FILE instead of stdout\n"
+        "  --scratch FILE      PNG used for the write/read stages (default: bench_scratch.png)\n",
+        program);
+}
+
+int main(int argc, char** argv) {
+    bench_config config = {
+        .sizes = { { 512, 512 }, { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } },
+        .size_count = 4,
+        .channels = { 1, 3, 4 },
+        .channel_count = 3,
+        .repetitions = 3,
+        .scratch_file = "bench_scratch.png",
+    };
+
+    // Powers of two up to the core count, then the core count itself
+    int cores = omp_get_num_procs();
+    for (int t = 1; t < cores && config.thread_count < BENCH_MAX_THREADS - 1; t *= 2)
+        config.threads[config.thread_count++] = t;
+    config.threads[config.thread_count++] = cores;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+
+        if (strcmp(arg, "--sizes") == 0 && has_value)
+            config.size_count = parse_sizes(argv[++i], config.sizes, BENCH_MAX_SIZES);
+        else if (strcmp(arg, "--channels") == 0 && has_value)
+            config.channel_count = parse_int_list(argv[++i], config.channels, 3);
+        else if (strcmp(arg, "--threads") == 0 && has_value)
+            config.thread_count = parse_int_list(argv[++i], config.threads, BENCH_MAX_THREADS);
+        else if (strcmp(arg, "--repetitions") == 0 && has_value)
+            config.repetitions = atoi(argv[++i]);
+        else if (strcmp(arg, "--format") == 0 && has_value)
+            config.json = strcmp(argv[++i], "json") == 0;
+        else if (strcmp(arg, "--output") == 0 && has_value)
+            config.output = argv[++i];
+        else if (strcmp(arg, "--scratch") == 0 && has_value)
+            config.scratch_file = argv[++i];
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (config.repetitions < 1 || config.repetitions > 64 || config.size_count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = config.output ? fopen(config.output, "w") : stdout;
+    if (!out) {
+        perror(config.output);
+        return 1;
+    }
+
+    fprintf(stderr, "Energy kernel: %s\n", energy_kernel_name());
+    print_header(out, &config);
+
+    static double samples[STAGE_COUNT][64];
+    int first = 1, status = 0;
+    for (int s = 0; s < config.size_count && status == 0; s++) {
+        int width = config.sizes[s].width, height = config.sizes[s].height;
+        for (int c = 0; c < config.channel_count && status == 0; c++) {
+            int channels = config.channels[c];
+
+            fprintf(stderr, "%dx%d, %d channels: sequential\n", width, height, channels);
+            omp_set_num_threads(1);
+            status = run_configuration(&config, width, height, channels, CARVE_MODE_SEQUENTIAL, samples);
+            if (status == 0)
+                print_results(out, &config, width, height, channels, CARVE_MODE_SEQUENTIAL, 1, samples, &first);
+
+            for (int t = 0; t < config.thread_count && status == 0; t++) {
+                fprintf(stderr, "%dx%d, %d channels: parallel, %d threads\n", width, height, channels, config.threads[t]);
+                omp_set_num_threads(config.threads[t]);
+                status = run_configuration(&config, width, height, channels, CARVE_MODE_PARALLEL, samples);
+                if (status == 0)
+                    print_results(out, &config, width, height, channels, CARVE_MODE_PARALLEL, config.threads[t], samples, &first);
+            }
+        }
+    }
+
+    if (config.json)
+        fprintf(out, "\n]\n");
+    if (config.output)
+        fclose(out);
+    remove(config.scratch_file);
+
+    if (status != 0) {
+        fprintf(stderr, "Benchmark failed.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "../include/Seam_Carving_Service.h"
+
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+// Closed-loop load generator for --serve: every client sends its next request as soon as the previous one is
+// answered, one connection per request, and the latencies are reported as percentiles
+
+#define LOAD_DEFAULT_CLIENTS 8
+#define LOAD_DEFAULT_REQUESTS 400
+#define LOAD_DEFAULT_WARMUP 16
+
+typedef struct {
+    const char* socket_path;
+    unsigned char* png_data;        // The input file, sent with every request unless by_path
+    size_t png_size;
+    char input_path[PATH_MAX];      // Absolute, since the service resolves paths in its own directory
+    int by_path;
+    int target_width;
+    int target_height;
+    char output_dir[PATH_MAX];      // When set the service writes the results here instead of sending them back
+    int clients;
+    int requests;
+    int warmup;
+} load_config;
+
+typedef struct {
+    const load_config* config;
+    int id;
+    double* latencies;              // Indexed by request; client c sends requests c, c + clients, ...
+    int failures;
+    size_t bytes_received;
+} load_client;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Nearest-rank percentile of an ascending array
+static double percentile(const double* sorted, int count, double fraction) {
+    int rank = (int)ceil(fraction * count);
+    return sorted[(rank > 0 ? rank : 1) - 1];
+}
+
+// Sends one request and waits for the whole response; returns 0 if the service carved the image
+static int send_one(const load_config* config, int client, int index, size_t* bytes_received) {
+    int fd = service_connect(config->socket_path);
+    if (fd < 0)
+        return -1;
+
+    char output_path[PATH_MAX + 64];
+    const char* output = NULL;
+    if (config->output_dir[0]) {
+        snprintf(output_path, sizeof(output_path), "%s/load_%d_%d.png", config->output_dir, client, index);
+        output = output_path;
+    }
+
+    int status = config->by_path
+        ? service_send_request(fd, SERVICE_INPUT_PATH, config->input_path, strlen(config->input_path), config->target_width, config->target_height, output)
+        : service_send_request(fd, SERVICE_INPUT_PNG, config->png_data, config->png_size, config->target_width, config->target_height, output);
+
+    service_response response;
+    unsigned char* payload = NULL;
+    if (status == 0)
+        status = service_read_response(fd, &response, &payload);
+    if (status == 0 && response.status != 0) {
+        fprintf(stderr, "Request failed: %.*s\n", (int)response.length, payload ? (const char*)payload : "");
+        status = -1;
+    } else if (status == 0) {
+        *bytes_received += response.length;
+    } else {
+        fprintf(stderr, "No response to request %d\n", index);
+    }
+
+    free(payload);
+    close(fd);
+    return status;
+}
+
+static void* run_client(void* arg) {
+    load_client* client = arg;
+    const load_config* config = client->config;
+
+    for (int i = client->id; i < config->requests; i += config->clients) {
+        double start = now_seconds();
+        if (send_one(config, client->id, i, &client->bytes_received) != 0)
+            client->failures++;
+        client->latencies[i] = now_seconds() - start;
+    }
+    return NULL;
+}
+
+static unsigned char* read_file(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+
+    unsigned char* data = NULL;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        long length = ftell(fp);
+        data = length > 0 ? malloc(length) : NULL;
+        if (data && (fseek(fp, 0, SEEK_SET) != 0 || fread(data, 1, length, fp) != (size_t)length)) {
+            free(data);
+            data = NULL;
+        }
+        *size = data ? (size_t)length : 0;
+    }
+    fclose(fp);
+    if (!data)
+        fprintf(stderr, "Failed to read %s\n", path);
+    return data;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s --input FILE [options]\n"
+        "  --socket PATH       socket of the service (default: seam_carving.sock)\n"
+        "  --input FILE        PNG every request carves\n"
+        "  --by-path           send the file's path instead of its bytes\n"
+        "  --width W           target width (default: unchanged)\n"
+        "  --height H          target height (default: unchanged)\n"
+        "  --output-dir DIR    have the service write the results under DIR instead of sending them back\n"
+        "  --clients N         concurrent clients (default: %d)\n"
+        "  --requests N        measured requests (default: %d)\n"
+        "  --warmup N          requests sent one at a time first and left out of the results (default: %d)\n",
+        program, LOAD_DEFAULT_CLIENTS, LOAD_DEFAULT_REQUESTS, LOAD_DEFAULT_WARMUP);
+}
+
+int main(int argc, char** argv) {
+    load_config config = {
+        .socket_path = "seam_carving.sock",
+        .clients = LOAD_DEFAULT_CLIENTS,
+        .requests = LOAD_DEFAULT_REQUESTS,
+        .warmup = LOAD_DEFAULT_WARMUP,
+    };
+    const char* input = NULL;
+    const char* output_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+
+        if (strcmp(arg, "--socket") == 0 && has_value)
+            config.socket_path = argv[++i];
+        else if (strcmp(arg, "--input") == 0 && has_value)
+            input = argv[++i];
+        else if (strcmp(arg, "--by-path") == 0)
+            config.by_path = 1;
+        else if (strcmp(arg, "--width") == 0 && has_value)
+            config.target_width = atoi(argv[++i]);
+        else if (strcmp(arg, "--height") == 0 && has_value)
+            config.target_height = atoi(argv[++i]);
+        else if (strcmp(arg, "--output-dir") == 0 && has_value)
+            output_dir = argv[++i];
+        else if (strcmp(arg, "--clients") == 0 && has_value)
+            config.clients = atoi(argv[++i]);
+        else if (strcmp(arg, "--requests") == 0 && has_value)
+            config.requests = atoi(argv[++i]);
+        else if (strcmp(arg, "--warmup") == 0 && has_value)
+            config.warmup = atoi(argv[++i]);
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!input || config.clients < 1 || config.requests < 1 || config.warmup < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!realpath(input, config.input_path)) {
+        perror(input);
+        return 1;
+    }
+    if (output_dir && !realpath(output_dir, config.output_dir)) {
+        perror(output_dir);
+        return 1;
+    }
+    if (!config.by_path && !(config.png_data = read_file(input, &config.png_size)))
+        return 1;
+
+    size_t warmup_bytes = 0;
+    for (int i = 0; i < config.warmup; i++) {
+        if (send_one(&config, 0, config.requests + i, &warmup_bytes) != 0) {
+            fprintf(stderr, "Warm-up request failed; is the service running on %s?\n", config.socket_path);
+            free(config.png_data);
+            return 1;
+        }
+    }
+
+    double* latencies = malloc(config.requests * sizeof(double));
+    load_client* clients = calloc(config.clients, sizeof(load_client));
+    pthread_t* threads = malloc(config.clients * sizeof(pthread_t));
+    if (!latencies || !clients || !threads) {
+        perror("Allocation failed");
+        return 1;
+    }
+
+    double start = now_seconds();
+    int started = 0;
+    for (int c = 0; c < config.clients; c++) {
+        clients[c].config = &config;
+        clients[c].id = c;
+        clients[c].latencies = latencies;
+        if (pthread_create(&threads[c], NULL, run_client, &clients[c]) != 0) {
+            perror("pthread_create failed");
+            break;
+        }
+        started++;
+    }
+    for (int c = 0; c < started; c++)
+        pthread_join(threads[c], NULL);
+    double seconds = now_seconds() - start;
+
+    int failures = 0;
+    size_t bytes_received = 0;
+    for (int c = 0; c < started; c++) {
+        failures += clients[c].failures;
+        bytes_received += clients[c].bytes_received;
+    }
+    int sent = started == config.clients ? config.requests : 0;
+    if (sent > 0)
+        qsort(latencies, sent, sizeof(double), compare_doubles);
+
+    printf("Requests: %d (%d failed) from %d clients, %s, %.1f MB received\n", sent, failures, config.clients,
+           config.by_path ? "by path" : "inline", bytes_received / 1048576.0);
+    printf("Throughput: %.1f requests/sec over %.2f seconds\n", seconds > 0 ? sent / seconds : 0.0, seconds);
+    if (sent > 0)
+        printf("Latency: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", percentile(latencies, sent, 0.50) * 1000,
+               percentile(latencies, sent, 0.90) * 1000, percentile(latencies, sent, 0.99) * 1000, latencies[sent - 1] * 1000);
+
+    free(latencies);
+    free(clients);
+    free(threads);
+    free(config.png_data);
+    return failures == 0 && sent > 0 ? 0 : 1;
+}
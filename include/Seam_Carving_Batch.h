@@ -0,0 +1,54 @@
+#ifndef SEAM_CARVING_BATCH_H
+#define SEAM_CARVING_BATCH_H
+
+#include "Seam_Carving_Engine.h"
+#include "Seam_Carving_Seam_Map.h"
+
+// Images with at least this many pixels are carved one at a time by the whole thread team
+#define BATCH_LARGE_IMAGE_PIXELS (2 * 1024 * 1024)
+
+// Bytes of a PNG up to the end of the width and height in its IHDR chunk
+#define PNG_HEADER_BYTES 24
+
+typedef struct {
+    const char* output_dir;
+    int target_width;               // Width every output is carved to; 0 to remove a fixed seam count instead
+    int seams;                      // Seams removed per image when target_width is 0
+    int seams_per_pass;
+    int incremental_seams;          // Keep the seam DP table (see carve_options); 0 searches in rolling rows
+    int pyramid_levels;             // Coarse-to-fine seam search (see carve_options); 0 is exact
+    int pyramid_band;
+    int forward_energy;             // Forward-energy seam costs (see carve_options)
+    int fused_energy;               // Compute energy inside the rolling-row search (see carve_options)
+    long large_image_pixels;
+    const int* widths;              // When set, every width is cut from one seam map instead of carving each
+    int width_count;
+    int map_min_width;              // Narrowest width the seam maps cover; 0 for the narrowest requested width
+} batch_options;
+
+void batch_options_init(batch_options* options);
+
+typedef struct {
+    int images;
+    int failures;                   // Includes inputs not carved because an earlier input has the same file name
+    int skipped;                    // Inputs already no wider than every requested width, left alone
+    double seconds;                 // Wall-clock time of the whole batch
+    double p50_latency;             // Per-image wall-clock latency percentiles, in seconds
+    double p99_latency;
+} batch_report;
+
+// Expands the inputs (PNG files or directories of PNG files) into a list of paths; returns the count or -1
+int collect_batch_inputs(char** inputs, int input_count, char*** paths);
+
+void free_batch_inputs(char** paths, int count);
+
+// Width times height from the header of a PNG file, or of a PNG in memory; 0 if it is not a PNG
+long png_pixel_count(const char* path);
+
+long png_header_pixel_count(const unsigned char* png_data, size_t size);
+
+// Carves every image and writes it under output_dir with the same file name; returns 0 if all succeeded.
+// Of several inputs with the same file name only the first given is carved, since the outputs would collide.
+int run_batch(char** paths, int count, const batch_options* options, batch_report* report);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SEAM_CARVING_ENGINE_H
+#define SEAM_CARVING_ENGINE_H
+
+#include "Seam_Carving_Sequential.h"
+#include "Seam_Carving_Parallel.h"
+#include "Seam_Carving_Overlay.h"
+#include "Seam_Carving_Writer.h"
+#include "Seam_Carving_Workspace.h"
+#include "Seam_Carving_Lazy.h"
+#include "Seam_Carving_Pyramid.h"
+#include "Seam_Carving_Stream.h"
+
+typedef enum {
+    CARVE_MODE_PARALLEL = 1,
+    CARVE_MODE_SEQUENTIAL = 2
+} carve_mode;
+
+// Working memory of the engine. Every buffer grows to the largest image it has seen and stays, so a carver
+// kept per thread and passed through carve_options carves image after image without allocating.
+typedef struct {
+    seam_buffer stage;              // Energy maps, seam tables and seam lists; every stage lays it out afresh
+    seam_buffer image_scratch;      // Second image buffer for ping-pong removal and transposes
+    seam_buffer origin_index;       // Original pixel indices, only while seams are logged
+    seam_buffer origin_scratch;
+    seam_buffer lazy;               // Energy plane and surviving-column sets of lazy removal
+} seam_carver;
+
+void seam_carver_init(seam_carver* carver);
+
+void seam_carver_free(seam_carver* carver);
+
+typedef struct {
+    carve_mode mode;
+    int save_intermediate;          // Write every intermediate output as PNG; a failed write fails the carve
+    int incremental_energy;         // Patch the energy map around each removed seam instead of recomputing it
+    int incremental_seams;          // Keep the seam DP table (5 bytes per pixel) and refresh only the cone below each
+                                    // removed seam; 0 searches each seam in rolling rows with 2-bit steps instead
+    int seams_per_pass;             // Disjoint seams taken from each DP pass; 1 is exact one-by-one carving
+    int pyramid_levels;             // With one seam per pass, search each seam coarse-to-fine over this many halvings
+                                    // instead of exactly (takes the place of incremental_seams); 0 is exact
+    int pyramid_band;               // Columns the pyramid refinement searches on each side of the coarse seam
+    int fused_energy;               // Without the table or pyramid, compute each energy row inside the seam search
+                                    // instead of keeping an energy map (incremental_energy is then unused)
+    int forward_energy;             // With one seam per pass, cost seams by the edges their removal creates (forward
+                                    // energy) inside the rolling-row search; replaces the energy map, table and pyramid
+    int lazy_removal;               // Carve only the channel the energy reads and gather the pixels once at the end
+    const int* seam_prior;          // With one seam per pass, search seam i of carve_seams only within prior_band
+                                    // columns of seam_prior[i * height] instead of across the whole width; takes
+                                    // the place of the table, pyramid, fused and forward searches
+    int prior_band;
+    int* seam_history;              // When set, carve_seams stores seam i at seam_history[i * height], in the
+                                    // columns of the image it was removed from, ready to be the next seam_prior
+    const char* output_dir;
+    png_writer* writer;             // When set, intermediate outputs are encoded on background threads
+    png_write_settings intermediate_settings;
+    seam_log* recorded_seams;       // When set, every seam is logged in input coordinates for the overlay
+    seam_carver* carver;            // Working memory to reuse; NULL gives every call a temporary one
+    const unsigned char* initial_energy;    // Energy map of the input, e.g. from a streaming reader, used by the first
+                                            // pass of carve_seams instead of computing it; NULL computes it
+} carve_options;
+
+void carve_options_init(carve_options* options, carve_mode mode);
+
+// Removes `iterations` vertical seams from the decoded image without any PNG round-trips.
+// The result is left in the caller's buffer, which is never reallocated.
+int carve_seams(unsigned char** image_data, int* width, int height, int channels, int iterations, const carve_options* options);
+
+// Carves the image to target_width x target_height, interleaving vertical and horizontal seams.
+// The result is left in the caller's buffer like carve_seams; *width and *height are updated.
+int carve_to_size(unsigned char** image_data, int* width, int* height, int channels, int target_width, int target_height, const carve_options* options);
+
+// Inserts `seams` vertical seams (content-aware enlargement); *image_data is replaced by the wider buffer.
+// The seams are disjoint and connected in the input, so past about half the width they can run out; enlarge
+// in steps instead.
+int enlarge_seams(unsigned char** image_data, int* width, int height, int channels, int seams, const carve_options* options);
+
+#endif
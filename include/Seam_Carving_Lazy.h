@@ -0,0 +1,41 @@
+#ifndef SEAM_CARVING_LAZY_H
+#define SEAM_CARVING_LAZY_H
+
+#include <stdint.h>
+#include "Seam_Carving_Sequential.h"
+#include "Seam_Carving_Parallel.h"
+
+// Columns covered by one alive mask
+#define LAZY_BLOCK_COLUMNS 64
+
+// Masks (and Fenwick nodes) per row of an image width columns wide
+#define LAZY_BLOCKS(width) (((width) + LAZY_BLOCK_COLUMNS - 1) / LAZY_BLOCK_COLUMNS)
+
+// Which original columns of every row are still in the image. Each row is split into 64-column blocks with
+// a mask of surviving columns, and a per-row Fenwick tree over the block counts finds the x-th surviving
+// column in O(log width), so removing a seam never moves pixel data.
+typedef struct {
+    uint64_t* alive;        // height * blocks masks; bit i of block b is original column b * 64 + i
+    int* counts;            // height * blocks Fenwick nodes over the number of surviving columns per block
+    int blocks;
+    int width;              // Original width
+    int height;
+} lazy_columns;
+
+// Starts with every column alive; alive and counts hold height * LAZY_BLOCKS(width) entries each
+void lazy_columns_init(lazy_columns* columns, uint64_t* alive, int* counts, int width, int height);
+
+// Original column of the x-th surviving column of row y
+int lazy_columns_original(const lazy_columns* columns, int y, int x);
+
+// Removes k seams given in current coordinates (seams[s * height + y]); originals receives the same seams in
+// original columns
+void lazy_columns_remove_seams(lazy_columns* columns, int* seams, int k, int* originals);
+
+// Copies the surviving pixels of the original image into the carved one; the buffers may be the same
+void gather_columns_sequential(const lazy_columns* columns, unsigned char* image_data, unsigned char* new_image_data, int channels);
+
+// Same gather, one row per iteration; the buffers must not overlap
+void gather_columns_parallel(const lazy_columns* columns, unsigned char* image_data, unsigned char* new_image_data, int channels);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SEAM_CARVING_OVERLAY_H
+#define SEAM_CARVING_OVERLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every carved or inserted seam in the coordinate frame of the input image, in the order it was taken
+typedef struct {
+    int* pixels;            // Original pixel index (y * width + x) of each seam pixel, seam after seam
+    size_t pixel_count;
+    size_t pixel_capacity;
+    size_t* offsets;        // Seam i occupies pixels[offsets[i]] .. pixels[offsets[i + 1] - 1]
+    int seam_count;
+    int seam_capacity;
+} seam_log;
+
+void seam_log_init(seam_log* log);
+
+void seam_log_free(seam_log* log);
+
+// Appends one seam given as original pixel indices; returns -1 when out of memory
+int seam_log_append(seam_log* log, const int* pixels, int length);
+
+// Paints every logged seam onto a copy of the original image, coloured from red (first) to yellow (last),
+// and writes it as a single PNG
+void write_seam_overlay(const char* filename, unsigned char* original, int width, int height, int channels, const seam_log* log);
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef SEAM_CARVING_PARALLEL_H
+#define SEAM_CARVING_PARALLEL_H
+
 
 #include <omp.h>
 #include <math.h>
@@ -5,6 +8,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <png.h>
+#include "Seam_Carving_SIMD.h"
+#include <limits.h>
+#include <stdint.h>
+
+// Rows narrower than this are not worth a thread team in the seam DP
+#define SEAM_PARALLEL_MIN_WIDTH 256
+
+// Columns that one thread of the rolling-row seam searches handles at a time (a multiple of four)
+#define SEAM_ROW_BLOCK_COLUMNS 256
 
 // Function to parallelize reading the PNG image
 unsigned char* read_png_parallel(const char* filename, int* width, int* height, int* channels);
@@ -13,9 +25,32 @@ void write_png_parallel(const char* filename, unsigned char* image_data, int wid
 
 void compute_energy_map_parallel(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_map);
 
-void compute_seam_parallel(unsigned char* energy_map, int width, int height, int* seam);
+void update_energy_map_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, unsigned char* energy_map, unsigned char* new_energy_map);
+
+void compute_seam_table_parallel(unsigned char* energy_map, int width, int height, int* dp, signed char* backtrack);
+
+void compute_masked_seam_table_parallel(unsigned char* energy_map, const unsigned char* taken, int width, int height, int* dp, signed char* backtrack);
+
+void trace_seam_parallel(int* dp, signed char* backtrack, int width, int height, int* seam);
+
+void update_seam_table_parallel(unsigned char* energy_map, int width, int height, int* seam, int* dp, signed char* backtrack, int* new_dp, signed char* new_backtrack);
+
+void compute_seam_compact_parallel(unsigned char* energy_map, int width, int height, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+void compute_seam_fused_parallel(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_row, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+void compute_seam_forward_parallel(unsigned char* image_data, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+int compute_seam_parallel(unsigned char* energy_map, int width, int height, int* seam);
+
+void transpose_image_parallel(unsigned char* image_data, unsigned char* transposed, int width, int height, int channels);
+
+void remove_seam_parallel(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seam);
+
+int remove_seams_parallel(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k);
 
-void highlight_seam_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename);
+int insert_seams_parallel(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k);
 
 void remove_and_save_seam_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename);
 
+#endif
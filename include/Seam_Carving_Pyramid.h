@@ -0,0 +1,41 @@
+#ifndef SEAM_CARVING_PYRAMID_H
+#define SEAM_CARVING_PYRAMID_H
+
+#include <stdint.h>
+#include "Seam_Carving_Sequential.h"
+#include "Seam_Carving_Parallel.h"
+#include "Seam_Carving_Workspace.h"
+
+// Columns searched on each side of the upsampled coarse seam when no band is given
+#define PYRAMID_DEFAULT_BAND 8
+
+// Levels stop halving before the coarsest energy map gets narrower than this
+#define PYRAMID_MIN_WIDTH 32
+
+// Upper bound on the levels of one pyramid
+#define PYRAMID_MAX_LEVELS 16
+
+// Coarse-to-fine seam search. The energy map is halved `levels` times, the seam is found
+// exactly at the coarsest level, and every finer level runs the DP only within `band` columns of the coarse
+// seam scaled up by two. The result is a near-optimal seam for roughly the cost of the downsampling.
+
+// Levels actually used for a width-wide map: at most `levels`, fewer if the coarsest map would be too narrow
+int seam_pyramid_levels(int width, int levels);
+
+// Bytes of working memory the pyramid search needs for a width x height energy map
+size_t seam_pyramid_bytes(int width, int height, int levels, int band);
+
+void compute_seam_pyramid_sequential(unsigned char* energy_map, int width, int height, int levels, int band, void* workspace, int* seam);
+
+void compute_seam_pyramid_parallel(unsigned char* energy_map, int width, int height, int levels, int band, void* workspace, int* seam);
+
+// Guided seam search: the same banded DP the pyramid refines with, run once around a guide seam of the map's
+// own size, e.g. the seam an earlier video frame removed at this width. The guide must be a connected seam
+// (at most one column of movement per row); the result is the cheapest seam within `band` columns of it.
+
+// Bytes of working memory the guided search needs for a map `height` rows tall
+size_t seam_guided_bytes(int height, int band);
+
+void compute_seam_guided(const unsigned char* energy_map, int width, int height, const int* guide, int band, void* workspace, int* seam);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SEAM_CARVING_SIMD_H
+#define SEAM_CARVING_SIMD_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Runs `call` with seam_channels bound to a literal 1, 3 or 4 when `channels` is one of those, so a kernel
+// inlined into it gets constant pixel strides the compiler can unroll and vectorise; other counts (2) keep
+// the runtime value
+#define SEAM_SPECIALIZE_CHANNELS(channels, call) \
+    do { \
+        switch (channels) { \
+        case 1: { enum { seam_channels = 1 }; call; break; } \
+        case 3: { enum { seam_channels = 3 }; call; break; } \
+        case 4: { enum { seam_channels = 4 }; call; break; } \
+        default: { const int seam_channels = (channels); call; break; } \
+        } \
+    } while (0)
+
+// Energy for `count` consecutive pixels; each pointer addresses the first output column in the row
+// above, the row itself and the row below, and the kernel reads one column past either end
+typedef void (*energy_span_fn)(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* out, int count);
+
+// Rolling-row seam DP for `count` columns: prev, energy and row address the first column, prev is read one
+// column past either end, and steps[x] receives the step + 1 (0 left, 1 straight up, 2 right) of row[x]
+typedef void (*seam_dp_span_fn)(const uint32_t* prev, const unsigned char* energy, uint32_t* row, unsigned char* steps, int count);
+
+// Forward-energy seam DP for `count` columns: above and current hold channel 0 of rows y - 1 and y from the
+// first column on, contiguously, and are read one column past either end like prev; steps as above
+typedef void (*seam_forward_span_fn)(const uint32_t* prev, const unsigned char* above, const unsigned char* current, uint32_t* row, unsigned char* steps, int count);
+
+// Name of the kernel chosen at startup ("scalar", "sse4.1", "avx2" or "avx512bw")
+const char* energy_kernel_name(void);
+
+// Energy of a single pixel with neighbours clamped to the image border
+unsigned char compute_energy_pixel(const unsigned char* image_data, int width, int height, int channels, int x, int y);
+
+// Seam DP over `count` columns that have a neighbour on both sides, through the widest kernel available
+// (AVX2 unless SEAM_ENERGY_KERNEL forces scalar or sse4.1)
+void seam_dp_span(const uint32_t* prev, const unsigned char* energy, uint32_t* row, unsigned char* steps, int count);
+
+// Forward-energy seam DP over `count` columns that have a neighbour on both sides, dispatched like seam_dp_span
+void seam_forward_span(const uint32_t* prev, const unsigned char* above, const unsigned char* current, uint32_t* row, unsigned char* steps, int count);
+
+// Copies channel 0 of `count` interleaved pixels into a contiguous plane, the only channel the energy reads
+void copy_channel0(const unsigned char* pixels, int channels, unsigned char* plane, int count);
+
+// Writes energy_row[x] for x in [x_begin, x_end) of row y, borders included
+void compute_energy_row(const unsigned char* image_data, int width, int height, int channels, int y, int x_begin, int x_end, unsigned char* energy_row);
+
+#endif
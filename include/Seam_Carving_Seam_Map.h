@@ -0,0 +1,53 @@
+#ifndef SEAM_CARVING_SEAM_MAP_H
+#define SEAM_CARVING_SEAM_MAP_H
+
+#include <stdint.h>
+#include "Seam_Carving_Engine.h"
+
+// Value of pixels that no recorded seam removed
+#define SEAM_MAP_KEPT 0xFFFF
+
+// Most seams a map can record, so that seam indices fit in 16 bits next to SEAM_MAP_KEPT
+#define SEAM_MAP_MAX_SEAMS 0xFFFF
+
+// Extension of map files stored next to the carved images
+#define SEAM_MAP_EXTENSION ".seams"
+
+// For every pixel of the source image, the seam that removed it when the image was carved once down to
+// width - seams. Removing the first n seams is exactly what carving n seams does, so any width in
+// [width - seams, width] comes out of a single filtering pass without energy or DP.
+typedef struct {
+    uint16_t* order;        // width * height seam indices (0 is the first seam), SEAM_MAP_KEPT if never removed
+    int width;
+    int height;
+    int seams;
+    int channels;
+    uint64_t source_hash;   // FNV-1a (64-bit) of the decoded pixels the seams were carved from
+    int seams_per_pass;     // Carve options that decide which seams are found; a map built with other
+    int pyramid_levels;     // options would give other images
+    int pyramid_band;
+    int forward_energy;
+} seam_map;
+
+// Carves a copy of the image down to min_width and records the removal order; the image is not modified
+int seam_map_build(seam_map* map, unsigned char* image_data, int width, int height, int channels, int min_width, const carve_options* options);
+
+void seam_map_free(seam_map* map);
+
+// Returns 1 if the map was built from exactly these pixels with carve options that find the same seams
+int seam_map_matches(const seam_map* map, const unsigned char* image_data, int width, int height, int channels, const carve_options* options);
+
+// File layout: the 8-byte magic "SEAMMAP2"; width, height, seams and channels as little-endian 32-bit
+// integers; the source hash as a little-endian 64-bit integer; seams per pass, pyramid levels, pyramid band
+// and forward energy as 32-bit integers; then width * height little-endian 16-bit seam indices row by row.
+// Both return 0 on success.
+int seam_map_write(const seam_map* map, const char* filename);
+
+int seam_map_read(seam_map* map, const char* filename);
+
+// Writes the source image retargeted to target_width into new_image_data (target_width * height pixels)
+int seam_map_retarget_sequential(const seam_map* map, const unsigned char* image_data, int channels, int target_width, unsigned char* new_image_data);
+
+int seam_map_retarget_parallel(const seam_map* map, const unsigned char* image_data, int channels, int target_width, unsigned char* new_image_data);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SEAM_CARVING_SEQUENCE_H
+#define SEAM_CARVING_SEQUENCE_H
+
+#include "Seam_Carving_Engine.h"
+
+// Mean absolute difference of channel 0 between consecutive frames (0-255) above which the frame is taken
+// for a new shot and its seams are searched over the whole width again
+#define SEQUENCE_SCENE_CHANGE 24.0
+
+// The scene-change test compares every this many rows and columns
+#define SEQUENCE_SCENE_STRIDE 4
+
+// Background encoder threads and frames queued for them
+#define SEQUENCE_WRITER_THREADS 2
+#define SEQUENCE_WRITER_QUEUE 4
+
+// Sequence mode: the inputs are the frames of one video, carved in order. Every frame searches seam i only
+// within `band` columns of the seam i the previous frame removed, which is much cheaper than a full search
+// and keeps the seams, and so the content, from jumping between frames. The first frame, frames of another
+// size, frames that differ from the previous one by more than scene_change and keyframes are searched exactly.
+// Frame N + 1 is decoded on its own thread while frame N is carved and frame N - 1 is encoded.
+typedef struct {
+    const char* output_dir;
+    int target_width;               // Width every frame is carved to; 0 to remove a fixed seam count instead
+    int seams;                      // Seams removed per frame when target_width is 0
+    int band;                       // Columns searched on each side of the previous frame's seam
+    double scene_change;            // Mean channel-0 difference that restarts the full search
+    int keyframe_interval;          // Also search every this many frames exactly, so the guided seams cannot drift
+                                    // ever further from the cheapest ones within a long shot; 0 never does
+    png_write_settings settings;    // Encoder settings of the carved frames
+} sequence_options;
+
+void sequence_options_init(sequence_options* options);
+
+typedef struct {
+    int frames;
+    int failures;
+    int full_searches;              // Frames carved without the previous frame's seams
+    double seconds;                 // Wall-clock time from the first decode to the last encoded frame
+} sequence_report;
+
+// Carves the frames in the given order and writes each under output_dir with its file name; returns 0 if
+// every frame succeeded
+int run_sequence(char** paths, int count, const sequence_options* options, sequence_report* report);
+
+#endif
@@ -1,21 +1,112 @@
+#ifndef SEAM_CARVING_SEQUENTIAL_H
+#define SEAM_CARVING_SEQUENTIAL_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <png.h>
+#include "Seam_Carving_SIMD.h"
+#include "Seam_Carving_Trace.h"
 #include <math.h>
 #include <dirent.h>
+#include <stdint.h>
+#include <limits.h>
+
+// Side of the square tiles used by the blocked transpose
+#define TRANSPOSE_TILE 32
+
+// Bytes per row of a packed step table: four 2-bit steps (step + 1) per byte
+#define SEAM_STEP_ROW_BYTES(width) (((size_t)(width) + 3) / 4)
+
+// Columns the rolling-row seam DP hands to the vector kernel at a time (a multiple of four)
+#define SEAM_DP_CHUNK 256
+
+// Multi-seam removal and insertion sort each row's seam columns on the stack up to this many seams and
+// allocate beyond it
+#define SEAM_COLUMNS_ON_STACK 64
 
 void delete_png_files_in_directory(const char* dir_path); 
 
 unsigned char* read_png_sequential(const char* filename, int* width, int* height, int* channels);
 
+// Encoder settings for one PNG output
+typedef struct {
+    int compression_level;          // zlib level 0-9, or -1 for the library default
+    int filters;                    // Mask of PNG_FILTER_* values, or -1 for the library default
+} png_write_settings;
+
+void png_write_settings_init(png_write_settings* settings);
+
+// PNG colour type of 8-bit pixels with 1 to 4 interleaved channels, or -1
+int png_color_type_for(int channels);
+
+// Rows of 1 to 4 channels are written as gray, gray + alpha, RGB or RGBA
+int write_png_rows(const char* filename, png_bytep* rows, int width, int height, int channels, const png_write_settings* settings);
+
+int write_png_with_settings(const char* filename, unsigned char* image_data, int width, int height, int channels, const png_write_settings* settings);
+
 void write_png_sequential(const char* filename, unsigned char* image_data, int width, int height, int channels);
 
 void compute_energy_map_sequential(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_map);
 
-void compute_seam_sequential(unsigned char* energy_map, int width, int height, int* seam);
+// Column range of row y whose energy must be recomputed after the seam is removed (width is the new width)
+void energy_update_band(int* seam, int width, int height, int y, int* x_begin, int* x_end);
+
+void update_energy_map_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, unsigned char* energy_map, unsigned char* new_energy_map);
+
+void compute_seam_table_sequential(unsigned char* energy_map, int width, int height, int* dp, signed char* backtrack);
+
+// Seam table in which every path avoids the taken pixels (width * height, nonzero where taken); a bottom-row
+// column no path reaches costs INT_MAX
+void compute_masked_seam_table_sequential(unsigned char* energy_map, const unsigned char* taken, int width, int height, int* dp, signed char* backtrack);
+
+void trace_seam_sequential(int* dp, signed char* backtrack, int width, int height, int* seam);
+
+// Refreshes the cells of a shifted table that the removed seam can affect
+void refresh_seam_table(unsigned char* energy_map, int width, int height, int* seam, int* dp, signed char* backtrack);
+
+void update_seam_table_sequential(unsigned char* energy_map, int width, int height, int* seam, int* dp, signed char* backtrack, int* new_dp, signed char* new_backtrack);
+
+// Bottom-row column a seam search starts from
+typedef struct {
+    int cost;
+    int x;
+} seam_start;
+
+int find_seams_sequential(int* dp, signed char* backtrack, int width, int height, int k, int* seams, unsigned char* used, seam_start* order);
+
+// Cheapest seam from two rolling cost rows (2 * width) and a packed step table (height * SEAM_STEP_ROW_BYTES)
+void compute_seam_compact_sequential(unsigned char* energy_map, int width, int height, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+// One row of the rolling-row DP over columns [x_begin, x_end); x_begin must be a multiple of four
+void seam_compact_row(const unsigned char* energy_row, int width, int y, uint32_t* cost_rows, unsigned char* steps, int x_begin, int x_end);
+
+void trace_packed_steps(unsigned char* steps, int width, int height, int x, int* seam);
+
+// Same search reading the image instead of an energy map; energy_row holds width bytes of scratch
+void compute_seam_fused_sequential(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_row, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+// Forward-energy rolling-row search on channel 0 of the image: removing a pixel costs the new edges it creates
+// (C_U between its left and right neighbours, plus C_L or C_R against the pixel above on a diagonal step)
+void compute_seam_forward_sequential(unsigned char* image_data, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+// One forward-energy row over columns [x_begin, x_end); x_begin must be a multiple of four
+void seam_forward_row(const unsigned char* image_data, int width, int channels, int y, uint32_t* cost_rows, unsigned char* steps, int x_begin, int x_end);
+
+// Cheapest seam with buffers of its own; returns -1 if they cannot be allocated
+int compute_seam_sequential(unsigned char* energy_map, int width, int height, int* seam);
+
+// One row of TRANSPOSE_TILE x TRANSPOSE_TILE tiles of the blocked transpose, starting at row ty
+void transpose_tile_row(const unsigned char* image_data, unsigned char* transposed, int width, int height, int channels, int ty);
+
+void transpose_image_sequential(unsigned char* image_data, unsigned char* transposed, int width, int height, int channels);
+
+void remove_seam_sequential(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seam);
+
+int remove_seams_sequential(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k);
+
+int insert_seams_sequential(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k);
 
-void highlight_seam_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename);
- 
 void remove_and_save_seam_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename);
 
+#endif
@@ -0,0 +1,89 @@
+#ifndef SEAM_CARVING_SERVICE_H
+#define SEAM_CARVING_SERVICE_H
+
+#include "Seam_Carving_Engine.h"
+#include "Seam_Carving_Batch.h"
+
+// Requests accepted and not yet answered; further clients wait in the listen backlog until one finishes
+#define SERVICE_DEFAULT_CONCURRENCY 32
+
+// Queued requests carved together in one parallel region, one per thread
+#define SERVICE_DEFAULT_BATCH 16
+
+// Largest input path or PNG, and output path, the wire format allows
+#define SERVICE_MAX_PAYLOAD ((uint32_t)256 << 20)
+
+// Largest request the service accepts unless told otherwise: a thumbnail-sized PNG with room to spare
+#define SERVICE_DEFAULT_MAX_REQUEST ((size_t)16 << 20)
+
+// Seconds a client has to send its whole request, and to take each part of its response
+#define SERVICE_IO_TIMEOUT 10
+
+#define SERVICE_REQUEST_MAGIC 0x51524353u     // "SCRQ" on a little-endian machine
+#define SERVICE_RESPONSE_MAGIC 0x50524353u    // "SCRP"
+
+typedef enum {
+    SERVICE_INPUT_PATH = 0,         // The input is the path of a PNG the service reads
+    SERVICE_INPUT_PNG = 1           // The input is the PNG itself
+} service_input;
+
+// One request per connection, in host byte order (the socket is local): this header, input_length bytes of
+// input, then output_length bytes of output path. Without an output path the carved PNG comes back in the
+// response; with one the service writes it there. Paths are resolved in the service's working directory.
+typedef struct {
+    uint32_t magic;
+    uint32_t input_kind;            // service_input
+    int32_t target_width;           // 0 keeps the width
+    int32_t target_height;          // 0 keeps the height
+    uint32_t input_length;
+    uint32_t output_length;
+} service_request;
+
+// The reply: this header, then `length` bytes of carved PNG, or of error message when status is -1
+typedef struct {
+    uint32_t magic;
+    int32_t status;
+    int32_t width;                  // Size of the carved image
+    int32_t height;
+    uint32_t length;
+} service_response;
+
+// Carving daemon on a Unix domain socket. Every accepted connection gets a reader thread with SERVICE_IO_TIMEOUT
+// seconds to take in the whole request, so a slow client holds up no one else. One dispatcher thread owns the
+// OpenMP team and a seam_carver per thread for its whole life, so neither the threads nor the energy, DP and
+// seam buffers are set up again per request. Requests that queue up while a batch is carved form the next
+// batch: large images take the whole team one after another, the rest are spread over the team one per thread,
+// like run_batch. A request that arrives alone is carved by the whole team.
+typedef struct {
+    const char* socket_path;
+    int concurrency;                // Requests accepted and not yet answered
+    int batch_size;                 // Requests taken off the queue per batch
+    long large_image_pixels;        // Images with at least this many pixels are carved by the whole team
+    size_t max_request;             // Largest input plus output path, in bytes; larger requests are refused
+    png_write_settings settings;    // Encoder settings of the carved images
+} service_options;
+
+void service_options_init(service_options* options);
+
+typedef struct {
+    long requests;
+    long failures;
+    long batches;
+    double seconds;                 // Time from listening to shutting down
+} service_report;
+
+// Serves requests until SIGINT or SIGTERM, then answers what was accepted and removes the socket. Returns 0,
+// or -1 if the socket could not be set up.
+int run_service(const service_options* options, service_report* report);
+
+// Client side, as used by bench/service_load.c. Returns a connected socket or -1.
+int service_connect(const char* socket_path);
+
+// Sends one request; output_path NULL asks for the carved PNG in the response. Returns 0 or -1.
+int service_send_request(int fd, service_input kind, const void* input, size_t input_length, int target_width, int target_height, const char* output_path);
+
+// Reads the response; *payload (response->length bytes, or NULL when empty) then belongs to the caller.
+// Returns 0 once a whole response arrived, whatever its status, or -1.
+int service_read_response(int fd, service_response* response, unsigned char** payload);
+
+#endif
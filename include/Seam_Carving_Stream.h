@@ -0,0 +1,65 @@
+#ifndef SEAM_CARVING_STREAM_H
+#define SEAM_CARVING_STREAM_H
+
+#include "Seam_Carving_Sequential.h"
+#include "Seam_Carving_Parallel.h"
+
+// Energy rows handed to one task of the parallel streaming reader
+#define STREAM_ENERGY_ROWS 16
+
+// Streaming ingestion: the PNG is decoded row by row straight into the image buffer, and every energy row is
+// computed as soon as the rows above and below it have arrived, so the energy map is ready when the last row
+// is. Pass it to carve_options.initial_energy and the first seam search starts without an energy pass.
+// Interlaced files only complete their rows on the last pass; their energy is computed after decoding.
+// On success *image_data and *energy_map (width * height) belong to the caller; returns 0 or -1.
+int read_png_streaming_sequential(const char* filename, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels);
+
+// The calling thread decodes while the rest of the team computes the energy of the rows already decoded
+int read_png_streaming_parallel(const char* filename, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels);
+
+// The same readers on a PNG already in memory, such as one received over a socket
+int read_png_memory_streaming_sequential(const unsigned char* png_data, size_t size, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels);
+
+int read_png_memory_streaming_parallel(const unsigned char* png_data, size_t size, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels);
+
+// Row-level access for images that are never held in memory whole. The decoder applies the expansions of
+// read_png_sequential and reports the size after them; rows come in order, `passes` times over for an
+// interlaced file, and every later pass expects the rows it already filled.
+typedef struct {
+    FILE* fp;
+    png_structp png;
+    png_infop info;
+    int width;
+    int height;
+    int channels;
+    int passes;
+    size_t row_bytes;
+} stream_decoder;
+
+int stream_decoder_open(stream_decoder* decoder, const char* filename);
+
+int stream_decoder_open_memory(stream_decoder* decoder, const unsigned char* png_data, size_t size);
+
+int stream_decoder_read_rows(stream_decoder* decoder, unsigned char* rows, int count);
+
+void stream_decoder_close(stream_decoder* decoder);
+
+// Encodes a non-interlaced PNG of 1 to 4 channels whose rows are handed over in order
+typedef struct {
+    FILE* fp;
+    png_structp png;
+    png_infop info;
+    size_t row_bytes;
+} stream_encoder;
+
+int stream_encoder_open(stream_encoder* encoder, const char* filename, int width, int height, int channels, const png_write_settings* settings);
+
+// Encodes into a growing buffer instead; closing the encoder leaves the PNG in *png_data (*size bytes), which
+// then belongs to the caller, even after a failure
+int stream_encoder_open_memory(stream_encoder* encoder, char** png_data, size_t* size, int width, int height, int channels, const png_write_settings* settings);
+
+int stream_encoder_write_rows(stream_encoder* encoder, const unsigned char* rows, int count);
+
+int stream_encoder_close(stream_encoder* encoder, int status);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SEAM_CARVING_TILED_H
+#define SEAM_CARVING_TILED_H
+
+#include "Seam_Carving_Engine.h"
+
+// Memory budget of an out-of-core carve when none is given
+#define TILED_DEFAULT_BUDGET ((size_t)256 << 20)
+
+// Part of the budget left to the program itself, libpng and zlib
+#define TILED_RESERVED_BYTES ((size_t)8 << 20)
+
+// Out-of-core carving for images that do not fit in memory. The PNG is decoded strip by strip into a raw
+// scratch file, with its channel 0 (what the energy reads) in a second one as a packed plane. Every seam is
+// one pass down the plane a strip at a time: the strip is compacted by the previous seam, its energy rows are
+// computed and fed to the rolling-row DP, and the strip's packed steps are spilled to a third file, which is
+// then traced back bottom-up. Only the removed seams are logged; the colour pixels are gathered from the
+// scratch image once, on the way to the encoder. Strips are mapped one at a time and sized so that what is
+// mapped or allocated at once stays within the memory budget, whatever the image size.
+typedef struct {
+    carve_mode mode;                // Parallel splits every row of the seam search across the thread team
+    size_t memory_budget;           // Bytes of strips, rows and seams held at once
+    const char* scratch_dir;        // Where the scratch files go; they are unlinked as soon as they are opened
+    png_write_settings settings;    // Encoder settings of the carved image
+} tiled_options;
+
+void tiled_options_init(tiled_options* options, carve_mode mode);
+
+// Carves the PNG at input to target_width (or by `seams` seams when target_width is 0) and writes it to
+// output; returns 0 or -1
+int carve_png_tiled(const char* input, const char* output, int target_width, int seams, const tiled_options* options);
+
+typedef struct {
+    int images;
+    int failures;
+    double seconds;
+    size_t peak_memory;             // Peak resident set of the process, in bytes
+} tiled_report;
+
+// Carves every input one after another into output_dir with the same file name; returns 0 if all succeeded
+int run_tiled(char** paths, int count, const char* output_dir, int target_width, int seams, const tiled_options* options, tiled_report* report);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SEAM_CARVING_TRACE_H
+#define SEAM_CARVING_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Runtime tracing of the pipeline stages. Build with -DSEAM_TRACE to compile it in; without it the
+// SEAM_TRACE_* macros expand to nothing. Compiled in, a span costs one branch until trace_start is called,
+// and two clock reads and an event record after. Every thread keeps its own events and per-stage totals, so
+// recording never takes a lock; trace_write_chrome and trace_print_summary read them once the work is done.
+
+// Events kept per thread; later ones still count in the totals but are not written to the trace file
+#define TRACE_MAX_EVENTS (1 << 20)
+
+// Spans open at once on one thread
+#define TRACE_MAX_DEPTH 16
+
+// Hardware counters read around every span when trace_start asks for them: cycles, instructions,
+// last-level cache misses and branch misses
+#define TRACE_COUNTERS 4
+
+typedef enum {
+    TRACE_DECODE,                   // PNG decoding, with the compressed bytes read
+    TRACE_ENERGY,                   // Energy maps and their incremental updates
+    TRACE_SEAM,                     // Seam searches, DP tables included
+    TRACE_REMOVAL,                  // Seam removal, and the transposes of carve_to_size
+    TRACE_GATHER,                   // The final gather of lazy and out-of-core removal
+    TRACE_ENCODE,                   // PNG encoding, with the compressed bytes written
+    TRACE_ITERATION,                // One seam, or one pass of seams, of a carve
+    TRACE_CARVE,                    // A whole carve_seams, carve_to_size or enlarge_seams
+    TRACE_REQUEST,                  // A request of the service, with the bytes received and sent
+    TRACE_STAGE_COUNT
+} trace_stage;
+
+// One open span, on the stack of the code it measures
+typedef struct {
+    int active;
+    int stage;
+    int depth;
+    long index;
+    int64_t start;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t counters[TRACE_COUNTERS];
+} trace_span;
+
+extern int trace_enabled;
+
+// Starts recording; with hardware_counters every thread also opens perf_event_open counters, and carries on
+// without them where the kernel refuses. Returns 0 or -1.
+int trace_start(int hardware_counters);
+
+// Writes every recorded span as Chrome trace-event JSON (chrome://tracing, Perfetto); returns 0 or -1
+int trace_write_chrome(const char* filename);
+
+// Prints calls, time, bytes and counters per stage, summed over the threads
+void trace_print_summary(FILE* out);
+
+// Stops recording and releases every thread's events
+void trace_finish(void);
+
+void trace_span_open(trace_span* span, trace_stage stage, long index);
+
+void trace_span_close(trace_span* span);
+
+void trace_record_allocation(size_t bytes);
+
+// Size of a file, for the bytes of a span; 0 if it cannot be read
+uint64_t trace_file_bytes(const char* path);
+
+static inline void trace_span_begin(trace_span* span, trace_stage stage, long index) {
+    span->active = trace_enabled;
+    span->bytes_read = 0;
+    span->bytes_written = 0;
+    if (span->active)
+        trace_span_open(span, stage, index);
+}
+
+static inline void trace_span_end(trace_span* span) {
+    if (span->active)
+        trace_span_close(span);
+}
+
+#ifdef SEAM_TRACE
+#define SEAM_TRACE_BEGIN(span, stage) trace_span span; trace_span_begin(&span, stage, -1)
+#define SEAM_TRACE_BEGIN_INDEX(span, stage, index) trace_span span; trace_span_begin(&span, stage, index)
+#define SEAM_TRACE_BYTES(span, read, written) do { if ((span).active) { (span).bytes_read += (read); (span).bytes_written += (written); } } while (0)
+#define SEAM_TRACE_END(span) trace_span_end(&span)
+#define SEAM_TRACE_ALLOCATION(bytes) do { if (trace_enabled) trace_record_allocation(bytes); } while (0)
+#else
+#define SEAM_TRACE_BEGIN(span, stage) do { } while (0)
+#define SEAM_TRACE_BEGIN_INDEX(span, stage, index) do { } while (0)
+#define SEAM_TRACE_BYTES(span, read, written) do { } while (0)
+#define SEAM_TRACE_END(span) do { } while (0)
+#define SEAM_TRACE_ALLOCATION(bytes) do { } while (0)
+#endif
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SEAM_CARVING_WORKSPACE_H
+#define SEAM_CARVING_WORKSPACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Seam_Carving_Trace.h"
+
+// Every working buffer starts on its own cache line
+#define WORKSPACE_ALIGNMENT 64
+
+// Growable scratch allocation. It only ever grows and keeps its memory between uses, so once it has seen
+// the largest request nothing allocates any more; growing does not preserve the contents.
+typedef struct {
+    void* data;
+    size_t capacity;
+} seam_buffer;
+
+void seam_buffer_init(seam_buffer* buffer);
+
+void seam_buffer_free(seam_buffer* buffer);
+
+// Makes the buffer hold at least bytes and returns it; NULL when out of memory
+void* seam_buffer_reserve(seam_buffer* buffer, size_t bytes);
+
+// Splits the buffer into count back-to-back regions of the given sizes, each cache-line aligned, and stores
+// their addresses in *buffers[i] (NULL for a size of 0). Regions from an earlier layout become invalid.
+int seam_buffer_layout(seam_buffer* buffer, const size_t* sizes, void** buffers[], int count);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SEAM_CARVING_WRITER_H
+#define SEAM_CARVING_WRITER_H
+
+#include <pthread.h>
+#include "Seam_Carving_Sequential.h"
+
+// One frame waiting to be encoded; the writer owns image_data and frees it once the PNG is written
+typedef struct {
+    char filename[256];
+    unsigned char* image_data;
+    int width;
+    int height;
+    int channels;
+    png_write_settings settings;
+} png_write_job;
+
+// Background PNG encoder: a bounded queue feeds one or more encoder threads, so carving continues
+// while earlier frames are compressed. Submitting to a full queue blocks until a slot frees up.
+typedef struct {
+    png_write_job* jobs;
+    int capacity;
+    int head;
+    int count;
+    int closed;
+    int failures;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t* threads;
+    int thread_count;
+} png_writer;
+
+png_writer* png_writer_create(int threads, int queue_capacity);
+
+// Queues a frame for encoding and takes ownership of image_data; settings may be NULL for the defaults
+int png_writer_submit(png_writer* writer, const char* filename, unsigned char* image_data, int width, int height, int channels, const png_write_settings* settings);
+
+// Waits for every queued frame to be written, stops the threads and returns the number of failed writes
+int png_writer_finish(png_writer* writer);
+
+#endif
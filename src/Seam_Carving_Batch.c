@@ -0,0 +1,390 @@
+#include "../include/Seam_Carving_Batch.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+
+void batch_options_init(batch_options* options) {
+    options->output_dir = "outputs";
+    options->target_width = 0;
+    options->seams = 0;
+    options->seams_per_pass = 1;
+    options->incremental_seams = 1;
+    options->pyramid_levels = 0;
+    options->pyramid_band = PYRAMID_DEFAULT_BAND;
+    options->forward_energy = 0;
+    options->fused_energy = 0;
+    options->large_image_pixels = BATCH_LARGE_IMAGE_PIXELS;
+    options->widths = NULL;
+    options->width_count = 0;
+    options->map_min_width = 0;
+}
+
+// One input image and what happened to it
+typedef struct {
+    const char* path;
+    const char* name;               // File name, which the outputs are named after
+    long pixels;
+    int width;
+    int height;
+    double latency;
+    int status;
+    int skipped;                    // Already narrow enough; nothing was written
+    int collides;                   // An earlier input has the same file name; not carved
+} batch_item;
+
+static int has_png_extension(const char* name) {
+    size_t length = strlen(name);
+    return length > 4 && strcmp(name + length - 4, ".png") == 0;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static const char* file_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int append_path(char*** paths, int* count, int* capacity, const char* path) {
+    if (*count == *capacity) {
+        int grown_capacity = *capacity ? *capacity * 2 : 64;
+        char** grown = realloc(*paths, grown_capacity * sizeof(char*));
+        if (!grown)
+            return -1;
+        *paths = grown;
+        *capacity = grown_capacity;
+    }
+
+    (*paths)[*count] = strdup(path);
+    if (!(*paths)[*count])
+        return -1;
+    (*count)++;
+    return 0;
+}
+
+// Expands the inputs (PNG files or directories of PNG files) into a list of paths; returns the count or -1
+int collect_batch_inputs(char** inputs, int input_count, char*** paths) {
+    int count = 0, capacity = 0;
+    *paths = NULL;
+
+    for (int i = 0; i < input_count; i++) {
+        struct stat info;
+        if (stat(inputs[i], &info) != 0) {
+            perror(inputs[i]);
+            continue;
+        }
+
+        if (!S_ISDIR(info.st_mode)) {
+            if (append_path(paths, &count, &capacity, inputs[i]) != 0)
+                goto failed;
+            continue;
+        }
+
+        DIR* dir = opendir(inputs[i]);
+        if (!dir) {
+            perror("opendir failed");
+            continue;
+        }
+
+        int first = count;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_type != DT_REG || !has_png_extension(entry->d_name))
+                continue;
+
+            char file_path[1024];
+            snprintf(file_path, sizeof(file_path), "%s/%s", inputs[i], entry->d_name);
+            if (append_path(paths, &count, &capacity, file_path) != 0) {
+                closedir(dir);
+                goto failed;
+            }
+        }
+        closedir(dir);
+
+        // Directory order is arbitrary; keep runs reproducible
+        qsort(*paths + first, count - first, sizeof(char*), compare_paths);
+    }
+
+    return count;
+
+failed:
+    free_batch_inputs(*paths, count);
+    *paths = NULL;
+    return -1;
+}
+
+void free_batch_inputs(char** paths, int count) {
+    for (int i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+}
+
+// Cuts every requested width out of the image's seam map, stored in the output directory as <name>.seams.
+// An existing map built from the same pixels and carve options is reused, so later runs skip carving altogether.
+// Widths the image is no wider than are left out, as whole images are in carve_batch_item.
+static int retarget_batch_item(batch_item* item, const batch_options* options, const carve_options* carve, unsigned char* image_data, int width, int height, int channels) {
+    const char* name = item->name;
+    size_t stem_length = strlen(name);
+    if (stem_length > 4 && strcmp(name + stem_length - 4, ".png") == 0)
+        stem_length -= 4;
+
+    // Widths the image already fits in are skipped below, so only narrower ones decide how far the map goes
+    int min_width = width;
+    for (int i = 0; i < options->width_count; i++)
+        min_width = options->widths[i] < min_width ? options->widths[i] : min_width;
+    if (options->map_min_width > 0 && options->map_min_width < min_width)
+        min_width = options->map_min_width;
+
+    char map_filename[1024];
+    snprintf(map_filename, sizeof(map_filename), "%s/%.*s" SEAM_MAP_EXTENSION, options->output_dir, (int)stem_length, name);
+
+    seam_map map;
+    int usable = 0;
+    if (seam_map_read(&map, map_filename) == 0) {
+        usable = seam_map_matches(&map, image_data, width, height, channels, carve);
+        if (!usable)
+            fprintf(stderr, "Rebuilding %s: it was carved from other pixels or with other options\n", map_filename);
+        else
+            usable = width - map.seams <= min_width;
+    }
+    if (!usable) {
+        if (map.order)
+            seam_map_free(&map);
+        if (seam_map_build(&map, image_data, width, height, channels, min_width, carve) != 0 || seam_map_write(&map, map_filename) != 0) {
+            seam_map_free(&map);
+            return -1;
+        }
+    }
+
+    int status = 0;
+    unsigned char* retargeted = malloc((size_t)width * height * channels);
+    for (int i = 0; i < options->width_count && status == 0; i++) {
+        int target_width = options->widths[i];
+        if (target_width >= width) {
+            fprintf(stderr, "Skipping width %d of %s: already %d pixels wide\n", target_width, item->path, width);
+            continue;
+        }
+
+        char output_filename[1024];
+        snprintf(output_filename, sizeof(output_filename), "%s/%.*s_%d.png", options->output_dir, (int)stem_length, name, target_width);
+
+        int retargeted_ok = retargeted && (carve->mode == CARVE_MODE_PARALLEL
+            ? seam_map_retarget_parallel(&map, image_data, channels, target_width, retargeted)
+            : seam_map_retarget_sequential(&map, image_data, channels, target_width, retargeted)) == 0;
+        status = retargeted_ok ? write_png_with_settings(output_filename, retargeted, target_width, height, channels, NULL) : -1;
+    }
+
+    free(retargeted);
+    seam_map_free(&map);
+    return status;
+}
+
+// Decodes, carves and writes one image; the mode decides whether its kernels use the thread team
+static void carve_batch_item(batch_item* item, const batch_options* options, carve_mode mode, seam_carver* carver) {
+    double start = omp_get_wtime();
+    int width, height, channels;
+
+    item->status = -1;
+    unsigned char* image_data;
+    unsigned char* energy_map;
+    int read_status = mode == CARVE_MODE_PARALLEL
+        ? read_png_streaming_parallel(item->path, &image_data, &energy_map, &width, &height, &channels)
+        : read_png_streaming_sequential(item->path, &image_data, &energy_map, &width, &height, &channels);
+    if (read_status != 0) {
+        fprintf(stderr, "Failed to read image: %s\n", item->path);
+        item->latency = omp_get_wtime() - start;
+        return;
+    }
+
+    carve_options carve;
+    carve_options_init(&carve, mode);
+    carve.seams_per_pass = options->seams_per_pass;
+    carve.incremental_seams = options->incremental_seams;
+    carve.pyramid_levels = options->pyramid_levels;
+    carve.pyramid_band = options->pyramid_band;
+    carve.forward_energy = options->forward_energy;
+    carve.fused_energy = options->fused_energy;
+    carve.carver = carver;
+    carve.initial_energy = energy_map;
+
+    // Nothing to remove is not a failure: the image is already as narrow as asked
+    int narrowest = options->target_width;
+    for (int i = 0; i < options->width_count; i++)
+        narrowest = i == 0 || options->widths[i] < narrowest ? options->widths[i] : narrowest;
+    if (narrowest > 0 && width <= narrowest) {
+        fprintf(stderr, "Skipping %s: already %d pixels wide\n", item->path, width);
+        item->skipped = 1;
+        item->status = 0;
+    } else if (options->width_count > 0) {
+        item->status = retarget_batch_item(item, options, &carve, image_data, width, height, channels);
+    } else {
+        int seams = options->target_width > 0 ? width - options->target_width : options->seams;
+        if (carve_seams(&image_data, &width, height, channels, seams, &carve) == 0) {
+            char output_filename[1024];
+            snprintf(output_filename, sizeof(output_filename), "%s/%s", options->output_dir, item->name);
+            item->status = write_png_with_settings(output_filename, image_data, width, height, channels, NULL);
+        }
+    }
+
+    free(image_data);
+    free(energy_map);
+    item->latency = omp_get_wtime() - start;
+}
+
+// Image size from the signature and IHDR chunk at the start of a PNG, which always come first
+long png_header_pixel_count(const unsigned char* png_data, size_t size) {
+    if (size < PNG_HEADER_BYTES || png_sig_cmp(png_data, 0, 8) != 0)
+        return 0;
+
+    long width = ((long)png_data[16] << 24) | (png_data[17] << 16) | (png_data[18] << 8) | png_data[19];
+    long height = ((long)png_data[20] << 24) | (png_data[21] << 16) | (png_data[22] << 8) | png_data[23];
+    return width * height;
+}
+
+// Reads just the PNG header to learn the image size
+long png_pixel_count(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+
+    unsigned char header[PNG_HEADER_BYTES];
+    size_t size = fread(header, 1, sizeof(header), fp);
+    fclose(fp);
+    return png_header_pixel_count(header, size);
+}
+
+// Orders items by file name, then by their place in the input list
+static int compare_items_by_name(const void* a, const void* b) {
+    const batch_item* ia = *(batch_item* const*)a;
+    const batch_item* ib = *(batch_item* const*)b;
+    int order = strcmp(ia->name, ib->name);
+    return order != 0 ? order : (ia > ib) - (ia < ib);
+}
+
+// Marks every input whose file name an earlier input already has: both would be written to the same outputs
+static int mark_name_collisions(batch_item* items, int count) {
+    batch_item** by_name = malloc((count > 0 ? count : 1) * sizeof(batch_item*));
+    if (!by_name)
+        return -1;
+    for (int i = 0; i < count; i++)
+        by_name[i] = &items[i];
+    qsort(by_name, count, sizeof(batch_item*), compare_items_by_name);
+
+    batch_item* kept = by_name[0];
+    for (int i = 1; i < count; i++) {
+        if (strcmp(by_name[i]->name, kept->name) != 0) {
+            kept = by_name[i];
+            continue;
+        }
+        by_name[i]->collides = 1;
+        by_name[i]->status = -1;
+        fprintf(stderr, "Not carving %s: its output would overwrite that of %s\n", by_name[i]->path, kept->path);
+    }
+    free(by_name);
+    return 0;
+}
+
+static int compare_items_by_size(const void* a, const void* b) {
+    const batch_item* ia = a;
+    const batch_item* ib = b;
+    return (ia->pixels < ib->pixels) - (ia->pixels > ib->pixels);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Nearest-rank percentile of an ascending array
+static double percentile(const double* sorted, int count, double fraction) {
+    int rank = (int)ceil(fraction * count);
+    return sorted[(rank > 0 ? rank : 1) - 1];
+}
+
+// Carves every image and writes it under output_dir with the same file name; returns 0 if all succeeded
+int run_batch(char** paths, int count, const batch_options* options, batch_report* report) {
+    memset(report, 0, sizeof(*report));
+    if (mkdir(options->output_dir, 0755) != 0 && errno != EEXIST) {
+        perror(options->output_dir);
+        return -1;
+    }
+
+    batch_item* items = calloc(count > 0 ? count : 1, sizeof(batch_item));
+    double* latencies = malloc((count > 0 ? count : 1) * sizeof(double));
+    if (!items || !latencies) {
+        free(items);
+        free(latencies);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        items[i].path = paths[i];
+        items[i].name = file_name(paths[i]);
+        items[i].pixels = png_pixel_count(paths[i]);
+    }
+    if (mark_name_collisions(items, count) != 0) {
+        free(items);
+        free(latencies);
+        return -1;
+    }
+
+    // Largest first: big images take the whole team one after another, then the small ones are spread over
+    // the team as tasks, longest first so the idle threads pick up the short tail at the end
+    qsort(items, count, sizeof(batch_item), compare_items_by_size);
+
+    // One carver per thread: after the first few images its buffers fit and carving stops allocating.
+    // Tasks are tied, so a task stays on the thread whose carver it picked up.
+    int thread_count = omp_get_max_threads();
+    seam_carver* carvers = malloc(thread_count * sizeof(seam_carver));
+    if (!carvers) {
+        free(items);
+        free(latencies);
+        return -1;
+    }
+    for (int t = 0; t < thread_count; t++)
+        seam_carver_init(&carvers[t]);
+
+    double start = omp_get_wtime();
+    int first_small = 0;
+    while (first_small < count && items[first_small].pixels >= options->large_image_pixels) {
+        if (!items[first_small].collides)
+            carve_batch_item(&items[first_small], options, CARVE_MODE_PARALLEL, &carvers[0]);
+        first_small++;
+    }
+
+    #pragma omp parallel
+    #pragma omp single
+    for (int i = first_small; i < count; i++) {
+        if (items[i].collides)
+            continue;
+        #pragma omp task firstprivate(i)
+        carve_batch_item(&items[i], options, CARVE_MODE_SEQUENTIAL, &carvers[omp_get_thread_num()]);
+    }
+    report->seconds = omp_get_wtime() - start;
+
+    for (int t = 0; t < thread_count; t++)
+        seam_carver_free(&carvers[t]);
+    free(carvers);
+
+    // Latencies cover the images that were carved, not the ones left alone
+    int carved = 0;
+    for (int i = 0; i < count; i++) {
+        if (items[i].status != 0)
+            report->failures++;
+        report->skipped += items[i].skipped;
+        if (!items[i].skipped && !items[i].collides)
+            latencies[carved++] = items[i].latency;
+    }
+    qsort(latencies, carved, sizeof(double), compare_doubles);
+
+    report->images = count;
+    if (carved > 0) {
+        report->p50_latency = percentile(latencies, carved, 0.50);
+        report->p99_latency = percentile(latencies, carved, 0.99);
+    }
+
+    free(items);
+    free(latencies);
+    return report->failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,799 @@
+#include "../include/Seam_Carving_Engine.h"
+
+// Fills in the defaults used by the interactive program
+void carve_options_init(carve_options* options, carve_mode mode) {
+    options->mode = mode;
+    options->save_intermediate = 0;
+    options->incremental_energy = 1;
+    options->incremental_seams = 1;
+    options->seams_per_pass = 1;
+    options->pyramid_levels = 0;
+    options->pyramid_band = PYRAMID_DEFAULT_BAND;
+    options->fused_energy = 0;
+    options->forward_energy = 0;
+    options->lazy_removal = 1;
+    options->seam_prior = NULL;
+    options->prior_band = PYRAMID_DEFAULT_BAND;
+    options->seam_history = NULL;
+    options->output_dir = "outputs";
+    options->recorded_seams = NULL;
+    options->writer = NULL;
+    options->carver = NULL;
+    options->initial_energy = NULL;
+    png_write_settings_init(&options->intermediate_settings);
+}
+
+void seam_carver_init(seam_carver* carver) {
+    seam_buffer_init(&carver->stage);
+    seam_buffer_init(&carver->image_scratch);
+    seam_buffer_init(&carver->origin_index);
+    seam_buffer_init(&carver->origin_scratch);
+    seam_buffer_init(&carver->lazy);
+}
+
+void seam_carver_free(seam_carver* carver) {
+    seam_buffer_free(&carver->stage);
+    seam_buffer_free(&carver->image_scratch);
+    seam_buffer_free(&carver->origin_index);
+    seam_buffer_free(&carver->origin_scratch);
+    seam_buffer_free(&carver->lazy);
+}
+
+// The caller's carver, or else the temporary one, which carver_end releases again
+static seam_carver* carver_begin(const carve_options* options, seam_carver* temporary) {
+    if (options->carver)
+        return options->carver;
+    seam_carver_init(temporary);
+    return temporary;
+}
+
+static void carver_end(const carve_options* options, seam_carver* carver) {
+    if (carver != options->carver)
+        seam_carver_free(carver);
+}
+
+// Writes one intermediate frame as output_<iteration>.png. With a background writer the frame is copied
+// and queued, so carving goes on while it is compressed; otherwise it is encoded right here. Returns -1 if the
+// frame could not be written or queued.
+static int save_intermediate_frame(const carve_options* options, int iteration, unsigned char* image_data, int width, int height, int channels) {
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s/output_%d.png", options->output_dir, iteration);
+
+    if (!options->writer)
+        return write_png_with_settings(filename, image_data, width, height, channels, &options->intermediate_settings);
+
+    size_t image_bytes = (size_t)width * height * channels;
+    unsigned char* frame = malloc(image_bytes);
+    if (!frame) {
+        perror("Intermediate frame allocation failed");
+        return -1;
+    }
+    memcpy(frame, image_data, image_bytes);
+    return png_writer_submit(options->writer, filename, frame, width, height, channels, &options->intermediate_settings);
+}
+
+// Original pixel index of every pixel in the working buffer. It is only kept while seams are being logged,
+// and follows the image through every removal and transpose so logged seams land on the input's frame.
+typedef struct {
+    int* index;
+    int* scratch;
+} origin_map;
+
+static int origin_map_init(origin_map* origin, seam_carver* carver, int width, int height) {
+    size_t cells = (size_t)width * height;
+    origin->index = seam_buffer_reserve(&carver->origin_index, cells * sizeof(int));
+    origin->scratch = seam_buffer_reserve(&carver->origin_scratch, cells * sizeof(int));
+    if (!origin->index || !origin->scratch)
+        return -1;
+
+    for (size_t i = 0; i < cells; i++)
+        origin->index[i] = (int)i;
+    return 0;
+}
+
+// Appends a vertical seam of the working buffer to the log in original coordinates
+static int origin_map_log_seam(origin_map* origin, seam_log* log, int width, int height, int* seam) {
+    int* pixels = origin->scratch;
+    for (int y = 0; y < height; y++)
+        pixels[y] = origin->index[(size_t)y * width + seam[y]];
+    return seam_log_append(log, pixels, height);
+}
+
+// Drops k seams (seams[s * height + y]) from the map the same way they were dropped from the image;
+// returns -1 if the removal could not allocate its column buffer
+static int origin_map_remove(origin_map* origin, int parallel, int width, int height, int* seams, int k) {
+    if (!parallel)
+        return remove_seams_sequential((unsigned char*)origin->index, (unsigned char*)origin->index, width, height, sizeof(int), seams, k);
+
+    int status = remove_seams_parallel((unsigned char*)origin->index, (unsigned char*)origin->scratch, width, height, sizeof(int), seams, k);
+    int* previous = origin->index;
+    origin->index = origin->scratch;
+    origin->scratch = previous;
+    return status;
+}
+
+static void origin_map_transpose(origin_map* origin, int parallel, int width, int height) {
+    if (parallel)
+        transpose_image_parallel((unsigned char*)origin->index, (unsigned char*)origin->scratch, width, height, sizeof(int));
+    else
+        transpose_image_sequential((unsigned char*)origin->index, (unsigned char*)origin->scratch, width, height, sizeof(int));
+
+    int* previous = origin->index;
+    origin->index = origin->scratch;
+    origin->scratch = previous;
+}
+
+// Takes k seams of the carved plane out of the lazy column sets; in lazy mode this is also where seams are
+// logged, since the column sets already know every seam's original columns. Returns -1 if the log cannot grow.
+static int lazy_record_seams(lazy_columns* lazy, const carve_options* options, int* seams, int k, int* originals) {
+    lazy_columns_remove_seams(lazy, seams, k, originals);
+    if (!options->recorded_seams)
+        return 0;
+
+    int height = lazy->height;
+    for (int s = 0; s < k; s++) {
+        int* pixels = originals + (size_t)s * height;
+        for (int y = 0; y < height; y++)
+            pixels[y] += y * lazy->width;
+        if (seam_log_append(options->recorded_seams, pixels, height) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Removes up to seams_per_pass disjoint seams per energy + DP pass; quality trades against speed as k grows.
+// *scratch is the parallel back end's second image buffer; the two are swapped as the passes go.
+static int carve_seams_batched(seam_carver* carver, unsigned char** image_data, unsigned char** scratch, int* width, int height, int channels, int iterations, const carve_options* options, origin_map* origin, lazy_columns* lazy) {
+    int parallel = options->mode == CARVE_MODE_PARALLEL;
+    int k = options->seams_per_pass;
+    size_t cells = (size_t)(*width) * height;
+
+    unsigned char* energy_map;
+    int* dp;
+    signed char* backtrack;
+    unsigned char* used;
+    int* seams;
+    seam_start* order;
+    int* originals;
+    size_t sizes[] = {
+        cells, cells * sizeof(int), cells, cells, (size_t)k * height * sizeof(int), (size_t)(*width) * sizeof(seam_start),
+        lazy ? (size_t)k * height * sizeof(int) : 0,
+    };
+    void** buffers[] = { (void**)&energy_map, (void**)&dp, (void**)&backtrack, (void**)&used, (void**)&seams, (void**)&order, (void**)&originals };
+    if (seam_buffer_layout(&carver->stage, sizes, buffers, 7) != 0)
+        return -1;
+
+    unsigned char* current = *image_data;
+
+    // A seam log that cannot grow or a frame that cannot be saved stops the carve after the pass it failed in,
+    // with the buffers consistent
+    int status = 0;
+    for (int pass = 0, removed = 0; removed < iterations && status == 0; pass++) {
+        SEAM_TRACE_BEGIN_INDEX(iteration_span, TRACE_ITERATION, pass);
+        int w = *width;
+        int wanted = iterations - removed < k ? iterations - removed : k;
+
+        SEAM_TRACE_BEGIN(energy_span, TRACE_ENERGY);
+        if (pass == 0 && options->initial_energy)
+            memcpy(energy_map, options->initial_energy, (size_t)w * height);
+        else if (parallel)
+            compute_energy_map_parallel(current, w, height, channels, energy_map);
+        else
+            compute_energy_map_sequential(current, w, height, channels, energy_map);
+        SEAM_TRACE_END(energy_span);
+
+        SEAM_TRACE_BEGIN(seam_span, TRACE_SEAM);
+        if (parallel)
+            compute_seam_table_parallel(energy_map, w, height, dp, backtrack);
+        else
+            compute_seam_table_sequential(energy_map, w, height, dp, backtrack);
+
+        int found = find_seams_sequential(dp, backtrack, w, height, wanted, seams, used, order);
+        SEAM_TRACE_END(seam_span);
+
+        SEAM_TRACE_BEGIN(removal_span, TRACE_REMOVAL);
+        if (lazy && lazy_record_seams(lazy, options, seams, found, originals) != 0)
+            status = -1;
+        if (origin) {
+            for (int s = 0; s < found && status == 0; s++)
+                status = origin_map_log_seam(origin, options->recorded_seams, w, height, seams + (size_t)s * height);
+            if (origin_map_remove(origin, parallel, w, height, seams, found) != 0)
+                status = -1;
+        }
+
+        unsigned char* target = parallel ? *scratch : current;
+        int removal = parallel ? remove_seams_parallel(current, target, w, height, channels, seams, found)
+                               : remove_seams_sequential(current, target, w, height, channels, seams, found);
+        if (removal != 0)
+            status = -1;
+        SEAM_TRACE_END(removal_span);
+
+        if (options->save_intermediate && save_intermediate_frame(options, pass, target, w - found, height, channels) != 0)
+            status = -1;
+
+        if (parallel) {
+            *scratch = current;
+            current = target;
+        }
+        *width = w - found;
+        removed += found;
+        SEAM_TRACE_END(iteration_span);
+    }
+
+    *image_data = current;
+    return status;
+}
+
+// Pyramid workspace for every width the carve passes through; a narrower map with one level fewer can need
+// more room than a wider one
+static size_t pyramid_stage_bytes(int width, int height, int iterations, const carve_options* options) {
+    size_t bytes = 0;
+    for (int w = width; w > width - iterations; w--) {
+        size_t needed = seam_pyramid_bytes(w, height, options->pyramid_levels, options->pyramid_band);
+        if (needed > bytes)
+            bytes = needed;
+    }
+    return bytes;
+}
+
+// Runs energy -> seam -> removal on the in-memory image; origin is NULL unless seams are being logged.
+// The parallel removal cannot compact in place, so it ping-pongs between *image_data and *scratch.
+static int carve_seams_tracked(seam_carver* carver, unsigned char** image_data, unsigned char** scratch, int* width, int height, int channels, int iterations, const carve_options* options, origin_map* origin, lazy_columns* lazy) {
+    if (iterations < 0 || iterations >= *width) {
+        fprintf(stderr, "Cannot remove %d seams from an image %d pixels wide\n", iterations, *width);
+        return -1;
+    }
+
+    if (options->seams_per_pass > 1)
+        return carve_seams_batched(carver, image_data, scratch, width, height, channels, iterations, options, origin, lazy);
+
+    int parallel = options->mode == CARVE_MODE_PARALLEL;
+    int guided = options->seam_prior != NULL;
+    int forward = options->forward_energy && !guided;
+    int pyramid = options->pyramid_levels > 0 && !forward && !guided;
+    int incremental = options->incremental_seams && !pyramid && !forward && !guided;
+    int fused = options->fused_energy && !incremental && !pyramid && !forward && !guided;
+    size_t cells = (size_t)(*width) * height;
+
+    // The cumulative-cost table survives across iterations when it is refreshed incrementally; otherwise
+    // every seam is searched from scratch in two rolling cost rows and a 2-bit step table, or coarse-to-fine.
+    // The fused search computes energy row by row as it goes, so energy_map is then a single row, and the
+    // forward-energy search reads only the image. A guided search only needs the rows of its band.
+    unsigned char* energy_map;
+    unsigned char* energy_scratch;
+    int* seam;
+    int* dp;
+    int* dp_scratch;
+    signed char* backtrack;
+    signed char* backtrack_scratch;
+    uint32_t* cost_rows;
+    unsigned char* steps;
+    int* originals;
+    void* pyramid_workspace;
+    size_t sizes[] = {
+        forward ? 0 : fused ? (size_t)(*width) : cells,
+        parallel && options->incremental_energy && !fused && !forward ? cells : 0,
+        height * sizeof(int),
+        incremental ? cells * sizeof(int) : 0,
+        incremental && parallel ? cells * sizeof(int) : 0,
+        incremental ? cells : 0,
+        incremental && parallel ? cells : 0,
+        incremental || pyramid || guided ? 0 : 2 * (size_t)(*width) * sizeof(uint32_t),
+        incremental || pyramid || guided ? 0 : (size_t)height * SEAM_STEP_ROW_BYTES(*width),
+        lazy ? height * sizeof(int) : 0,
+        pyramid ? pyramid_stage_bytes(*width, height, iterations, options)
+            : guided ? seam_guided_bytes(height, options->prior_band) : 0,
+    };
+    void** buffers[] = {
+        (void**)&energy_map, (void**)&energy_scratch, (void**)&seam, (void**)&dp, (void**)&dp_scratch,
+        (void**)&backtrack, (void**)&backtrack_scratch, (void**)&cost_rows, (void**)&steps, (void**)&originals,
+        &pyramid_workspace,
+    };
+    if (seam_buffer_layout(&carver->stage, sizes, buffers, 11) != 0)
+        return -1;
+
+    unsigned char* current = *image_data;
+
+    int status = 0;
+    for (int i = 0; i < iterations && status == 0; i++) {
+        SEAM_TRACE_BEGIN_INDEX(iteration_span, TRACE_ITERATION, i);
+        int w = *width;
+        unsigned char* target = parallel ? *scratch : current;
+
+        // In incremental mode the map was already brought up to date by the previous removal
+        if (fused || forward) {
+            // Nothing to prepare: the search reads the image itself
+        } else if (i == 0 && options->initial_energy) {
+            memcpy(energy_map, options->initial_energy, (size_t)w * height);
+        } else if (i == 0 || !(options->incremental_energy || incremental)) {
+            SEAM_TRACE_BEGIN(energy_span, TRACE_ENERGY);
+            if (parallel)
+                compute_energy_map_parallel(current, w, height, channels, energy_map);
+            else
+                compute_energy_map_sequential(current, w, height, channels, energy_map);
+            SEAM_TRACE_END(energy_span);
+        }
+
+        SEAM_TRACE_BEGIN(seam_span, TRACE_SEAM);
+        if (incremental) {
+            if (i == 0) {
+                if (parallel)
+                    compute_seam_table_parallel(energy_map, w, height, dp, backtrack);
+                else
+                    compute_seam_table_sequential(energy_map, w, height, dp, backtrack);
+            }
+            if (parallel)
+                trace_seam_parallel(dp, backtrack, w, height, seam);
+            else
+                trace_seam_sequential(dp, backtrack, w, height, seam);
+        } else if (fused) {
+            if (parallel)
+                compute_seam_fused_parallel(current, w, height, channels, energy_map, cost_rows, steps, seam);
+            else
+                compute_seam_fused_sequential(current, w, height, channels, energy_map, cost_rows, steps, seam);
+        } else if (forward) {
+            if (parallel)
+                compute_seam_forward_parallel(current, w, height, channels, cost_rows, steps, seam);
+            else
+                compute_seam_forward_sequential(current, w, height, channels, cost_rows, steps, seam);
+        } else if (guided) {
+            compute_seam_guided(energy_map, w, height, options->seam_prior + (size_t)i * height, options->prior_band, pyramid_workspace, seam);
+        } else if (pyramid) {
+            if (parallel)
+                compute_seam_pyramid_parallel(energy_map, w, height, options->pyramid_levels, options->pyramid_band, pyramid_workspace, seam);
+            else
+                compute_seam_pyramid_sequential(energy_map, w, height, options->pyramid_levels, options->pyramid_band, pyramid_workspace, seam);
+        } else if (parallel) {
+            compute_seam_compact_parallel(energy_map, w, height, cost_rows, steps, seam);
+        } else {
+            compute_seam_compact_sequential(energy_map, w, height, cost_rows, steps, seam);
+        }
+        SEAM_TRACE_END(seam_span);
+
+        SEAM_TRACE_BEGIN(removal_span, TRACE_REMOVAL);
+        if (options->seam_history)
+            memcpy(options->seam_history + (size_t)i * height, seam, height * sizeof(int));
+        if (lazy && lazy_record_seams(lazy, options, seam, 1, originals) != 0)
+            status = -1;
+        if (origin) {
+            if (origin_map_log_seam(origin, options->recorded_seams, w, height, seam) != 0 ||
+                origin_map_remove(origin, parallel, w, height, seam, 1) != 0)
+                status = -1;
+        }
+
+        if (parallel)
+            remove_seam_parallel(current, target, w, height, channels, seam);
+        else
+            remove_seam_sequential(current, target, w, height, channels, seam);
+        SEAM_TRACE_END(removal_span);
+
+        if (options->save_intermediate && save_intermediate_frame(options, i, target, w - 1, height, channels) != 0)
+            status = -1;
+
+        if (i + 1 < iterations && !fused && !forward) {
+            SEAM_TRACE_BEGIN(update_span, TRACE_ENERGY);
+            if (options->incremental_energy) {
+                if (parallel) {
+                    update_energy_map_parallel(target, w - 1, height, channels, seam, energy_map, energy_scratch);
+                    unsigned char* previous = energy_map;
+                    energy_map = energy_scratch;
+                    energy_scratch = previous;
+                } else {
+                    update_energy_map_sequential(target, w - 1, height, channels, seam, energy_map, energy_map);
+                }
+            } else if (incremental) {
+                // The table refresh reads the new energy map, so compute it here instead of next iteration
+                if (parallel)
+                    compute_energy_map_parallel(target, w - 1, height, channels, energy_map);
+                else
+                    compute_energy_map_sequential(target, w - 1, height, channels, energy_map);
+            }
+            SEAM_TRACE_END(update_span);
+
+            if (incremental) {
+                SEAM_TRACE_BEGIN(refresh_span, TRACE_SEAM);
+                if (parallel) {
+                    update_seam_table_parallel(energy_map, w - 1, height, seam, dp, backtrack, dp_scratch, backtrack_scratch);
+                    int* previous_dp = dp;
+                    dp = dp_scratch;
+                    dp_scratch = previous_dp;
+                    signed char* previous_backtrack = backtrack;
+                    backtrack = backtrack_scratch;
+                    backtrack_scratch = previous_backtrack;
+                } else {
+                    update_seam_table_sequential(energy_map, w - 1, height, seam, dp, backtrack, dp, backtrack);
+                }
+                SEAM_TRACE_END(refresh_span);
+            }
+        }
+
+        if (parallel) {
+            *scratch = current;
+            current = target;
+        }
+        *width = w - 1;
+        SEAM_TRACE_END(iteration_span);
+    }
+
+    *image_data = current;
+    return status;
+}
+
+// Moves the result back into the caller's buffer when it ended up in the carver's scratch image
+static void return_to_caller(unsigned char* caller_buffer, unsigned char* current, size_t bytes) {
+    if (current != caller_buffer)
+        memcpy(caller_buffer, current, bytes);
+}
+
+// Lazy removal: the carve runs on a plane holding only channel 0, the one the energy reads, so each removal
+// moves one byte per pixel whatever the channel count. The column sets remember which original columns
+// survive, and the full pixels are gathered into the caller's buffer once at the end.
+static int carve_seams_lazy(seam_carver* carver, unsigned char* image_data, int* width, int height, int channels, int iterations, const carve_options* options) {
+    int parallel = options->mode == CARVE_MODE_PARALLEL;
+    size_t cells = (size_t)(*width) * height;
+    size_t masks = (size_t)height * LAZY_BLOCKS(*width);
+
+    unsigned char* plane;
+    unsigned char* plane_scratch;
+    uint64_t* alive;
+    int* counts;
+    size_t sizes[] = { cells, parallel ? cells : 0, masks * sizeof(uint64_t), masks * sizeof(int) };
+    void** buffers[] = { (void**)&plane, (void**)&plane_scratch, (void**)&alive, (void**)&counts };
+    if (seam_buffer_layout(&carver->lazy, sizes, buffers, 4) != 0)
+        return -1;
+
+    #pragma omp parallel for schedule(static) if (parallel)
+    for (int y = 0; y < height; y++)
+        copy_channel0(image_data + (size_t)y * (*width) * channels, channels, plane + (size_t)y * (*width), *width);
+
+    lazy_columns columns;
+    lazy_columns_init(&columns, alive, counts, *width, height);
+
+    unsigned char* current = plane;
+    if (carve_seams_tracked(carver, &current, &plane_scratch, width, height, 1, iterations, options, NULL, &columns) != 0)
+        return -1;
+
+    // Rows of the parallel gather are independent only when it does not work in place
+    SEAM_TRACE_BEGIN(gather_span, TRACE_GATHER);
+    int status = 0;
+    if (parallel) {
+        size_t image_bytes = (size_t)(*width) * height * channels;
+        unsigned char* gathered = seam_buffer_reserve(&carver->image_scratch, image_bytes);
+        if (gathered) {
+            gather_columns_parallel(&columns, image_data, gathered, channels);
+            memcpy(image_data, gathered, image_bytes);
+        } else {
+            status = -1;
+        }
+    } else {
+        gather_columns_sequential(&columns, image_data, image_data, channels);
+    }
+    SEAM_TRACE_END(gather_span);
+    return status;
+}
+
+// Runs energy -> seam -> removal on the in-memory image for the requested number of iterations
+int carve_seams(unsigned char** image_data, int* width, int height, int channels, int iterations, const carve_options* options) {
+    SEAM_TRACE_BEGIN(carve_span, TRACE_CARVE);
+    seam_carver temporary;
+    seam_carver* carver = carver_begin(options, &temporary);
+    int parallel = options->mode == CARVE_MODE_PARALLEL;
+    int status = -1;
+
+    // Intermediate frames need every pixel after every seam, and a single channel has nothing to skip
+    if (options->lazy_removal && channels > 1 && !options->save_intermediate) {
+        status = carve_seams_lazy(carver, *image_data, width, height, channels, iterations, options);
+        goto cleanup;
+    }
+
+    unsigned char* current = *image_data;
+    unsigned char* scratch = NULL;
+    if (parallel && !(scratch = seam_buffer_reserve(&carver->image_scratch, (size_t)(*width) * height * channels)))
+        goto cleanup;
+
+    origin_map origin;
+    origin_map* tracked = NULL;
+    if (options->recorded_seams) {
+        if (origin_map_init(&origin, carver, *width, height) != 0)
+            goto cleanup;
+        tracked = &origin;
+    }
+
+    status = carve_seams_tracked(carver, &current, &scratch, width, height, channels, iterations, options, tracked, NULL);
+    return_to_caller(*image_data, current, (size_t)(*width) * height * channels);
+
+cleanup:
+    carver_end(options, carver);
+    SEAM_TRACE_END(carve_span);
+    return status;
+}
+
+// Cheapest seam in a filled cumulative-cost table
+static int cheapest_seam_cost(int* dp, int width, int height) {
+    int* last_row = dp + (size_t)(height - 1) * width;
+    int min_energy = last_row[0];
+    for (int x = 1; x < width; x++)
+        min_energy = last_row[x] < min_energy ? last_row[x] : min_energy;
+    return min_energy;
+}
+
+// Transposes *current into *scratch and swaps the two buffers and the buffer dimensions
+static void transpose_buffer(int parallel, unsigned char** current, unsigned char** scratch, int* buffer_width, int* buffer_height, int channels, origin_map* origin) {
+    SEAM_TRACE_BEGIN(span, TRACE_REMOVAL);
+    if (origin)
+        origin_map_transpose(origin, parallel, *buffer_width, *buffer_height);
+
+    if (parallel)
+        transpose_image_parallel(*current, *scratch, *buffer_width, *buffer_height, channels);
+    else
+        transpose_image_sequential(*current, *scratch, *buffer_width, *buffer_height, channels);
+
+    unsigned char* previous = *current;
+    *current = *scratch;
+    *scratch = previous;
+    int previous_width = *buffer_width;
+    *buffer_width = *buffer_height;
+    *buffer_height = previous_width;
+    SEAM_TRACE_END(span);
+}
+
+// Carves to target_width x target_height. While both dimensions still shrink, each step takes whichever of the
+// best vertical and best horizontal seam is cheaper per pixel; the rest goes through carve_seams. Horizontal
+// seams are vertical seams of the transposed buffer, so the buffer is only transposed when the direction flips.
+int carve_to_size(unsigned char** image_data, int* width, int* height, int channels, int target_width, int target_height, const carve_options* options) {
+    if (target_width < 1 || target_width > *width || target_height < 1 || target_height > *height) {
+        fprintf(stderr, "Cannot carve a %dx%d image to %dx%d\n", *width, *height, target_width, target_height);
+        return -1;
+    }
+
+    SEAM_TRACE_BEGIN(carve_span, TRACE_CARVE);
+    int parallel = options->mode == CARVE_MODE_PARALLEL;
+    size_t cells = (size_t)(*width) * (*height);
+    int longest = *width > *height ? *width : *height;
+
+    seam_carver temporary;
+    seam_carver* carver = carver_begin(options, &temporary);
+    origin_map origin;
+    origin_map* tracked = NULL;
+    int status = -1;
+
+    // Transposes need a second image buffer even in the sequential back end
+    unsigned char* scratch = seam_buffer_reserve(&carver->image_scratch, cells * channels);
+    unsigned char* energy_map;
+    unsigned char* energy_transposed;
+    int* dp;
+    int* dp_transposed;
+    signed char* backtrack;
+    signed char* backtrack_transposed;
+    int* seam;
+    size_t sizes[] = { cells, cells, cells * sizeof(int), cells * sizeof(int), cells, cells, longest * sizeof(int) };
+    void** buffers[] = {
+        (void**)&energy_map, (void**)&energy_transposed, (void**)&dp, (void**)&dp_transposed,
+        (void**)&backtrack, (void**)&backtrack_transposed, (void**)&seam,
+    };
+    if (!scratch || seam_buffer_layout(&carver->stage, sizes, buffers, 7) != 0)
+        goto cleanup;
+    if (options->recorded_seams) {
+        if (origin_map_init(&origin, carver, *width, *height) != 0)
+            goto cleanup;
+        tracked = &origin;
+    }
+
+    // The buffer is buffer_width x buffer_height; when transposed its rows are the image's columns
+    unsigned char* current = *image_data;
+    int transposed = 0;
+    int buffer_width = *width, buffer_height = *height;
+
+    int log_status = 0;
+    for (long step = 0; *width > target_width && *height > target_height && log_status == 0; step++) {
+        SEAM_TRACE_BEGIN_INDEX(iteration_span, TRACE_ITERATION, step);
+        SEAM_TRACE_BEGIN(energy_span, TRACE_ENERGY);
+        if (parallel) {
+            compute_energy_map_parallel(current, buffer_width, buffer_height, channels, energy_map);
+            // gx and gy swap under transposition, so the energy of the transposed image is the transposed energy
+            transpose_image_parallel(energy_map, energy_transposed, buffer_width, buffer_height, 1);
+        } else {
+            compute_energy_map_sequential(current, buffer_width, buffer_height, channels, energy_map);
+            transpose_image_sequential(energy_map, energy_transposed, buffer_width, buffer_height, 1);
+        }
+        SEAM_TRACE_END(energy_span);
+
+        SEAM_TRACE_BEGIN(table_span, TRACE_SEAM);
+        if (parallel) {
+            compute_seam_table_parallel(energy_map, buffer_width, buffer_height, dp, backtrack);
+            compute_seam_table_parallel(energy_transposed, buffer_height, buffer_width, dp_transposed, backtrack_transposed);
+        } else {
+            compute_seam_table_sequential(energy_map, buffer_width, buffer_height, dp, backtrack);
+            compute_seam_table_sequential(energy_transposed, buffer_height, buffer_width, dp_transposed, backtrack_transposed);
+        }
+
+        // Mean cost per pixel, so that seams of different lengths compare fairly
+        double column_cost = (double)cheapest_seam_cost(dp, buffer_width, buffer_height) / buffer_height;
+        double row_cost = (double)cheapest_seam_cost(dp_transposed, buffer_height, buffer_width) / buffer_width;
+        SEAM_TRACE_END(table_span);
+
+        int* seam_dp = dp;
+        signed char* seam_backtrack = backtrack;
+        if (row_cost < column_cost) {
+            transpose_buffer(parallel, &current, &scratch, &buffer_width, &buffer_height, channels, tracked);
+            transposed = !transposed;
+            seam_dp = dp_transposed;
+            seam_backtrack = backtrack_transposed;
+        }
+
+        SEAM_TRACE_BEGIN(path_span, TRACE_SEAM);
+        if (parallel)
+            trace_seam_parallel(seam_dp, seam_backtrack, buffer_width, buffer_height, seam);
+        else
+            trace_seam_sequential(seam_dp, seam_backtrack, buffer_width, buffer_height, seam);
+        SEAM_TRACE_END(path_span);
+
+        SEAM_TRACE_BEGIN(removal_span, TRACE_REMOVAL);
+        if (tracked) {
+            log_status = origin_map_log_seam(tracked, options->recorded_seams, buffer_width, buffer_height, seam);
+            if (origin_map_remove(tracked, parallel, buffer_width, buffer_height, seam, 1) != 0)
+                log_status = -1;
+        }
+
+        if (parallel) {
+            remove_seam_parallel(current, scratch, buffer_width, buffer_height, channels, seam);
+            unsigned char* previous = current;
+            current = scratch;
+            scratch = previous;
+        } else {
+            remove_seam_sequential(current, current, buffer_width, buffer_height, channels, seam);
+        }
+        SEAM_TRACE_END(removal_span);
+        buffer_width--;
+
+        *width = transposed ? buffer_height : buffer_width;
+        *height = transposed ? buffer_width : buffer_height;
+        SEAM_TRACE_END(iteration_span);
+    }
+
+    if (log_status != 0) {
+        return_to_caller(*image_data, current, (size_t)buffer_width * buffer_height * channels);
+        goto cleanup;
+    }
+
+    // Only one direction is left: orient the buffer so its seams are vertical and take the incremental path
+    int rows_left = *height - target_height;
+    int want_transposed = rows_left > 0;
+    if (want_transposed != transposed) {
+        transpose_buffer(parallel, &current, &scratch, &buffer_width, &buffer_height, channels, tracked);
+        transposed = want_transposed;
+    }
+
+    // Intermediate images of a transposed buffer would come out sideways. Seam priors and histories index
+    // the seams of carve_seams, which this phase does not line up with.
+    carve_options phase = *options;
+    phase.initial_energy = NULL;
+    phase.seam_prior = NULL;
+    phase.seam_history = NULL;
+    if (transposed)
+        phase.save_intermediate = 0;
+
+    // The two-direction stage is done with its tables, so the single-direction carve lays the stage out anew
+    int seams_left = transposed ? rows_left : *width - target_width;
+    if (carve_seams_tracked(carver, &current, &scratch, &buffer_width, buffer_height, channels, seams_left, &phase, tracked, NULL) != 0) {
+        return_to_caller(*image_data, current, (size_t)buffer_width * buffer_height * channels);
+        goto cleanup;
+    }
+
+    if (transposed)
+        transpose_buffer(parallel, &current, &scratch, &buffer_width, &buffer_height, channels, tracked);
+
+    *width = target_width;
+    *height = target_height;
+    return_to_caller(*image_data, current, (size_t)target_width * target_height * channels);
+    status = 0;
+
+cleanup:
+    carver_end(options, carver);
+    SEAM_TRACE_END(carve_span);
+    return status;
+}
+
+// Finds k disjoint seams of the image in its own coordinates. Every pass takes as many disjoint seams as one
+// DP table yields; the tables of later passes leave out every pixel taken so far, so each seam stays connected in
+// the image's coordinates and none crosses an earlier one's pixels. Returns -1 if the seams taken leave no path for
+// another, which takes k close to the width. *seams points into the carver's stage buffer and stays valid until
+// the next stage is laid out.
+static int find_insertion_seams(seam_carver* carver, unsigned char* image_data, int width, int height, int channels, int k, int** seams, const carve_options* options) {
+    int parallel = options->mode == CARVE_MODE_PARALLEL;
+    size_t cells = (size_t)width * height;
+
+    unsigned char* energy_map;
+    int* dp;
+    signed char* backtrack;
+    unsigned char* used;
+    unsigned char* taken;
+    seam_start* order;
+    size_t sizes[] = { cells, cells * sizeof(int), cells, cells, cells, (size_t)width * sizeof(seam_start), (size_t)k * height * sizeof(int) };
+    void** buffers[] = { (void**)&energy_map, (void**)&dp, (void**)&backtrack, (void**)&used, (void**)&taken, (void**)&order, (void**)seams };
+    if (seam_buffer_layout(&carver->stage, sizes, buffers, 7) != 0)
+        return -1;
+
+    // Nothing is removed along the way, so the energy of the image serves every pass
+    SEAM_TRACE_BEGIN(energy_span, TRACE_ENERGY);
+    if (parallel)
+        compute_energy_map_parallel(image_data, width, height, channels, energy_map);
+    else
+        compute_energy_map_sequential(image_data, width, height, channels, energy_map);
+    SEAM_TRACE_END(energy_span);
+    memset(taken, 0, cells);
+
+    for (int pass = 0, total = 0; total < k; pass++) {
+        SEAM_TRACE_BEGIN_INDEX(iteration_span, TRACE_ITERATION, pass);
+        SEAM_TRACE_BEGIN(seam_span, TRACE_SEAM);
+        if (parallel)
+            compute_masked_seam_table_parallel(energy_map, taken, width, height, dp, backtrack);
+        else
+            compute_masked_seam_table_sequential(energy_map, taken, width, height, dp, backtrack);
+
+        int* pass_seams = *seams + (size_t)total * height;
+        int found = find_seams_sequential(dp, backtrack, width, height, k - total, pass_seams, used, order);
+        for (size_t i = 0; i < (size_t)found * height; i++)
+            taken[(i % height) * width + pass_seams[i]] = 1;
+        SEAM_TRACE_END(seam_span);
+        SEAM_TRACE_END(iteration_span);
+
+        if (found == 0) {
+            fprintf(stderr, "Only %d disjoint seams of %d fit into an image %d pixels wide\n", total, k, width);
+            return -1;
+        }
+        total += found;
+    }
+
+    return 0;
+}
+
+// Widens the image by `seams` columns: the lowest-energy seams are found up front and all of them are
+// duplicated (blended with their right neighbour) while the enlarged buffer is built in a single pass
+int enlarge_seams(unsigned char** image_data, int* width, int height, int channels, int seams, const carve_options* options) {
+    if (seams < 0 || seams >= *width) {
+        fprintf(stderr, "Cannot insert %d seams into an image %d pixels wide\n", seams, *width);
+        return -1;
+    }
+    if (seams == 0)
+        return 0;
+
+    SEAM_TRACE_BEGIN(carve_span, TRACE_CARVE);
+    seam_carver temporary;
+    seam_carver* carver = carver_begin(options, &temporary);
+
+    // The wider image goes back to the caller, so it is the one buffer not taken from the carver
+    int* seam_columns;
+    unsigned char* enlarged = malloc((size_t)(*width + seams) * height * channels);
+    if (!enlarged || find_insertion_seams(carver, *image_data, *width, height, channels, seams, &seam_columns, options) != 0) {
+        free(enlarged);
+        carver_end(options, carver);
+        SEAM_TRACE_END(carve_span);
+        return -1;
+    }
+
+    int status = options->mode == CARVE_MODE_PARALLEL
+        ? insert_seams_parallel(*image_data, enlarged, *width, height, channels, seam_columns, seams)
+        : insert_seams_sequential(*image_data, enlarged, *width, height, channels, seam_columns, seams);
+
+    // Inserted seams are already in the input's coordinates
+    if (options->recorded_seams) {
+        for (int s = 0; s < seams && status == 0; s++) {
+            int* columns = seam_columns + (size_t)s * height;
+            for (int y = 0; y < height; y++)
+                columns[y] += y * *width;
+            status = seam_log_append(options->recorded_seams, columns, height);
+        }
+    }
+
+    carver_end(options, carver);
+    if (status == 0) {
+        free(*image_data);
+        *image_data = enlarged;
+        *width += seams;
+    } else {
+        free(enlarged);
+    }
+    SEAM_TRACE_END(carve_span);
+    return status;
+}
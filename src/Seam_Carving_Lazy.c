@@ -0,0 +1,149 @@
+#include "../include/Seam_Carving_Lazy.h"
+
+// Starts with every column alive
+void lazy_columns_init(lazy_columns* columns, uint64_t* alive, int* counts, int width, int height) {
+    int blocks = LAZY_BLOCKS(width);
+    columns->alive = alive;
+    columns->counts = counts;
+    columns->blocks = blocks;
+    columns->width = width;
+    columns->height = height;
+
+    int last_columns = width - (blocks - 1) * LAZY_BLOCK_COLUMNS;
+    uint64_t last_mask = last_columns == LAZY_BLOCK_COLUMNS ? ~0ULL : (1ULL << last_columns) - 1;
+
+    for (int y = 0; y < height; y++) {
+        uint64_t* mask_row = alive + (size_t)y * blocks;
+        int* tree = counts + (size_t)y * blocks;
+
+        // Fenwick tree built in linear time: every node hands its sum on to its parent
+        for (int b = 0; b < blocks; b++) {
+            mask_row[b] = b == blocks - 1 ? last_mask : ~0ULL;
+            tree[b] = b == blocks - 1 ? last_columns : LAZY_BLOCK_COLUMNS;
+        }
+        for (int i = 1; i <= blocks; i++) {
+            int parent = i + (i & -i);
+            if (parent <= blocks)
+                tree[parent - 1] += tree[i - 1];
+        }
+    }
+}
+
+// Position of the r-th (from 0) set bit of mask
+static int select_bit(uint64_t mask, int r) {
+    int base = 0;
+    for (int shift = 32; shift >= 8; shift >>= 1) {
+        uint64_t low = mask & ((1ULL << shift) - 1);
+        int count = __builtin_popcountll(low);
+        if (r >= count) {
+            r -= count;
+            mask >>= shift;
+            base += shift;
+        } else {
+            mask = low;
+        }
+    }
+
+    while (r--)
+        mask &= mask - 1;
+    return base + __builtin_ctzll(mask);
+}
+
+// Original column of the x-th surviving column of row y
+int lazy_columns_original(const lazy_columns* columns, int y, int x) {
+    const int* tree = columns->counts + (size_t)y * columns->blocks;
+    int position = 0;
+    int remaining = x + 1;
+
+    // Descend the tree to the block holding the (x + 1)-th survivor
+    int step = 1;
+    while (step * 2 <= columns->blocks)
+        step *= 2;
+    for (; step > 0; step >>= 1) {
+        if (position + step <= columns->blocks && tree[position + step - 1] < remaining) {
+            position += step;
+            remaining -= tree[position - 1];
+        }
+    }
+
+    uint64_t mask = columns->alive[(size_t)y * columns->blocks + position];
+    return position * LAZY_BLOCK_COLUMNS + select_bit(mask, remaining - 1);
+}
+
+static void lazy_columns_remove(lazy_columns* columns, int y, int original) {
+    int block = original / LAZY_BLOCK_COLUMNS;
+    int* tree = columns->counts + (size_t)y * columns->blocks;
+
+    columns->alive[(size_t)y * columns->blocks + block] &= ~(1ULL << (original % LAZY_BLOCK_COLUMNS));
+    for (int i = block + 1; i <= columns->blocks; i += i & -i)
+        tree[i - 1]--;
+}
+
+// Removes k seams given in current coordinates; all of a row's seams are translated before any is removed,
+// since they were all found in the same image
+void lazy_columns_remove_seams(lazy_columns* columns, int* seams, int k, int* originals) {
+    int height = columns->height;
+
+    for (int y = 0; y < height; y++) {
+        for (int s = 0; s < k; s++)
+            originals[(size_t)s * height + y] = lazy_columns_original(columns, y, seams[(size_t)s * height + y]);
+        for (int s = 0; s < k; s++)
+            lazy_columns_remove(columns, y, originals[(size_t)s * height + y]);
+    }
+}
+
+// Appends the surviving pixels of one row at dst; whole blocks go in one copy. dst never passes the pixel
+// being read, so the byte-wise copy of a single pixel is safe in place.
+static inline __attribute__((always_inline)) unsigned char* gather_row_kernel(const lazy_columns* columns, int y, unsigned char* src, unsigned char* dst, int channels) {
+    const uint64_t* mask_row = columns->alive + (size_t)y * columns->blocks;
+    size_t block_bytes = (size_t)LAZY_BLOCK_COLUMNS * channels;
+
+    for (int b = 0; b < columns->blocks; b++) {
+        uint64_t mask = mask_row[b];
+        unsigned char* block = src + b * block_bytes;
+
+        if (mask == ~0ULL) {
+            memmove(dst, block, block_bytes);
+            dst += block_bytes;
+            continue;
+        }
+        while (mask) {
+            const unsigned char* pixel = block + (size_t)__builtin_ctzll(mask) * channels;
+            for (int c = 0; c < channels; c++)
+                dst[c] = pixel[c];
+            dst += channels;
+            mask &= mask - 1;
+        }
+    }
+
+    return dst;
+}
+
+static unsigned char* gather_row(const lazy_columns* columns, int y, unsigned char* src, unsigned char* dst, int channels) {
+    unsigned char* end;
+    SEAM_SPECIALIZE_CHANNELS(channels, end = gather_row_kernel(columns, y, src, dst, seam_channels));
+    return end;
+}
+
+// Copies the surviving pixels into the carved image; rows only ever move towards the front, so the
+// compaction also works in place
+void gather_columns_sequential(const lazy_columns* columns, unsigned char* image_data, unsigned char* new_image_data, int channels) {
+    size_t row_bytes = (size_t)columns->width * channels;
+    unsigned char* dst = new_image_data;
+
+    for (int y = 0; y < columns->height; y++)
+        dst = gather_row(columns, y, image_data + y * row_bytes, dst, channels);
+}
+
+// Parallelize the gather with OpenMP; every row keeps the same number of columns, so rows are independent
+void gather_columns_parallel(const lazy_columns* columns, unsigned char* image_data, unsigned char* new_image_data, int channels) {
+    size_t row_bytes = (size_t)columns->width * channels;
+    int new_width = 0;
+    for (int b = 0; b < columns->blocks; b++)
+        new_width += __builtin_popcountll(columns->alive[b]);
+    size_t new_row_bytes = (size_t)new_width * channels;
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < columns->height; y++)
+        gather_row(columns, y, image_data + y * row_bytes, new_image_data + y * new_row_bytes, channels);
+}
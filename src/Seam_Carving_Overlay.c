@@ -0,0 +1,80 @@
+#include "../include/Seam_Carving_Overlay.h"
+#include "../include/Seam_Carving_Sequential.h"
+
+void seam_log_init(seam_log* log) {
+    log->pixels = NULL;
+    log->pixel_count = 0;
+    log->pixel_capacity = 0;
+    log->offsets = NULL;
+    log->seam_count = 0;
+    log->seam_capacity = 0;
+}
+
+void seam_log_free(seam_log* log) {
+    free(log->pixels);
+    free(log->offsets);
+    seam_log_init(log);
+}
+
+// Appends one seam given as original pixel indices; the arrays grow geometrically
+int seam_log_append(seam_log* log, const int* pixels, int length) {
+    if (log->pixel_count + length > log->pixel_capacity) {
+        size_t capacity = log->pixel_capacity ? log->pixel_capacity : 4096;
+        while (capacity < log->pixel_count + length)
+            capacity *= 2;
+        int* grown = realloc(log->pixels, capacity * sizeof(int));
+        if (!grown) {
+            perror("Seam log allocation failed");
+            return -1;
+        }
+        log->pixels = grown;
+        log->pixel_capacity = capacity;
+    }
+
+    if (log->seam_count + 2 > log->seam_capacity) {
+        int capacity = log->seam_capacity ? log->seam_capacity * 2 : 64;
+        size_t* grown = realloc(log->offsets, capacity * sizeof(size_t));
+        if (!grown) {
+            perror("Seam log allocation failed");
+            return -1;
+        }
+        log->offsets = grown;
+        log->seam_capacity = capacity;
+    }
+
+    if (log->seam_count == 0)
+        log->offsets[0] = 0;
+    memcpy(log->pixels + log->pixel_count, pixels, length * sizeof(int));
+    log->pixel_count += length;
+    log->seam_count++;
+    log->offsets[log->seam_count] = log->pixel_count;
+    return 0;
+}
+
+// Paints every logged seam onto a copy of the original image and writes it as a single PNG
+void write_seam_overlay(const char* filename, unsigned char* original, int width, int height, int channels, const seam_log* log) {
+    size_t image_bytes = (size_t)width * height * channels;
+    unsigned char* overlay = malloc(image_bytes);
+    if (!overlay) {
+        perror("Overlay allocation failed");
+        return;
+    }
+    memcpy(overlay, original, image_bytes);
+
+    for (int s = 0; s < log->seam_count; s++) {
+        // Removal order runs from red to yellow
+        unsigned char green = log->seam_count > 1 ? (unsigned char)(255 * s / (log->seam_count - 1)) : 0;
+
+        for (size_t p = log->offsets[s]; p < log->offsets[s + 1]; p++) {
+            unsigned char* pixel = overlay + (size_t)log->pixels[p] * channels;
+            pixel[0] = 255;
+            if (channels >= 3) {
+                pixel[1] = green;
+                pixel[2] = 0;
+            }
+        }
+    }
+
+    write_png_sequential(filename, overlay, width, height, channels);
+    free(overlay);
+}
@@ -1,4 +1,5 @@
 #include "../include/Seam_Carving_Parallel.h"
+#include "../include/Seam_Carving_Sequential.h"
 
 // Function to parallelize reading the PNG image
 unsigned char* read_png_parallel(const char* filename, int* width, int* height, int* channels) {
@@ -9,19 +10,30 @@ unsigned char* read_png_parallel(const char* filename, int* width, int* height,
     }
 
     png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png) return NULL;
-
-    png_infop info = png_create_info_struct(png);
-    if (!info) return NULL;
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!info) {
+        png_destroy_read_struct(&png, NULL, NULL);
+        fclose(fp);
+        return NULL;
+    }
 
-    if (setjmp(png_jmpbuf(png))) return NULL;
+    // A corrupt or truncated file jumps back here from anywhere in the decode, so release whatever exists by then
+    unsigned char* volatile image_data = NULL;
+    png_bytep* volatile row_pointers = NULL;
+    if (setjmp(png_jmpbuf(png))) {
+        fprintf(stderr, "Failed to decode PNG: %s\n", filename);
+        free(image_data);
+        free(row_pointers);
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(fp);
+        return NULL;
+    }
 
     png_init_io(png, fp);
     png_read_info(png, info);
 
     *width  = png_get_image_width(png, info);
     *height = png_get_image_height(png, info);
-    *channels = png_get_channels(png, info);
 
     png_byte color_type = png_get_color_type(png, info);
     png_byte bit_depth  = png_get_bit_depth(png, info);
@@ -34,19 +46,25 @@ unsigned char* read_png_parallel(const char* filename, int* width, int* height,
         png_set_expand_gray_1_2_4_to_8(png);
     if (png_get_valid(png, info, PNG_INFO_tRNS))
         png_set_tRNS_to_alpha(png);
+    png_set_interlace_handling(png);
 
     png_read_update_info(png, info);
 
+    // Channels after the expansions, so palette and tRNS images report what actually lands in the buffer
+    *channels = png_get_channels(png, info);
+
     int rowbytes = png_get_rowbytes(png, info);
-    unsigned char* image_data = malloc(rowbytes * (*height));
+    image_data = malloc((size_t)rowbytes * (*height));
     if (!image_data) {
         fclose(fp);
         png_destroy_read_struct(&png, &info, NULL);
         return NULL;
     }
 
-    png_bytep* row_pointers_temp = malloc(sizeof(png_bytep) * (*height));
-    if (!row_pointers_temp) {
+    // libpng decodes straight into the contiguous buffer; staging every row in its own allocation
+    // and copying it over afterwards only added a malloc and a free per row
+    row_pointers = malloc(sizeof(png_bytep) * (*height));
+    if (!row_pointers) {
         free(image_data);
         fclose(fp);
         png_destroy_read_struct(&png, &info, NULL);
@@ -54,197 +72,396 @@ unsigned char* read_png_parallel(const char* filename, int* width, int* height,
     }
 
     for (int y = 0; y < *height; y++)
-        row_pointers_temp[y] = malloc(rowbytes);
+        row_pointers[y] = image_data + (size_t)y * rowbytes;
 
-    png_read_image(png, row_pointers_temp);
+    png_read_image(png, row_pointers);
 
-    // Parallel copy into contiguous image_data using OMP tasks
-    #pragma omp parallel
-    {
-        #pragma omp single nowait
-        for (int y = 0; y < *height; y++) {
-            #pragma omp task firstprivate(y)
-            {
-                memcpy(image_data + y * rowbytes, row_pointers_temp[y], rowbytes);
-                free(row_pointers_temp[y]);  // Free temporary row buffer
-            }
-        }
-    }
-
-    free(row_pointers_temp);
+    free(row_pointers);
     fclose(fp);
     png_destroy_read_struct(&png, &info, NULL);
 
     return image_data;
 }
 
-// Parallelize image writing using OpenMP
+// Image writing for the parallel back end. The rows go to libpng straight from the buffer, so there is no
+// repacking left to spread across threads and libpng encodes them in order on the calling thread.
 void write_png_parallel(const char* filename, unsigned char* image_data, int width, int height, int channels) {
-    // Lock to ensure only one thread writes to the file at a time
-    #pragma omp critical
-    {
-        FILE* fp = fopen(filename, "wb");
-        if (!fp) {
-            perror("File opening failed");
-            
-        }
+    write_png_with_settings(filename, image_data, width, height, channels, NULL);
+}
 
-        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-        if (!png) {
-            perror("png_create_write_struct failed");
-            fclose(fp);
-           
-        }
+// Parallelize energy map computation using OpenMP
+void compute_energy_map_parallel(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_map) {
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++)
+        compute_energy_row(image_data, width, height, channels, y, 0, width, energy_map + (size_t)y * width);
+}
 
-        png_infop info = png_create_info_struct(png);
-        if (!info) {
-            perror("png_create_info_struct failed");
-            fclose(fp);
-            png_destroy_write_struct(&png, NULL);
-          
-        }
+// Parallelize the incremental energy update with OpenMP; the maps must not overlap
+void update_energy_map_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, unsigned char* energy_map, unsigned char* new_energy_map) {
+    remove_seam_parallel(energy_map, new_energy_map, width + 1, height, 1, seam);
 
-        if (setjmp(png_jmpbuf(png))) {
-            perror("Error during PNG creation");
-            fclose(fp);
-            png_destroy_write_struct(&png, &info);
-        }
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; y++) {
+        int x_begin, x_end;
+        energy_update_band(seam, width, height, y, &x_begin, &x_end);
+        compute_energy_row(image_data, width, height, channels, y, x_begin, x_end, new_energy_map + (size_t)y * width);
+    }
+}
 
-        png_init_io(png, fp);
-        png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_DEFAULT);
-        png_write_info(png, info);
+// Candidate for the bottom-row argmin; ties resolve to the lowest column like the sequential scan
+typedef struct {
+    int energy;
+    int x;
+} seam_candidate;
 
-        png_bytep row = (png_byte*) malloc(3 * width * sizeof(png_byte));
+static inline seam_candidate seam_candidate_min(seam_candidate a, seam_candidate b) {
+    if (b.energy < a.energy || (b.energy == a.energy && b.x < a.x))
+        return b;
+    return a;
+}
 
-        #pragma omp parallel for
-        for (int y = 0; y < height; y++) {
+#pragma omp declare reduction(seam_min : seam_candidate : omp_out = seam_candidate_min(omp_out, omp_in)) \
+    initializer(omp_priv = (seam_candidate){ INT_MAX, INT_MAX })
+
+// Parallelize the cumulative-cost table with OpenMP
+void compute_seam_table_parallel(unsigned char* energy_map, int width, int height, int* dp, signed char* backtrack) {
+    // One team lives for the whole table; rows stay ordered through the barrier at the end of each
+    // worksharing loop, and the static schedule hands every thread the same columns on every row
+    #pragma omp parallel if (width >= SEAM_PARALLEL_MIN_WIDTH)
+    {
+        #pragma omp for schedule(static)
+        for (int x = 0; x < width; x++) {
+            dp[x] = energy_map[x];
+            backtrack[x] = 0;
+        }
+
+        for (int y = 1; y < height; y++) {
+            int* prev_row = dp + (size_t)(y - 1) * width;
+
+            #pragma omp for schedule(static)
             for (int x = 0; x < width; x++) {
-                row[x * 3 + 0] = image_data[(y * width + x) * channels];     
-                row[x * 3 + 1] = image_data[(y * width + x) * channels + 1]; 
-                row[x * 3 + 2] = image_data[(y * width + x) * channels + 2]; 
+                int min_energy = prev_row[x];
+                int best_step = 0;
+
+                if (x > 0 && prev_row[x - 1] < min_energy) {
+                    min_energy = prev_row[x - 1];
+                    best_step = -1;
+                }
+
+                if (x < width - 1 && prev_row[x + 1] < min_energy) {
+                    min_energy = prev_row[x + 1];
+                    best_step = 1;
+                }
+
+                size_t idx = (size_t)y * width + x;
+                dp[idx] = energy_map[idx] + min_energy;
+                backtrack[idx] = best_step;
             }
-            png_write_row(png, row);
         }
-
-        free(row);
-        png_write_end(png, NULL);
-        fclose(fp);
-        png_destroy_write_struct(&png, &info);
     }
 }
 
-// Parallelize energy map computation using OpenMP
-void compute_energy_map_parallel(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_map) {
-    #pragma omp parallel for collapse(2)
-    for (int y = 1; y < height - 1; y++) {
-        for (int x = 1; x < width - 1; x++) {
-            int gx = 0, gy = 0;
-
-            for (int j = -1; j <= 1; j++) {
-                for (int i = -1; i <= 1; i++) {
-                    int pixel = (y + j) * width + (x + i);
-                    gx += image_data[pixel * channels] * (i);   
-                    gy += image_data[pixel * channels] * (j);   
+// Parallelize the masked seam table with OpenMP the same way, one team for all rows
+void compute_masked_seam_table_parallel(unsigned char* energy_map, const unsigned char* taken, int width, int height, int* dp, signed char* backtrack) {
+    #pragma omp parallel if (width >= SEAM_PARALLEL_MIN_WIDTH)
+    {
+        #pragma omp for schedule(static)
+        for (int x = 0; x < width; x++) {
+            dp[x] = taken[x] ? INT_MAX : energy_map[x];
+            backtrack[x] = 0;
+        }
+
+        for (int y = 1; y < height; y++) {
+            int* prev_row = dp + (size_t)(y - 1) * width;
+
+            #pragma omp for schedule(static)
+            for (int x = 0; x < width; x++) {
+                int min_energy = prev_row[x];
+                int best_step = 0;
+
+                if (x > 0 && prev_row[x - 1] < min_energy) {
+                    min_energy = prev_row[x - 1];
+                    best_step = -1;
+                }
+
+                if (x < width - 1 && prev_row[x + 1] < min_energy) {
+                    min_energy = prev_row[x + 1];
+                    best_step = 1;
                 }
-            }
 
-            int energy = sqrt(gx * gx + gy * gy);
-            energy_map[y * width + x] = energy;
+                size_t idx = (size_t)y * width + x;
+                dp[idx] = taken[idx] || min_energy == INT_MAX ? INT_MAX : energy_map[idx] + min_energy;
+                backtrack[idx] = best_step;
+            }
         }
     }
 }
 
-// Parallelize seam computation with OpenMP
-void compute_seam_parallel(unsigned char* energy_map, int width, int height, int* seam) {
-    int* dp = malloc(width * height * sizeof(int));
-    int* backtrack = malloc(width * height * sizeof(int));
+// Parallelize the bottom-row argmin with OpenMP; the backtrack itself is a serial chain of height steps
+void trace_seam_parallel(int* dp, signed char* backtrack, int width, int height, int* seam) {
+    int* last_row = dp + (size_t)(height - 1) * width;
+    seam_candidate best = { INT_MAX, INT_MAX };
 
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(static) reduction(seam_min : best) if (width >= SEAM_PARALLEL_MIN_WIDTH)
     for (int x = 0; x < width; x++) {
-        dp[x] = energy_map[x];  
-        backtrack[x] = -1;
+        seam_candidate candidate = { last_row[x], x };
+        best = seam_candidate_min(best, candidate);
     }
 
-    #pragma omp parallel for collapse(2)
-    for (int y = 1; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int min_energy = dp[(y - 1) * width + x];
-            int best_x = x;
+    int best_x = best.x;
+    for (int y = height - 1; y >= 0; y--) {
+        seam[y] = best_x;
+        best_x += backtrack[(size_t)y * width + best_x];
+    }
+}
 
-            if (x > 0 && dp[(y - 1) * width + x - 1] < min_energy) {
-                min_energy = dp[(y - 1) * width + x - 1];
-                best_x = x - 1;
-            }
+// Parallelize the table shift with OpenMP; the cone below the seam is narrow, so it is refreshed serially
+void update_seam_table_parallel(unsigned char* energy_map, int width, int height, int* seam, int* dp, signed char* backtrack, int* new_dp, signed char* new_backtrack) {
+    remove_seam_parallel((unsigned char*)dp, (unsigned char*)new_dp, width + 1, height, sizeof(int), seam);
+    remove_seam_parallel((unsigned char*)backtrack, (unsigned char*)new_backtrack, width + 1, height, 1, seam);
+    refresh_seam_table(energy_map, width, height, seam, new_dp, new_backtrack);
+}
+
+// Parallelize the rolling-row seam search with OpenMP; threads split each row into blocks of
+// SEAM_ROW_BLOCK_COLUMNS columns, a multiple of four, so that every packed step byte has a single writer
+void compute_seam_compact_parallel(unsigned char* energy_map, int width, int height, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    int blocks = (width + SEAM_ROW_BLOCK_COLUMNS - 1) / SEAM_ROW_BLOCK_COLUMNS;
+    seam_candidate best = { INT_MAX, INT_MAX };
 
-            if (x < width - 1 && dp[(y - 1) * width + x + 1] < min_energy) {
-                min_energy = dp[(y - 1) * width + x + 1];
-                best_x = x + 1;
+    #pragma omp parallel if (width >= SEAM_PARALLEL_MIN_WIDTH)
+    {
+        #pragma omp for schedule(static)
+        for (int x = 0; x < width; x++)
+            cost_rows[x] = energy_map[x];
+
+        for (int y = 1; y < height; y++) {
+            #pragma omp for schedule(static)
+            for (int block = 0; block < blocks; block++) {
+                int x_begin = block * SEAM_ROW_BLOCK_COLUMNS;
+                int x_end = x_begin + SEAM_ROW_BLOCK_COLUMNS < width ? x_begin + SEAM_ROW_BLOCK_COLUMNS : width;
+                seam_compact_row(energy_map + (size_t)y * width, width, y, cost_rows, steps, x_begin, x_end);
             }
+        }
+
+        uint32_t* last_row = cost_rows + (size_t)((height - 1) & 1) * width;
 
-            dp[y * width + x] = energy_map[y * width + x] + min_energy;
-            backtrack[y * width + x] = best_x;
+        #pragma omp for schedule(static) reduction(seam_min : best)
+        for (int x = 0; x < width; x++) {
+            seam_candidate candidate = { (int)last_row[x], x };
+            best = seam_candidate_min(best, candidate);
         }
     }
 
-    int min_energy = dp[(height - 1) * width];
-    int best_x = 0;
+    trace_packed_steps(steps, width, height, best.x, seam);
+}
+
+// Parallelize the fused energy + seam search with OpenMP; every thread computes the energy of its own blocks of
+// SEAM_ROW_BLOCK_COLUMNS columns and runs the DP on them while they are still in L1, so a row costs a single
+// barrier and the energy never leaves the thread that produced it
+void compute_seam_fused_parallel(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_row, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    int blocks = (width + SEAM_ROW_BLOCK_COLUMNS - 1) / SEAM_ROW_BLOCK_COLUMNS;
+    seam_candidate best = { INT_MAX, INT_MAX };
 
-    #pragma omp parallel for
-    for (int x = 1; x < width; x++) {
-        if (dp[(height - 1) * width + x] < min_energy) {
-            min_energy = dp[(height - 1) * width + x];
-            best_x = x;
+    #pragma omp parallel if (width >= SEAM_PARALLEL_MIN_WIDTH)
+    {
+        #pragma omp for schedule(static)
+        for (int block = 0; block < blocks; block++) {
+            int x_begin = block * SEAM_ROW_BLOCK_COLUMNS;
+            int x_end = x_begin + SEAM_ROW_BLOCK_COLUMNS < width ? x_begin + SEAM_ROW_BLOCK_COLUMNS : width;
+            compute_energy_row(image_data, width, height, channels, 0, x_begin, x_end, energy_row);
+            for (int x = x_begin; x < x_end; x++)
+                cost_rows[x] = energy_row[x];
+        }
+
+        for (int y = 1; y < height; y++) {
+            #pragma omp for schedule(static)
+            for (int block = 0; block < blocks; block++) {
+                int x_begin = block * SEAM_ROW_BLOCK_COLUMNS;
+                int x_end = x_begin + SEAM_ROW_BLOCK_COLUMNS < width ? x_begin + SEAM_ROW_BLOCK_COLUMNS : width;
+                compute_energy_row(image_data, width, height, channels, y, x_begin, x_end, energy_row);
+                seam_compact_row(energy_row, width, y, cost_rows, steps, x_begin, x_end);
+            }
+        }
+
+        uint32_t* last_row = cost_rows + (size_t)((height - 1) & 1) * width;
+
+        #pragma omp for schedule(static) reduction(seam_min : best)
+        for (int x = 0; x < width; x++) {
+            seam_candidate candidate = { (int)last_row[x], x };
+            best = seam_candidate_min(best, candidate);
         }
     }
 
-    #pragma omp parallel for
-    for (int y = height - 1; y >= 0; y--) {
-        seam[y] = best_x;
-        best_x = backtrack[y * width + best_x];
+    trace_packed_steps(steps, width, height, best.x, seam);
+}
+
+// Parallelize the forward-energy search with OpenMP; threads take blocks of SEAM_ROW_BLOCK_COLUMNS columns of
+// every row, as in the rolling-row search, with one barrier per row
+void compute_seam_forward_parallel(unsigned char* image_data, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    int blocks = (width + SEAM_ROW_BLOCK_COLUMNS - 1) / SEAM_ROW_BLOCK_COLUMNS;
+    seam_candidate best = { INT_MAX, INT_MAX };
+
+    #pragma omp parallel if (width >= SEAM_PARALLEL_MIN_WIDTH)
+    {
+        for (int y = 0; y < height; y++) {
+            #pragma omp for schedule(static)
+            for (int block = 0; block < blocks; block++) {
+                int x_begin = block * SEAM_ROW_BLOCK_COLUMNS;
+                int x_end = x_begin + SEAM_ROW_BLOCK_COLUMNS < width ? x_begin + SEAM_ROW_BLOCK_COLUMNS : width;
+                seam_forward_row(image_data, width, channels, y, cost_rows, steps, x_begin, x_end);
+            }
+        }
+
+        uint32_t* last_row = cost_rows + (size_t)((height - 1) & 1) * width;
+
+        #pragma omp for schedule(static) reduction(seam_min : best)
+        for (int x = 0; x < width; x++) {
+            seam_candidate candidate = { (int)last_row[x], x };
+            best = seam_candidate_min(best, candidate);
+        }
     }
 
-    free(dp);
-    free(backtrack);
+    trace_packed_steps(steps, width, height, best.x, seam);
 }
 
-// Parallelize seam highlighting with OpenMP
-void highlight_seam_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename) {
-    unsigned char* highlighted_image = malloc(width * height * channels);
-    memcpy(highlighted_image, image_data, width * height * channels);
+// Parallelize seam computation with OpenMP
+int compute_seam_parallel(unsigned char* energy_map, int width, int height, int* seam) {
+    uint32_t* cost_rows = malloc(2 * (size_t)width * sizeof(uint32_t));
+    unsigned char* steps = malloc((size_t)height * SEAM_STEP_ROW_BYTES(width));
+    int status = cost_rows && steps ? 0 : -1;
+    if (status == 0)
+        compute_seam_compact_parallel(energy_map, width, height, cost_rows, steps, seam);
+    else
+        perror("Seam search allocation failed");
+
+    free(cost_rows);
+    free(steps);
+    return status;
+}
+
+// Parallelize the blocked transpose with OpenMP; every tile row is independent
+void transpose_image_parallel(unsigned char* image_data, unsigned char* transposed, int width, int height, int channels) {
+    #pragma omp parallel for schedule(static)
+    for (int ty = 0; ty < height; ty += TRANSPOSE_TILE)
+        transpose_tile_row(image_data, transposed, width, height, channels, ty);
+}
+
+// Parallelize in-memory seam removal with OpenMP; rows are independent, so the buffers must not overlap
+void remove_seam_parallel(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seam) {
+    size_t row_bytes = (size_t)width * channels;
+    size_t new_row_bytes = (size_t)(width - 1) * channels;
 
     #pragma omp parallel for
     for (int y = 0; y < height; ++y) {
         int seam_x = seam[y];
-        int idx = (y * width + seam_x) * channels;
-        highlighted_image[idx] = 255;       
-        highlighted_image[idx + 1] = 0;     
-        highlighted_image[idx + 2] = 0;     
+        unsigned char* src = image_data + y * row_bytes;
+        unsigned char* dst = new_image_data + y * new_row_bytes;
+        memcpy(dst, src, (size_t)seam_x * channels);
+        memcpy(dst + (size_t)seam_x * channels, src + (size_t)(seam_x + 1) * channels, (size_t)(width - seam_x - 1) * channels);
     }
+}
 
-    write_png_parallel(output_filename, highlighted_image, width, height, channels);
-    free(highlighted_image);
+static int compare_columns(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
 }
 
-// Parallelize seam removal with OpenMP
-void remove_and_save_seam_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename) {
-    unsigned char* new_image_data = malloc((width - 1) * height * channels);
+// Parallelize multi-seam removal with OpenMP; the buffers must not overlap. Returns -1 if a thread cannot
+// allocate its column buffer, in which case that thread's rows are left unwritten.
+int remove_seams_parallel(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k) {
+    int status = 0;
+    size_t row_bytes = (size_t)width * channels;
+    size_t new_row_bytes = (size_t)(width - k) * channels;
 
-    #pragma omp parallel for
-    for (int y = 0; y < height; ++y) {
-        int seam_x = seam[y];
-        for (int x = 0; x < seam_x; ++x) {
-            int src_idx = (y * width + x) * channels;
-            int dst_idx = (y * (width - 1) + x) * channels;
-            memcpy(&new_image_data[dst_idx], &image_data[src_idx], channels);
+    #pragma omp parallel
+    {
+        int stack_columns[SEAM_COLUMNS_ON_STACK + 1];
+        int* columns = k <= SEAM_COLUMNS_ON_STACK ? stack_columns : malloc(((size_t)k + 1) * sizeof(int));
+        if (!columns) {
+            perror("Seam column allocation failed");
+            #pragma omp atomic write
+            status = -1;
+        }
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            if (!columns)
+                continue;
+            for (int s = 0; s < k; s++)
+                columns[s] = seams[(size_t)s * height + y];
+            qsort(columns, k, sizeof(int), compare_columns);
+            columns[k] = width;
+
+            unsigned char* src = image_data + y * row_bytes;
+            unsigned char* dst = new_image_data + y * new_row_bytes;
+            memcpy(dst, src, (size_t)columns[0] * channels);
+            dst += (size_t)columns[0] * channels;
+            for (int s = 0; s < k; s++) {
+                size_t run = (size_t)(columns[s + 1] - columns[s] - 1) * channels;
+                memcpy(dst, src + (size_t)(columns[s] + 1) * channels, run);
+                dst += run;
+            }
+        }
+
+        if (columns != stack_columns)
+            free(columns);
+    }
+    return status;
+}
+
+// Parallelize seam insertion with OpenMP; every output row is built independently. Returns -1 like
+// remove_seams_parallel.
+int insert_seams_parallel(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k) {
+    int status = 0;
+    #pragma omp parallel
+    {
+        int stack_columns[SEAM_COLUMNS_ON_STACK + 1];
+        int* columns = k <= SEAM_COLUMNS_ON_STACK ? stack_columns : malloc(((size_t)k + 1) * sizeof(int));
+        if (!columns) {
+            perror("Seam column allocation failed");
+            #pragma omp atomic write
+            status = -1;
         }
-        for (int x = seam_x + 1; x < width; ++x) {
-            int src_idx = (y * width + x) * channels;
-            int dst_idx = (y * (width - 1) + (x - 1)) * channels;
-            memcpy(&new_image_data[dst_idx], &image_data[src_idx], channels);
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            if (!columns)
+                continue;
+            for (int s = 0; s < k; s++)
+                columns[s] = seams[(size_t)s * height + y];
+            qsort(columns, k, sizeof(int), compare_columns);
+            columns[k] = width;
+
+            unsigned char* src = image_data + (size_t)y * width * channels;
+            unsigned char* dst = new_image_data + (size_t)y * (width + k) * channels;
+            int x = 0;
+            for (int s = 0; s <= k; s++) {
+                int run_end = s < k ? columns[s] + 1 : width;
+                memcpy(dst, src + (size_t)x * channels, (size_t)(run_end - x) * channels);
+                dst += (size_t)(run_end - x) * channels;
+                x = run_end;
+                if (s == k)
+                    break;
+
+                unsigned char* left = src + (size_t)columns[s] * channels;
+                unsigned char* right = columns[s] + 1 < width ? left + channels : left;
+                for (int c = 0; c < channels; c++)
+                    dst[c] = (left[c] + right[c]) / 2;
+                dst += channels;
+            }
         }
+
+        if (columns != stack_columns)
+            free(columns);
     }
+    return status;
+}
+
+// Parallelize seam removal with OpenMP
+void remove_and_save_seam_parallel(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename) {
+    unsigned char* new_image_data = malloc((width - 1) * height * channels);
+
+    remove_seam_parallel(image_data, new_image_data, width, height, channels, seam);
 
     write_png_parallel(output_filename, new_image_data, width - 1, height, channels);
     free(new_image_data);
 }
-
@@ -0,0 +1,228 @@
+#include "../include/Seam_Carving_Pyramid.h"
+
+// Cost of cells the band does not connect to the top row
+#define PYRAMID_UNREACHABLE UINT32_MAX
+
+// Where each level lives inside the caller's workspace; level 0 is the caller's energy map and seam
+typedef struct {
+    int levels;
+    int band;
+    int widths[PYRAMID_MAX_LEVELS + 1];
+    int heights[PYRAMID_MAX_LEVELS + 1];
+    unsigned char* energy[PYRAMID_MAX_LEVELS + 1];
+    int* seams[PYRAMID_MAX_LEVELS + 1];
+    uint32_t* cost_rows;            // Rolling rows of the exact search at the coarsest level
+    unsigned char* steps;
+    uint32_t* band_rows;            // Rolling rows of the banded search, 2 * band_span
+    signed char* band_steps;        // height * band_span steps of the finest level, reused by coarser ones
+} pyramid_layout;
+
+int seam_pyramid_levels(int width, int levels) {
+    int used = 0;
+    while (used < levels && used < PYRAMID_MAX_LEVELS && (width + 1) / 2 >= PYRAMID_MIN_WIDTH) {
+        width = (width + 1) / 2;
+        used++;
+    }
+    return used;
+}
+
+// Columns of one band row
+static int band_span(int band) {
+    return 2 * band + 2;
+}
+
+static size_t align_workspace(size_t bytes) {
+    return (bytes + WORKSPACE_ALIGNMENT - 1) / WORKSPACE_ALIGNMENT * WORKSPACE_ALIGNMENT;
+}
+
+// Sizes every level and, when workspace is not NULL, points the layout into it; returns the bytes used
+static size_t pyramid_layout_init(pyramid_layout* layout, unsigned char* energy_map, int width, int height, int levels, int band, unsigned char* workspace, int* seam) {
+    layout->levels = seam_pyramid_levels(width, levels);
+    layout->band = band < 1 ? 1 : band;
+    layout->widths[0] = width;
+    layout->heights[0] = height;
+    layout->energy[0] = energy_map;
+    layout->seams[0] = seam;
+
+    size_t offset = 0;
+    for (int level = 1; level <= layout->levels; level++) {
+        int w = (layout->widths[level - 1] + 1) / 2;
+        int h = (layout->heights[level - 1] + 1) / 2;
+        layout->widths[level] = w;
+        layout->heights[level] = h;
+        if (workspace)
+            layout->energy[level] = workspace + offset;
+        offset += align_workspace((size_t)w * h);
+        if (workspace)
+            layout->seams[level] = (int*)(workspace + offset);
+        offset += align_workspace((size_t)h * sizeof(int));
+    }
+
+    int coarse_width = layout->widths[layout->levels];
+    int coarse_height = layout->heights[layout->levels];
+    int span = band_span(layout->band);
+    size_t sizes[] = {
+        2 * (size_t)coarse_width * sizeof(uint32_t),
+        (size_t)coarse_height * SEAM_STEP_ROW_BYTES(coarse_width),
+        layout->levels > 0 ? 2 * (size_t)span * sizeof(uint32_t) : 0,
+        layout->levels > 0 ? (size_t)height * span : 0,
+    };
+    void** buffers[] = {
+        (void**)&layout->cost_rows, (void**)&layout->steps, (void**)&layout->band_rows, (void**)&layout->band_steps,
+    };
+    for (int i = 0; i < 4; i++) {
+        if (workspace)
+            *buffers[i] = workspace + offset;
+        offset += align_workspace(sizes[i]);
+    }
+    return offset;
+}
+
+size_t seam_pyramid_bytes(int width, int height, int levels, int band) {
+    pyramid_layout layout;
+    return pyramid_layout_init(&layout, NULL, width, height, levels, band, NULL, NULL);
+}
+
+// Shrinks the fine map into rows [y_begin, y_end) of the coarse one. A seam crosses only one column of each
+// pair, so a coarse cell keeps the cheaper column of each of its two rows and averages the rows; an odd last
+// row or column pairs with itself.
+static void downsample_energy_rows(const unsigned char* fine, int width, int height, unsigned char* coarse, int y_begin, int y_end) {
+    int coarse_width = (width + 1) / 2;
+    int half = width / 2;
+
+    for (int y = y_begin; y < y_end; y++) {
+        const unsigned char* row0 = fine + (size_t)(2 * y) * width;
+        const unsigned char* row1 = 2 * y + 1 < height ? row0 + width : row0;
+        unsigned char* out = coarse + (size_t)y * coarse_width;
+
+        for (int x = 0; x < half; x++) {
+            int top = row0[2 * x] < row0[2 * x + 1] ? row0[2 * x] : row0[2 * x + 1];
+            int bottom = row1[2 * x] < row1[2 * x + 1] ? row1[2 * x] : row1[2 * x + 1];
+            out[x] = (unsigned char)((top + bottom + 1) >> 1);
+        }
+        if (width & 1)
+            out[half] = (unsigned char)((row0[width - 1] + row1[width - 1] + 1) >> 1);
+    }
+}
+
+// Columns [begin, end) of fine row y that the band around the guide seam covers; the guide is `scale` times
+// coarser than the map (2 between pyramid levels, 1 for a guide of the same size)
+static void band_columns(const int* guide, int scale, int width, int band, int y, int* begin, int* end) {
+    int center = scale * guide[y / scale];
+    *begin = center - band > 0 ? center - band : 0;
+    *end = center + scale + band < width ? center + scale + band : width;
+}
+
+// Exact seam DP restricted to the band around the scaled-up guide seam, with the same tie-breaking as the
+// full search (straight down first, then left, then right)
+static void refine_seam(const unsigned char* energy_map, int width, int height, const int* guide, int scale, int band, uint32_t* rows, signed char* steps, int* seam) {
+    int span = band_span(band);
+    uint32_t* prev_row = rows;
+    uint32_t* row = rows + span;
+
+    int prev_begin, prev_end;
+    band_columns(guide, scale, width, band, 0, &prev_begin, &prev_end);
+    for (int x = prev_begin; x < prev_end; x++)
+        prev_row[x - prev_begin] = energy_map[x];
+
+    for (int y = 1; y < height; y++) {
+        int begin, end;
+        band_columns(guide, scale, width, band, y, &begin, &end);
+        const unsigned char* energy_row = energy_map + (size_t)y * width;
+        signed char* step_row = steps + (size_t)y * span;
+
+        for (int x = begin; x < end; x++) {
+            uint32_t min_energy = x >= prev_begin && x < prev_end ? prev_row[x - prev_begin] : PYRAMID_UNREACHABLE;
+            int best_step = 0;
+
+            if (x - 1 >= prev_begin && x - 1 < prev_end && prev_row[x - 1 - prev_begin] < min_energy) {
+                min_energy = prev_row[x - 1 - prev_begin];
+                best_step = -1;
+            }
+
+            if (x + 1 >= prev_begin && x + 1 < prev_end && prev_row[x + 1 - prev_begin] < min_energy) {
+                min_energy = prev_row[x + 1 - prev_begin];
+                best_step = 1;
+            }
+
+            row[x - begin] = min_energy == PYRAMID_UNREACHABLE ? PYRAMID_UNREACHABLE : min_energy + energy_row[x];
+            step_row[x - begin] = (signed char)best_step;
+        }
+
+        uint32_t* previous = prev_row;
+        prev_row = row;
+        row = previous;
+        prev_begin = begin;
+        prev_end = end;
+    }
+
+    // A guide moves at most one column per row, so consecutive bands overlap and the bottom row always has a
+    // reachable cell
+    int x = prev_begin;
+    for (int candidate = prev_begin + 1; candidate < prev_end; candidate++) {
+        if (prev_row[candidate - prev_begin] < prev_row[x - prev_begin])
+            x = candidate;
+    }
+
+    for (int y = height - 1; y > 0; y--) {
+        int begin, end;
+        band_columns(guide, scale, width, band, y, &begin, &end);
+        seam[y] = x;
+        x += steps[(size_t)y * span + (x - begin)];
+    }
+    seam[0] = x;
+}
+
+// Refines the coarsest seam level by level down to the caller's seam
+static void refine_levels(const pyramid_layout* layout) {
+    for (int level = layout->levels - 1; level >= 0; level--) {
+        refine_seam(layout->energy[level], layout->widths[level], layout->heights[level], layout->seams[level + 1], 2,
+                    layout->band, layout->band_rows, layout->band_steps, layout->seams[level]);
+    }
+}
+
+// Builds the pyramid, searches the coarsest level exactly and refines the seam back to full resolution
+void compute_seam_pyramid_sequential(unsigned char* energy_map, int width, int height, int levels, int band, void* workspace, int* seam) {
+    pyramid_layout layout;
+    pyramid_layout_init(&layout, energy_map, width, height, levels, band, workspace, seam);
+
+    for (int level = 1; level <= layout.levels; level++)
+        downsample_energy_rows(layout.energy[level - 1], layout.widths[level - 1], layout.heights[level - 1], layout.energy[level], 0, layout.heights[level]);
+
+    int coarsest = layout.levels;
+    compute_seam_compact_sequential(layout.energy[coarsest], layout.widths[coarsest], layout.heights[coarsest], layout.cost_rows, layout.steps, layout.seams[coarsest]);
+    refine_levels(&layout);
+}
+
+// Parallelize the pyramid construction and the coarse search with OpenMP; the banded refinement touches
+// only a few columns per row and stays on one thread
+void compute_seam_pyramid_parallel(unsigned char* energy_map, int width, int height, int levels, int band, void* workspace, int* seam) {
+    pyramid_layout layout;
+    pyramid_layout_init(&layout, energy_map, width, height, levels, band, workspace, seam);
+
+    #pragma omp parallel if (width >= SEAM_PARALLEL_MIN_WIDTH)
+    {
+        for (int level = 1; level <= layout.levels; level++) {
+            #pragma omp for schedule(static)
+            for (int y = 0; y < layout.heights[level]; y++)
+                downsample_energy_rows(layout.energy[level - 1], layout.widths[level - 1], layout.heights[level - 1], layout.energy[level], y, y + 1);
+        }
+    }
+
+    int coarsest = layout.levels;
+    compute_seam_compact_parallel(layout.energy[coarsest], layout.widths[coarsest], layout.heights[coarsest], layout.cost_rows, layout.steps, layout.seams[coarsest]);
+    refine_levels(&layout);
+}
+
+size_t seam_guided_bytes(int height, int band) {
+    int span = band_span(band < 1 ? 1 : band);
+    return align_workspace(2 * (size_t)span * sizeof(uint32_t)) + align_workspace((size_t)height * span);
+}
+
+// Runs the banded refinement once, around a guide of the map's own size
+void compute_seam_guided(const unsigned char* energy_map, int width, int height, const int* guide, int band, void* workspace, int* seam) {
+    band = band < 1 ? 1 : band;
+    uint32_t* rows = workspace;
+    signed char* steps = (signed char*)workspace + align_workspace(2 * (size_t)band_span(band) * sizeof(uint32_t));
+    refine_seam(energy_map, width, height, guide, 1, band, rows, steps, seam);
+}
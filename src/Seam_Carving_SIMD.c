@@ -0,0 +1,393 @@
+#include "../include/Seam_Carving_SIMD.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SEAM_X86 1
+#endif
+
+// Columns deinterleaved per step when the image has more than one channel
+#define ENERGY_CHUNK 512
+
+// Energy of a pixel from its gradients; the int -> unsigned char store wraps exactly like the original kernel
+static inline unsigned char energy_from_gradient(int gx, int gy) {
+    int energy = sqrt(gx * gx + gy * gy);
+    return energy;
+}
+
+// Energy of a single pixel with neighbours clamped to the image border
+unsigned char compute_energy_pixel(const unsigned char* image_data, int width, int height, int channels, int x, int y) {
+    int gx = 0, gy = 0;
+
+    for (int j = -1; j <= 1; j++) {
+        int py = y + j < 0 ? 0 : (y + j >= height ? height - 1 : y + j);
+        for (int i = -1; i <= 1; i++) {
+            int px = x + i < 0 ? 0 : (x + i >= width ? width - 1 : x + i);
+            int pixel = py * width + px;
+            gx += image_data[(size_t)pixel * channels] * (i);
+            gy += image_data[(size_t)pixel * channels] * (j);
+        }
+    }
+
+    return energy_from_gradient(gx, gy);
+}
+
+// Scalar fallback and tail handler for every vector kernel
+static void energy_span_scalar(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* out, int count) {
+    for (int x = 0; x < count; x++) {
+        int gx = (above[x + 1] - above[x - 1]) + (row[x + 1] - row[x - 1]) + (below[x + 1] - below[x - 1]);
+        int gy = (below[x - 1] + below[x] + below[x + 1]) - (above[x - 1] + above[x] + above[x + 1]);
+        out[x] = energy_from_gradient(gx, gy);
+    }
+}
+
+#ifdef SEAM_X86
+
+// gx*gx + gy*gy is below 2^24, so the single-precision square root truncates to the same integer as libm's
+__attribute__((target("sse4.1")))
+static inline __m128i sse_magnitude(__m128i gx, __m128i gy, int high) {
+    __m128i pairs = high ? _mm_unpackhi_epi16(gx, gy) : _mm_unpacklo_epi16(gx, gy);
+    __m128i squares = _mm_madd_epi16(pairs, pairs);
+    __m128i energy = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(squares)));
+    return _mm_and_si128(energy, _mm_set1_epi32(0xFF));
+}
+
+// 8 pixels as 16-bit lanes
+__attribute__((target("sse4.1")))
+static inline __m128i sse_words(const unsigned char* p) {
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p));
+}
+
+// Energy of 8 pixels as 16-bit lanes; |gx|, |gy| <= 765 so the gradients fit in 16 bits
+__attribute__((target("sse4.1")))
+static inline __m128i sse_energy8(const unsigned char* above, const unsigned char* row, const unsigned char* below) {
+    __m128i al = sse_words(above - 1), ac = sse_words(above), ar = sse_words(above + 1);
+    __m128i rl = sse_words(row - 1), rr = sse_words(row + 1);
+    __m128i bl = sse_words(below - 1), bc = sse_words(below), br = sse_words(below + 1);
+
+    __m128i gx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(ar, rr), br), _mm_add_epi16(_mm_add_epi16(al, rl), bl));
+    __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(bl, bc), br), _mm_add_epi16(_mm_add_epi16(al, ac), ar));
+
+    return _mm_packus_epi32(sse_magnitude(gx, gy, 0), sse_magnitude(gx, gy, 1));
+}
+
+// 16 pixels per iteration
+__attribute__((target("sse4.1")))
+static void energy_span_sse41(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* out, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128i first = sse_energy8(above + x, row + x, below + x);
+        __m128i second = sse_energy8(above + x + 8, row + x + 8, below + x + 8);
+        _mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(first, second));
+    }
+    energy_span_scalar(above + x, row + x, below + x, out + x, count - x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_magnitude(__m256i gx, __m256i gy, int high) {
+    __m256i pairs = high ? _mm256_unpackhi_epi16(gx, gy) : _mm256_unpacklo_epi16(gx, gy);
+    __m256i squares = _mm256_madd_epi16(pairs, pairs);
+    __m256i energy = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(squares)));
+    return _mm256_and_si256(energy, _mm256_set1_epi32(0xFF));
+}
+
+// 16 pixels as 16-bit lanes in natural order
+__attribute__((target("avx2")))
+static inline __m256i avx2_words(const unsigned char* p) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+}
+
+// Energy of 16 pixels as 16-bit lanes; the per-lane unpack and pack cancel, so the order is preserved
+__attribute__((target("avx2")))
+static inline __m256i avx2_energy16(const unsigned char* above, const unsigned char* row, const unsigned char* below) {
+    __m256i al = avx2_words(above - 1), ac = avx2_words(above), ar = avx2_words(above + 1);
+    __m256i rl = avx2_words(row - 1), rr = avx2_words(row + 1);
+    __m256i bl = avx2_words(below - 1), bc = avx2_words(below), br = avx2_words(below + 1);
+
+    __m256i gx = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(ar, rr), br), _mm256_add_epi16(_mm256_add_epi16(al, rl), bl));
+    __m256i gy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(bl, bc), br), _mm256_add_epi16(_mm256_add_epi16(al, ac), ar));
+
+    return _mm256_packus_epi32(avx2_magnitude(gx, gy, 0), avx2_magnitude(gx, gy, 1));
+}
+
+// 32 pixels per iteration
+__attribute__((target("avx2")))
+static void energy_span_avx2(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* out, int count) {
+    int x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m256i first = avx2_energy16(above + x, row + x, below + x);
+        __m256i second = avx2_energy16(above + x + 16, row + x + 16, below + x + 16);
+        __m256i bytes = _mm256_packus_epi16(first, second);
+        _mm256_storeu_si256((__m256i*)(out + x), _mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    energy_span_scalar(above + x, row + x, below + x, out + x, count - x);
+}
+
+// 16 pixels widened straight to 32-bit lanes
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i avx512_dwords(const unsigned char* p) {
+    return _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+
+// vpmovdb truncates each lane to its low byte, which is the wrap of the original store
+__attribute__((target("avx512f,avx512bw")))
+static inline __m128i avx512_energy16(const unsigned char* above, const unsigned char* row, const unsigned char* below) {
+    __m512i al = avx512_dwords(above - 1), ac = avx512_dwords(above), ar = avx512_dwords(above + 1);
+    __m512i rl = avx512_dwords(row - 1), rr = avx512_dwords(row + 1);
+    __m512i bl = avx512_dwords(below - 1), bc = avx512_dwords(below), br = avx512_dwords(below + 1);
+
+    __m512i gx = _mm512_sub_epi32(_mm512_add_epi32(_mm512_add_epi32(ar, rr), br), _mm512_add_epi32(_mm512_add_epi32(al, rl), bl));
+    __m512i gy = _mm512_sub_epi32(_mm512_add_epi32(_mm512_add_epi32(bl, bc), br), _mm512_add_epi32(_mm512_add_epi32(al, ac), ar));
+    __m512i squares = _mm512_add_epi32(_mm512_mullo_epi32(gx, gx), _mm512_mullo_epi32(gy, gy));
+
+    return _mm512_cvtepi32_epi8(_mm512_cvttps_epi32(_mm512_sqrt_ps(_mm512_cvtepi32_ps(squares))));
+}
+
+// 64 pixels per iteration
+__attribute__((target("avx512f,avx512bw")))
+static void energy_span_avx512(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* out, int count) {
+    int x = 0;
+    for (; x + 64 <= count; x += 64) {
+        for (int k = 0; k < 64; k += 16)
+            _mm_storeu_si128((__m128i*)(out + x + k), avx512_energy16(above + x + k, row + x + k, below + x + k));
+    }
+    energy_span_scalar(above + x, row + x, below + x, out + x, count - x);
+}
+
+#endif
+
+// Scalar fallback and tail handler for the seam DP kernels; same tie-breaking as the table DP
+static void seam_dp_span_scalar(const uint32_t* prev, const unsigned char* energy, uint32_t* row, unsigned char* steps, int count) {
+    for (int x = 0; x < count; x++) {
+        uint32_t min_energy = prev[x];
+        unsigned char step = 1;
+
+        if (prev[x - 1] < min_energy) {
+            min_energy = prev[x - 1];
+            step = 0;
+        }
+
+        if (prev[x + 1] < min_energy) {
+            min_energy = prev[x + 1];
+            step = 2;
+        }
+
+        row[x] = energy[x] + min_energy;
+        steps[x] = step;
+    }
+}
+
+// Forward-energy fallback and tail handler: a straight step pays C_U, the gap the removal closes between the
+// left and right neighbours, and a diagonal step also pays the edge it creates with the pixel above
+static void seam_forward_span_scalar(const uint32_t* prev, const unsigned char* above, const unsigned char* current, uint32_t* row, unsigned char* steps, int count) {
+    for (int x = 0; x < count; x++) {
+        uint32_t up_cost = abs(current[x + 1] - current[x - 1]);
+        uint32_t min_cost = prev[x] + up_cost;
+        unsigned char step = 1;
+
+        uint32_t left_cost = prev[x - 1] + up_cost + abs(above[x] - current[x - 1]);
+        if (left_cost < min_cost) {
+            min_cost = left_cost;
+            step = 0;
+        }
+
+        uint32_t right_cost = prev[x + 1] + up_cost + abs(above[x] - current[x + 1]);
+        if (right_cost < min_cost) {
+            min_cost = right_cost;
+            step = 2;
+        }
+
+        row[x] = min_cost;
+        steps[x] = step;
+    }
+}
+
+#ifdef SEAM_X86
+
+// Cheapest of the three candidate costs with the table DP's tie-breaking (straight up, then left, then right),
+// returning the step + 1 of every lane. Costs stay far below 2^31, so the signed compare orders them like
+// unsigned ones.
+__attribute__((target("avx2")))
+static inline __m256i avx2_min_step(__m256i left, __m256i up, __m256i right, __m256i* best) {
+    __m256i left_better = _mm256_cmpgt_epi32(up, left);
+    __m256i cost = _mm256_min_epu32(up, left);
+    __m256i step = _mm256_blendv_epi8(_mm256_set1_epi32(1), _mm256_setzero_si256(), left_better);
+
+    __m256i right_better = _mm256_cmpgt_epi32(cost, right);
+    *best = _mm256_min_epu32(cost, right);
+    return _mm256_blendv_epi8(step, _mm256_set1_epi32(2), right_better);
+}
+
+// Narrows the step vectors of 16 consecutive cells to bytes in column order
+__attribute__((target("avx2")))
+static inline void avx2_store_steps(__m256i first, __m256i second, unsigned char* steps) {
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128((__m128i*)steps, bytes);
+}
+
+// 8 pixels widened to 32-bit lanes
+__attribute__((target("avx2")))
+static inline __m256i avx2_dwords(const unsigned char* p) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_dp8(const uint32_t* prev, const unsigned char* energy, uint32_t* row) {
+    __m256i left = _mm256_loadu_si256((const __m256i*)(prev - 1));
+    __m256i up = _mm256_loadu_si256((const __m256i*)prev);
+    __m256i right = _mm256_loadu_si256((const __m256i*)(prev + 1));
+
+    __m256i best;
+    __m256i step = avx2_min_step(left, up, right, &best);
+    _mm256_storeu_si256((__m256i*)row, _mm256_add_epi32(best, avx2_dwords(energy)));
+    return step;
+}
+
+// 16 cells per iteration
+__attribute__((target("avx2")))
+static void seam_dp_span_avx2(const uint32_t* prev, const unsigned char* energy, uint32_t* row, unsigned char* steps, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i first = avx2_dp8(prev + x, energy + x, row + x);
+        __m256i second = avx2_dp8(prev + x + 8, energy + x + 8, row + x + 8);
+        avx2_store_steps(first, second, steps + x);
+    }
+    seam_dp_span_scalar(prev + x, energy + x, row + x, steps + x, count - x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_forward8(const uint32_t* prev, const unsigned char* above, const unsigned char* current, uint32_t* row) {
+    __m256i left_pixel = avx2_dwords(current - 1);
+    __m256i right_pixel = avx2_dwords(current + 1);
+    __m256i above_pixel = avx2_dwords(above);
+    __m256i up_cost = _mm256_abs_epi32(_mm256_sub_epi32(right_pixel, left_pixel));
+
+    __m256i left = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(prev - 1)),
+                                    _mm256_add_epi32(up_cost, _mm256_abs_epi32(_mm256_sub_epi32(above_pixel, left_pixel))));
+    __m256i up = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)prev), up_cost);
+    __m256i right = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(prev + 1)),
+                                     _mm256_add_epi32(up_cost, _mm256_abs_epi32(_mm256_sub_epi32(above_pixel, right_pixel))));
+
+    __m256i best;
+    __m256i step = avx2_min_step(left, up, right, &best);
+    _mm256_storeu_si256((__m256i*)row, best);
+    return step;
+}
+
+// 16 cells per iteration
+__attribute__((target("avx2")))
+static void seam_forward_span_avx2(const uint32_t* prev, const unsigned char* above, const unsigned char* current, uint32_t* row, unsigned char* steps, int count) {
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i first = avx2_forward8(prev + x, above + x, current + x, row + x);
+        __m256i second = avx2_forward8(prev + x + 8, above + x + 8, current + x + 8, row + x + 8);
+        avx2_store_steps(first, second, steps + x);
+    }
+    seam_forward_span_scalar(prev + x, above + x, current + x, row + x, steps + x, count - x);
+}
+
+#endif
+
+static energy_span_fn energy_span = energy_span_scalar;
+static const char* energy_span_name = "scalar";
+static seam_dp_span_fn seam_dp_span_kernel = seam_dp_span_scalar;
+static seam_forward_span_fn seam_forward_span_kernel = seam_forward_span_scalar;
+
+// Picks the widest kernel the CPU supports; SEAM_ENERGY_KERNEL can force a narrower one
+__attribute__((constructor))
+static void select_energy_kernel(void) {
+    const char* forced = getenv("SEAM_ENERGY_KERNEL");
+    if (forced && strcmp(forced, "scalar") == 0)
+        return;
+
+#ifdef SEAM_X86
+    __builtin_cpu_init();
+    int allow_avx512 = !forced || strcmp(forced, "avx512bw") == 0;
+    int allow_avx2 = allow_avx512 || strcmp(forced, "avx2") == 0;
+
+    if (allow_avx2 && __builtin_cpu_supports("avx2")) {
+        seam_dp_span_kernel = seam_dp_span_avx2;
+        seam_forward_span_kernel = seam_forward_span_avx2;
+    }
+
+    if (allow_avx512 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        energy_span = energy_span_avx512;
+        energy_span_name = "avx512bw";
+    } else if (allow_avx2 && __builtin_cpu_supports("avx2")) {
+        energy_span = energy_span_avx2;
+        energy_span_name = "avx2";
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        energy_span = energy_span_sse41;
+        energy_span_name = "sse4.1";
+    }
+#endif
+}
+
+const char* energy_kernel_name(void) {
+    return energy_span_name;
+}
+
+// Seam DP over `count` columns that have a neighbour on both sides
+void seam_dp_span(const uint32_t* prev, const unsigned char* energy, uint32_t* row, unsigned char* steps, int count) {
+    seam_dp_span_kernel(prev, energy, row, steps, count);
+}
+
+// Forward-energy seam DP over `count` columns that have a neighbour on both sides
+void seam_forward_span(const uint32_t* prev, const unsigned char* above, const unsigned char* current, uint32_t* row, unsigned char* steps, int count) {
+    seam_forward_span_kernel(prev, above, current, row, steps, count);
+}
+
+static inline __attribute__((always_inline)) void copy_channel0_kernel(const unsigned char* pixels, int channels, unsigned char* plane, int count) {
+    for (int x = 0; x < count; x++)
+        plane[x] = pixels[(size_t)x * channels];
+}
+
+void copy_channel0(const unsigned char* pixels, int channels, unsigned char* plane, int count) {
+    SEAM_SPECIALIZE_CHANNELS(channels, copy_channel0_kernel(pixels, seam_channels, plane, count));
+}
+
+// Channel 0 of the same columns of three rows in one pass
+static inline __attribute__((always_inline)) void copy_channel0_rows(const unsigned char* above, const unsigned char* row, const unsigned char* below, int channels, unsigned char packed[3][ENERGY_CHUNK + 2], int count) {
+    for (int i = 0; i < count; i++) {
+        size_t offset = (size_t)i * channels;
+        packed[0][i] = above[offset];
+        packed[1][i] = row[offset];
+        packed[2][i] = below[offset];
+    }
+}
+
+// Writes energy_row[x] for x in [x_begin, x_end) of row y, borders included
+void compute_energy_row(const unsigned char* image_data, int width, int height, int channels, int y, int x_begin, int x_end, unsigned char* energy_row) {
+    int y_above = y > 0 ? y - 1 : 0;
+    int y_below = y < height - 1 ? y + 1 : height - 1;
+
+    // Border columns clamp their neighbours, everything between them goes through the span kernel
+    int first = x_begin > 1 ? x_begin : 1;
+    int last = x_end < width - 1 ? x_end : width - 1;
+
+    if (x_begin == 0 && x_end > 0)
+        energy_row[0] = compute_energy_pixel(image_data, width, height, channels, 0, y);
+    if (x_end == width && width > 1)
+        energy_row[width - 1] = compute_energy_pixel(image_data, width, height, channels, width - 1, y);
+    if (first >= last)
+        return;
+
+    size_t row_bytes = (size_t)width * channels;
+    const unsigned char* above = image_data + y_above * row_bytes;
+    const unsigned char* row = image_data + y * row_bytes;
+    const unsigned char* below = image_data + y_below * row_bytes;
+
+    if (channels == 1) {
+        energy_span(above + first, row + first, below + first, energy_row + first, last - first);
+        return;
+    }
+
+    // Only channel 0 feeds the gradient, so pack it into contiguous rows one chunk at a time
+    unsigned char packed[3][ENERGY_CHUNK + 2];
+    for (int x = first; x < last; x += ENERGY_CHUNK) {
+        int count = last - x < ENERGY_CHUNK ? last - x : ENERGY_CHUNK;
+        size_t offset = (size_t)(x - 1) * channels;
+        SEAM_SPECIALIZE_CHANNELS(channels, copy_channel0_rows(above + offset, row + offset, below + offset, seam_channels, packed, count + 2));
+        energy_span(packed[0] + 1, packed[1] + 1, packed[2] + 1, energy_row + x, count);
+    }
+}
@@ -0,0 +1,230 @@
+#include "../include/Seam_Carving_Seam_Map.h"
+
+static const char seam_map_magic[8] = { 'S', 'E', 'A', 'M', 'M', 'A', 'P', '2' };
+
+// FNV-1a over the decoded pixels; a map only fits the exact image it was carved from
+static uint64_t seam_map_hash(const unsigned char* image_data, size_t bytes) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < bytes; i++)
+        hash = (hash ^ image_data[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+// Records the options as the engine applies them, so options it ignores do not force a rebuild
+static void seam_map_set_options(seam_map* map, const carve_options* options) {
+    map->seams_per_pass = options->seams_per_pass > 1 ? options->seams_per_pass : 1;
+    map->forward_energy = map->seams_per_pass == 1 && options->forward_energy;
+    map->pyramid_levels = map->seams_per_pass == 1 && !map->forward_energy ? options->pyramid_levels : 0;
+    map->pyramid_band = map->pyramid_levels > 0 ? options->pyramid_band : 0;
+}
+
+// Carves a copy of the image down to min_width and records the removal order; the image is not modified
+int seam_map_build(seam_map* map, unsigned char* image_data, int width, int height, int channels, int min_width, const carve_options* options) {
+    int seams = width - min_width;
+    if (min_width < 1 || seams < 0 || seams > SEAM_MAP_MAX_SEAMS) {
+        fprintf(stderr, "Cannot build a seam map from width %d down to %d\n", width, min_width);
+        return -1;
+    }
+
+    size_t cells = (size_t)width * height;
+    map->order = malloc(cells * sizeof(uint16_t));
+    map->width = width;
+    map->height = height;
+    map->seams = seams;
+    map->channels = channels;
+    map->source_hash = seam_map_hash(image_data, cells * channels);
+    seam_map_set_options(map, options);
+
+    unsigned char* work = malloc(cells * channels);
+    seam_log log;
+    seam_log_init(&log);
+    if (!map->order || !work) {
+        free(work);
+        seam_map_free(map);
+        return -1;
+    }
+    memcpy(work, image_data, cells * channels);
+
+    // Intermediate frames of the one-off carve are of no use to anyone
+    carve_options carve = *options;
+    carve.recorded_seams = &log;
+    carve.save_intermediate = 0;
+
+    int carved_width = width;
+    int status = carve_seams(&work, &carved_width, height, channels, seams, &carve);
+    free(work);
+    if (status != 0 || log.seam_count != seams) {
+        seam_log_free(&log);
+        seam_map_free(map);
+        return -1;
+    }
+
+    for (size_t i = 0; i < cells; i++)
+        map->order[i] = SEAM_MAP_KEPT;
+    for (int s = 0; s < seams; s++)
+        for (size_t p = log.offsets[s]; p < log.offsets[s + 1]; p++)
+            map->order[log.pixels[p]] = (uint16_t)s;
+
+    seam_log_free(&log);
+    return 0;
+}
+
+void seam_map_free(seam_map* map) {
+    free(map->order);
+    map->order = NULL;
+}
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+int seam_map_matches(const seam_map* map, const unsigned char* image_data, int width, int height, int channels, const carve_options* options) {
+    seam_map wanted;
+    seam_map_set_options(&wanted, options);
+    return map->width == width && map->height == height && map->channels == channels &&
+        map->seams_per_pass == wanted.seams_per_pass && map->pyramid_levels == wanted.pyramid_levels &&
+        map->pyramid_band == wanted.pyramid_band && map->forward_energy == wanted.forward_energy &&
+        map->source_hash == seam_map_hash(image_data, (size_t)width * height * channels);
+}
+
+// Writes the map as magic, header and little-endian 16-bit entries; returns 0 on success
+int seam_map_write(const seam_map* map, const char* filename) {
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        perror("File opening failed");
+        return -1;
+    }
+
+    unsigned char header[48];
+    memcpy(header, seam_map_magic, sizeof(seam_map_magic));
+    put_u32(header + 8, map->width);
+    put_u32(header + 12, map->height);
+    put_u32(header + 16, map->seams);
+    put_u32(header + 20, map->channels);
+    put_u32(header + 24, (uint32_t)map->source_hash);
+    put_u32(header + 28, (uint32_t)(map->source_hash >> 32));
+    put_u32(header + 32, map->seams_per_pass);
+    put_u32(header + 36, map->pyramid_levels);
+    put_u32(header + 40, map->pyramid_band);
+    put_u32(header + 44, map->forward_energy);
+
+    // Entries are byte-swapped a row at a time so the file reads the same on any host
+    unsigned char* row = malloc((size_t)map->width * 2);
+    int status = row && fwrite(header, 1, sizeof(header), fp) == sizeof(header) ? 0 : -1;
+    for (int y = 0; y < map->height && status == 0; y++) {
+        const uint16_t* order = map->order + (size_t)y * map->width;
+        for (int x = 0; x < map->width; x++) {
+            row[2 * x] = (unsigned char)order[x];
+            row[2 * x + 1] = (unsigned char)(order[x] >> 8);
+        }
+        if (fwrite(row, 2, map->width, fp) != (size_t)map->width)
+            status = -1;
+    }
+
+    free(row);
+    if (fclose(fp) != 0)
+        status = -1;
+    if (status != 0)
+        fprintf(stderr, "Failed to write seam map: %s\n", filename);
+    return status;
+}
+
+// Reads a map written by seam_map_write; returns 0 on success
+int seam_map_read(seam_map* map, const char* filename) {
+    map->order = NULL;
+    FILE* fp = fopen(filename, "rb");
+    if (!fp)
+        return -1;
+
+    unsigned char header[48];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, seam_map_magic, sizeof(seam_map_magic)) != 0) {
+        fprintf(stderr, "Not a seam map: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    map->width = (int)get_u32(header + 8);
+    map->height = (int)get_u32(header + 12);
+    map->seams = (int)get_u32(header + 16);
+    map->channels = (int)get_u32(header + 20);
+    map->source_hash = get_u32(header + 24) | (uint64_t)get_u32(header + 28) << 32;
+    map->seams_per_pass = (int)get_u32(header + 32);
+    map->pyramid_levels = (int)get_u32(header + 36);
+    map->pyramid_band = (int)get_u32(header + 40);
+    map->forward_energy = (int)get_u32(header + 44);
+    if (map->width < 1 || map->height < 1 || map->seams < 0 || map->seams >= map->width || map->seams > SEAM_MAP_MAX_SEAMS) {
+        fprintf(stderr, "Corrupt seam map header: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    size_t cells = (size_t)map->width * map->height;
+    map->order = malloc(cells * sizeof(uint16_t));
+    unsigned char* bytes = (unsigned char*)map->order;
+    if (!map->order || fread(bytes, 2, cells, fp) != cells) {
+        fprintf(stderr, "Truncated seam map: %s\n", filename);
+        seam_map_free(map);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    // Decoded in place: entry i only ever reads its own two bytes
+    for (size_t i = 0; i < cells; i++)
+        map->order[i] = (uint16_t)(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+    return 0;
+}
+
+static int seam_map_check_width(const seam_map* map, int target_width) {
+    if (target_width > map->width || target_width < map->width - map->seams) {
+        fprintf(stderr, "Seam map covers widths %d to %d, not %d\n", map->width - map->seams, map->width, target_width);
+        return -1;
+    }
+    return 0;
+}
+
+// Keeps the pixels of row y that the first width - target_width seams did not remove
+static inline __attribute__((always_inline)) void seam_map_retarget_row_kernel(const seam_map* map, const unsigned char* image_data, int channels, int target_width, unsigned char* new_image_data, int y) {
+    int removed = map->width - target_width;
+    const uint16_t* order = map->order + (size_t)y * map->width;
+    const unsigned char* src = image_data + (size_t)y * map->width * channels;
+    unsigned char* dst = new_image_data + (size_t)y * target_width * channels;
+
+    for (int x = 0; x < map->width; x++) {
+        if (order[x] >= removed) {
+            for (int c = 0; c < channels; c++)
+                dst[c] = src[(size_t)x * channels + c];
+            dst += channels;
+        }
+    }
+}
+
+static void seam_map_retarget_row(const seam_map* map, const unsigned char* image_data, int channels, int target_width, unsigned char* new_image_data, int y) {
+    SEAM_SPECIALIZE_CHANNELS(channels, seam_map_retarget_row_kernel(map, image_data, seam_channels, target_width, new_image_data, y));
+}
+
+// Produces the image at target_width in one pass over the source
+int seam_map_retarget_sequential(const seam_map* map, const unsigned char* image_data, int channels, int target_width, unsigned char* new_image_data) {
+    if (seam_map_check_width(map, target_width) != 0)
+        return -1;
+
+    for (int y = 0; y < map->height; y++)
+        seam_map_retarget_row(map, image_data, channels, target_width, new_image_data, y);
+    return 0;
+}
+
+// Parallelize the retargeting pass with OpenMP; every row keeps exactly target_width pixels
+int seam_map_retarget_parallel(const seam_map* map, const unsigned char* image_data, int channels, int target_width, unsigned char* new_image_data) {
+    if (seam_map_check_width(map, target_width) != 0)
+        return -1;
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < map->height; y++)
+        seam_map_retarget_row(map, image_data, channels, target_width, new_image_data, y);
+    return 0;
+}
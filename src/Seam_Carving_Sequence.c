@@ -0,0 +1,196 @@
+#include "../include/Seam_Carving_Sequence.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+
+void sequence_options_init(sequence_options* options) {
+    options->output_dir = "outputs";
+    options->target_width = 0;
+    options->seams = 0;
+    options->band = PYRAMID_DEFAULT_BAND;
+    options->scene_change = SEQUENCE_SCENE_CHANGE;
+    options->keyframe_interval = 0;
+    png_write_settings_init(&options->settings);
+}
+
+// One decoded frame with its energy map and the subsampled channel 0 the scene-change test compares
+typedef struct {
+    const char* path;
+    int status;
+    unsigned char* image_data;
+    unsigned char* energy_map;
+    unsigned char* thumbnail;
+    size_t thumbnail_size;
+    int width;
+    int height;
+    int channels;
+} sequence_frame;
+
+// Decoder thread body: streams the PNG in with its energy map and samples channel 0 for the scene test
+static void* decode_frame(void* arg) {
+    sequence_frame* frame = arg;
+    frame->image_data = NULL;
+    frame->energy_map = NULL;
+    frame->thumbnail = NULL;
+    frame->status = read_png_streaming_sequential(frame->path, &frame->image_data, &frame->energy_map, &frame->width, &frame->height, &frame->channels);
+    if (frame->status != 0)
+        return NULL;
+
+    int columns = (frame->width + SEQUENCE_SCENE_STRIDE - 1) / SEQUENCE_SCENE_STRIDE;
+    int rows = (frame->height + SEQUENCE_SCENE_STRIDE - 1) / SEQUENCE_SCENE_STRIDE;
+    frame->thumbnail_size = (size_t)columns * rows;
+    frame->thumbnail = malloc(frame->thumbnail_size);
+    if (!frame->thumbnail) {
+        perror("Thumbnail allocation failed");
+        frame->status = -1;
+        return NULL;
+    }
+
+    unsigned char* out = frame->thumbnail;
+    for (int y = 0; y < frame->height; y += SEQUENCE_SCENE_STRIDE) {
+        const unsigned char* row = frame->image_data + (size_t)y * frame->width * frame->channels;
+        for (int x = 0; x < frame->width; x += SEQUENCE_SCENE_STRIDE)
+            *out++ = row[(size_t)x * frame->channels];
+    }
+    return NULL;
+}
+
+static void release_frame(sequence_frame* frame) {
+    free(frame->image_data);
+    free(frame->energy_map);
+    free(frame->thumbnail);
+    frame->image_data = NULL;
+    frame->energy_map = NULL;
+    frame->thumbnail = NULL;
+}
+
+// Mean absolute difference of two thumbnails of the same size
+static double scene_difference(const unsigned char* a, const unsigned char* b, size_t count) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return count > 0 ? (double)total / count : 0.0;
+}
+
+// Seams of the last carved frame, which guide the next one while it has the same size and content
+typedef struct {
+    int* seams;                     // seams[i * height + y]; the carve overwrites seam i once it has read it
+    size_t capacity;
+    int count;                      // 0 when the next frame has no prior
+    int width;
+    int height;
+    unsigned char* thumbnail;
+} sequence_prior;
+
+// Carves one decoded frame and hands it to the encoder; a keyframe ignores the prior. Returns 0 or -1.
+static int carve_frame(sequence_frame* frame, int keyframe, sequence_prior* prior, const sequence_options* options, seam_carver* carver, png_writer* writer, sequence_report* report) {
+    int width = frame->width, height = frame->height;
+    int seams = options->target_width > 0 ? width - options->target_width : options->seams;
+
+    // The same frame size guarantees that seam i of the previous frame fits this one at the same width
+    int guided = !keyframe && prior->count >= seams && prior->width == width && prior->height == height && prior->thumbnail &&
+                 scene_difference(prior->thumbnail, frame->thumbnail, frame->thumbnail_size) <= options->scene_change;
+
+    size_t needed = (size_t)(seams > 0 ? seams : 1) * height * sizeof(int);
+    if (needed > prior->capacity) {
+        int* grown = realloc(prior->seams, needed);
+        if (!grown) {
+            perror("Seam history allocation failed");
+            prior->count = 0;
+            return -1;
+        }
+        prior->seams = grown;
+        prior->capacity = needed;
+    }
+
+    carve_options carve;
+    carve_options_init(&carve, CARVE_MODE_PARALLEL);
+    carve.carver = carver;
+    carve.initial_energy = frame->energy_map;
+    carve.seam_prior = guided ? prior->seams : NULL;
+    carve.prior_band = options->band;
+    carve.seam_history = prior->seams;
+
+    free(prior->thumbnail);
+    prior->thumbnail = frame->thumbnail;
+    frame->thumbnail = NULL;
+    prior->width = width;
+    prior->height = height;
+    prior->count = 0;
+
+    if (!guided)
+        report->full_searches++;
+    if (carve_seams(&frame->image_data, &width, height, frame->channels, seams, &carve) != 0)
+        return -1;
+    prior->count = seams;
+
+    const char* name = strrchr(frame->path, '/');
+    char output_filename[1024];
+    snprintf(output_filename, sizeof(output_filename), "%s/%s", options->output_dir, name ? name + 1 : frame->path);
+
+    // The encoder owns the carved buffer from here on
+    int status = png_writer_submit(writer, output_filename, frame->image_data, width, height, frame->channels, &options->settings);
+    frame->image_data = NULL;
+    return status;
+}
+
+// Carves the frames in the given order; frame N + 1 is decoded while frame N is carved and frame N - 1 encoded
+int run_sequence(char** paths, int count, const sequence_options* options, sequence_report* report) {
+    memset(report, 0, sizeof(*report));
+    if (mkdir(options->output_dir, 0755) != 0 && errno != EEXIST) {
+        perror(options->output_dir);
+        return -1;
+    }
+
+    png_writer* writer = png_writer_create(SEQUENCE_WRITER_THREADS, SEQUENCE_WRITER_QUEUE);
+    if (!writer)
+        return -1;
+
+    seam_carver carver;
+    seam_carver_init(&carver);
+    sequence_prior prior = { 0 };
+    sequence_frame slots[2] = { 0 };
+
+    double start = omp_get_wtime();
+    if (count > 0) {
+        slots[0].path = paths[0];
+        decode_frame(&slots[0]);
+    }
+
+    for (int n = 0; n < count; n++) {
+        sequence_frame* frame = &slots[n & 1];
+        sequence_frame* next = &slots[(n + 1) & 1];
+
+        pthread_t decoder;
+        int prefetching = 0;
+        if (n + 1 < count) {
+            next->path = paths[n + 1];
+            prefetching = pthread_create(&decoder, NULL, decode_frame, next) == 0;
+        }
+
+        int status = frame->status;
+        if (status != 0)
+            fprintf(stderr, "Failed to read frame: %s\n", frame->path);
+        else
+            status = carve_frame(frame, options->keyframe_interval > 0 && n % options->keyframe_interval == 0, &prior, options, &carver, writer, report);
+        if (status != 0) {
+            report->failures++;
+            prior.count = 0;
+        }
+        release_frame(frame);
+
+        if (prefetching)
+            pthread_join(decoder, NULL);
+        else if (n + 1 < count)
+            decode_frame(next);
+    }
+
+    report->failures += png_writer_finish(writer);
+    report->seconds = omp_get_wtime() - start;
+    report->frames = count;
+
+    free(prior.seams);
+    free(prior.thumbnail);
+    seam_carver_free(&carver);
+    return report->failures == 0 ? 0 : -1;
+}
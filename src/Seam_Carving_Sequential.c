@@ -37,19 +37,30 @@ unsigned char* read_png_sequential(const char* filename, int* width, int* height
     }
 
     png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png) return NULL;
-
-    png_infop info = png_create_info_struct(png);
-    if (!info) return NULL;
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!info) {
+        png_destroy_read_struct(&png, NULL, NULL);
+        fclose(fp);
+        return NULL;
+    }
 
-    if (setjmp(png_jmpbuf(png))) return NULL;
+    // A corrupt or truncated file jumps back here from anywhere in the decode, so release whatever exists by then
+    unsigned char* volatile image_data = NULL;
+    png_bytep* volatile row_pointers = NULL;
+    if (setjmp(png_jmpbuf(png))) {
+        fprintf(stderr, "Failed to decode PNG: %s\n", filename);
+        free(image_data);
+        free(row_pointers);
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(fp);
+        return NULL;
+    }
 
     png_init_io(png, fp);
     png_read_info(png, info);
 
     *width  = png_get_image_width(png, info);
     *height = png_get_image_height(png, info);
-    *channels = png_get_channels(png, info);
 
     png_byte color_type = png_get_color_type(png, info);
     png_byte bit_depth  = png_get_bit_depth(png, info);
@@ -62,12 +73,16 @@ unsigned char* read_png_sequential(const char* filename, int* width, int* height
         png_set_expand_gray_1_2_4_to_8(png);
     if (png_get_valid(png, info, PNG_INFO_tRNS))
         png_set_tRNS_to_alpha(png);
+    png_set_interlace_handling(png);
 
     png_read_update_info(png, info);
 
+    // Channels after the expansions, so palette and tRNS images report what actually lands in the buffer
+    *channels = png_get_channels(png, info);
+
     int rowbytes = png_get_rowbytes(png, info);
-    unsigned char* image_data = malloc(rowbytes * (*height));
-    png_bytep* row_pointers = malloc(sizeof(png_bytep) * (*height));
+    image_data = malloc(rowbytes * (*height));
+    row_pointers = malloc(sizeof(png_bytep) * (*height));
     for (int y = 0; y < *height; y++)
         row_pointers[y] = image_data + y * rowbytes;
 
@@ -80,19 +95,42 @@ unsigned char* read_png_sequential(const char* filename, int* width, int* height
     return image_data;
 }
 
-// Writes image data to a PNG file
-void write_png_sequential(const char* filename, unsigned char* image_data, int width, int height, int channels) {
+// Library defaults: zlib's default level and adaptive filtering
+void png_write_settings_init(png_write_settings* settings) {
+    settings->compression_level = -1;
+    settings->filters = -1;
+}
+
+// PNG colour type of 8-bit pixels with 1 to 4 interleaved channels, or -1
+int png_color_type_for(int channels) {
+    switch (channels) {
+    case 1: return PNG_COLOR_TYPE_GRAY;
+    case 2: return PNG_COLOR_TYPE_GRAY_ALPHA;
+    case 3: return PNG_COLOR_TYPE_RGB;
+    case 4: return PNG_COLOR_TYPE_RGBA;
+    default: return -1;
+    }
+}
+
+// Encodes 8-bit rows of gray, gray + alpha, RGB or RGBA pixels into a PNG file; returns 0 on success
+int write_png_rows(const char* filename, png_bytep* rows, int width, int height, int channels, const png_write_settings* settings) {
+    int color_type = png_color_type_for(channels);
+    if (color_type < 0) {
+        fprintf(stderr, "Cannot write a PNG with %d channels: %s\n", channels, filename);
+        return -1;
+    }
+
     FILE* fp = fopen(filename, "wb");
     if (!fp) {
         perror("File opening failed");
-        return;
+        return -1;
     }
 
     png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!png) {
         perror("png_create_write_struct failed");
         fclose(fp);
-        return;
+        return -1;
     }
 
     png_infop info = png_create_info_struct(png);
@@ -100,144 +138,605 @@ void write_png_sequential(const char* filename, unsigned char* image_data, int w
         perror("png_create_info_struct failed");
         fclose(fp);
         png_destroy_write_struct(&png, NULL);
-        return;
+        return -1;
     }
 
     if (setjmp(png_jmpbuf(png))) {
         perror("Error during PNG creation");
         fclose(fp);
         png_destroy_write_struct(&png, &info);
-        return;
+        return -1;
     }
 
     png_init_io(png, fp);
-    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_DEFAULT);
-    png_write_info(png, info);
-
-    png_bytep row = (png_byte*) malloc(3 * width * sizeof(png_byte));
-
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            row[x * 3 + 0] = image_data[(y * width + x) * channels];     
-            row[x * 3 + 1] = image_data[(y * width + x) * channels + 1]; 
-            row[x * 3 + 2] = image_data[(y * width + x) * channels + 2]; 
-        }
-        png_write_row(png, row);
-    }
+    if (settings && settings->compression_level >= 0)
+        png_set_compression_level(png, settings->compression_level);
+    if (settings && settings->filters >= 0)
+        png_set_filter(png, PNG_FILTER_TYPE_BASE, settings->filters);
 
-    free(row);
+    png_set_IHDR(png, info, width, height, 8, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    png_write_image(png, rows);
     png_write_end(png, NULL);
+
     fclose(fp);
     png_destroy_write_struct(&png, &info);
+    return 0;
+}
+
+// Writes image data to a PNG file with the given encoder settings; returns 0 on success
+int write_png_with_settings(const char* filename, unsigned char* image_data, int width, int height, int channels, const png_write_settings* settings) {
+    png_bytep* rows = malloc(sizeof(png_bytep) * height);
+    if (!rows)
+        return -1;
+    SEAM_TRACE_BEGIN(span, TRACE_ENCODE);
+
+    // Every channel count has a matching colour type, so the rows are encoded straight from the buffer
+    for (int y = 0; y < height; y++)
+        rows[y] = image_data + (size_t)y * width * channels;
+
+    int status = write_png_rows(filename, rows, width, height, channels, settings);
+    SEAM_TRACE_BYTES(span, 0, trace_file_bytes(filename));
+    SEAM_TRACE_END(span);
+
+    free(rows);
+    return status;
+}
+
+// Writes image data to a PNG file
+void write_png_sequential(const char* filename, unsigned char* image_data, int width, int height, int channels) {
+    write_png_with_settings(filename, image_data, width, height, channels, NULL);
 }
 
 // Computes the energy map of an image based on pixel gradients
 void compute_energy_map_sequential(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_map) {
-    int gx, gy;
-    for (int y = 1; y < height - 1; y++) {
-        for (int x = 1; x < width - 1; x++) {
-            gx = 0;
-            gy = 0;
-
-            for (int j = -1; j <= 1; j++) {
-                for (int i = -1; i <= 1; i++) {
-                    int pixel = (y + j) * width + (x + i);
-                    gx += image_data[pixel * channels] * (i);   
-                    gy += image_data[pixel * channels] * (j);   
-                }
-            }
+    for (int y = 0; y < height; y++)
+        compute_energy_row(image_data, width, height, channels, y, 0, width, energy_map + (size_t)y * width);
+}
 
-            int energy = sqrt(gx * gx + gy * gy);
-            energy_map[y * width + x] = energy;
-        }
+// Column range [*x_begin, *x_end) of row y whose energy can differ from the shifted map after removing the seam
+void energy_update_band(int* seam, int width, int height, int y, int* x_begin, int* x_end) {
+    int lo = seam[y], hi = seam[y];
+    if (y > 0) {
+        lo = seam[y - 1] < lo ? seam[y - 1] : lo;
+        hi = seam[y - 1] > hi ? seam[y - 1] : hi;
     }
+    if (y < height - 1) {
+        lo = seam[y + 1] < lo ? seam[y + 1] : lo;
+        hi = seam[y + 1] > hi ? seam[y + 1] : hi;
+    }
+
+    // Left of lo - 1 every neighbour is still the same pixel, right of hi every neighbour moved with it
+    *x_begin = lo - 1 > 0 ? lo - 1 : 0;
+    *x_end = hi + 1 < width ? hi + 1 : width;
 }
 
-// Computes the seam (vertical path of minimum energy) for image resizing
-void compute_seam_sequential(unsigned char* energy_map, int width, int height, int* seam) {
-    int* dp = malloc(width * height * sizeof(int));
-    int* backtrack = malloc(width * height * sizeof(int));
+// Brings the previous energy map up to date after a seam removal; image_data is the image without the seam
+// (width columns) and energy_map still has width + 1 columns; new_energy_map may be the same buffer
+void update_energy_map_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, unsigned char* energy_map, unsigned char* new_energy_map) {
+    remove_seam_sequential(energy_map, new_energy_map, width + 1, height, 1, seam);
+
+    for (int y = 0; y < height; y++) {
+        int x_begin, x_end;
+        energy_update_band(seam, width, height, y, &x_begin, &x_end);
+        compute_energy_row(image_data, width, height, channels, y, x_begin, x_end, new_energy_map + (size_t)y * width);
+    }
+}
+
+// Cumulative cost of one cell; the step records which parent (-1, 0 or +1 columns away) was cheapest,
+// so it stays valid when the table is shifted along with the image
+static inline int seam_dp_cell(int* prev_row, int width, int x, int energy, signed char* step) {
+    int min_energy = prev_row[x];
+    int best_step = 0;
+
+    if (x > 0 && prev_row[x - 1] < min_energy) {
+        min_energy = prev_row[x - 1];
+        best_step = -1;
+    }
+
+    if (x < width - 1 && prev_row[x + 1] < min_energy) {
+        min_energy = prev_row[x + 1];
+        best_step = 1;
+    }
 
+    *step = best_step;
+    return energy + min_energy;
+}
+
+// Fills the whole cumulative-cost table and the step table for the energy map
+void compute_seam_table_sequential(unsigned char* energy_map, int width, int height, int* dp, signed char* backtrack) {
     for (int x = 0; x < width; x++) {
-        dp[x] = energy_map[x];  
-        backtrack[x] = -1;
+        dp[x] = energy_map[x];
+        backtrack[x] = 0;
     }
 
     for (int y = 1; y < height; y++) {
+        int* prev_row = dp + (size_t)(y - 1) * width;
         for (int x = 0; x < width; x++) {
-            int min_energy = dp[(y - 1) * width + x];
-            int best_x = x;
-
-            if (x > 0 && dp[(y - 1) * width + x - 1] < min_energy) {
-                min_energy = dp[(y - 1) * width + x - 1];
-                best_x = x - 1;
-            }
+            size_t idx = (size_t)y * width + x;
+            dp[idx] = seam_dp_cell(prev_row, width, x, energy_map[idx], &backtrack[idx]);
+        }
+    }
+}
 
-            if (x < width - 1 && dp[(y - 1) * width + x + 1] < min_energy) {
-                min_energy = dp[(y - 1) * width + x + 1];
-                best_x = x + 1;
-            }
+// The same table over the pixels that are not taken: taken pixels cost INT_MAX, and so does every pixel that can only
+// be reached through them, so no path of the table runs through a taken pixel
+void compute_masked_seam_table_sequential(unsigned char* energy_map, const unsigned char* taken, int width, int height, int* dp, signed char* backtrack) {
+    for (int x = 0; x < width; x++) {
+        dp[x] = taken[x] ? INT_MAX : energy_map[x];
+        backtrack[x] = 0;
+    }
 
-            dp[y * width + x] = energy_map[y * width + x] + min_energy;
-            backtrack[y * width + x] = best_x;
+    for (int y = 1; y < height; y++) {
+        int* prev_row = dp + (size_t)(y - 1) * width;
+        for (int x = 0; x < width; x++) {
+            size_t idx = (size_t)y * width + x;
+            int cost = seam_dp_cell(prev_row, width, x, 0, &backtrack[idx]);
+            dp[idx] = taken[idx] || cost == INT_MAX ? INT_MAX : cost + energy_map[idx];
         }
     }
+}
 
-    int min_energy = dp[(height - 1) * width];
+// Picks the cheapest bottom-row column (the first one on ties) and follows the steps back up
+void trace_seam_sequential(int* dp, signed char* backtrack, int width, int height, int* seam) {
+    int* last_row = dp + (size_t)(height - 1) * width;
+    int min_energy = last_row[0];
     int best_x = 0;
 
     for (int x = 1; x < width; x++) {
-        if (dp[(height - 1) * width + x] < min_energy) {
-            min_energy = dp[(height - 1) * width + x];
+        if (last_row[x] < min_energy) {
+            min_energy = last_row[x];
             best_x = x;
         }
     }
 
     for (int y = height - 1; y >= 0; y--) {
         seam[y] = best_x;
-        best_x = backtrack[y * width + best_x];
+        best_x += backtrack[(size_t)y * width + best_x];
+    }
+}
+
+// Recomputes the part of an already shifted table that removing the seam can affect: the cells next to the
+// seam whose parents changed, the cells whose energy changed, and everything below a cell whose cost changed.
+// A row whose recomputed costs all match the shifted ones stops the cone from spreading further down.
+void refresh_seam_table(unsigned char* energy_map, int width, int height, int* seam, int* dp, signed char* backtrack) {
+    int changed_begin = width, changed_end = 0;
+
+    for (int y = 0; y < height; y++) {
+        int x_begin, x_end;
+        energy_update_band(seam, width, height, y, &x_begin, &x_end);
+
+        if (y > 0) {
+            // Columns whose three parents no longer map to the same old cells
+            int parent_begin = seam[y - 1] - 1 < seam[y] ? seam[y - 1] - 1 : seam[y];
+            int parent_end = (seam[y - 1] > seam[y] - 1 ? seam[y - 1] : seam[y] - 1) + 1;
+            x_begin = parent_begin < x_begin ? parent_begin : x_begin;
+            x_end = parent_end > x_end ? parent_end : x_end;
+
+            if (changed_begin < changed_end) {
+                x_begin = changed_begin - 1 < x_begin ? changed_begin - 1 : x_begin;
+                x_end = changed_end + 1 > x_end ? changed_end + 1 : x_end;
+            }
+        }
+        x_begin = x_begin > 0 ? x_begin : 0;
+        x_end = x_end < width ? x_end : width;
+
+        changed_begin = width;
+        changed_end = 0;
+        for (int x = x_begin; x < x_end; x++) {
+            size_t idx = (size_t)y * width + x;
+            int cost = energy_map[idx];
+            signed char step = 0;
+            if (y > 0)
+                cost = seam_dp_cell(dp + (size_t)(y - 1) * width, width, x, energy_map[idx], &step);
+
+            backtrack[idx] = step;
+            if (cost != dp[idx]) {
+                dp[idx] = cost;
+                changed_begin = x < changed_begin ? x : changed_begin;
+                changed_end = x + 1;
+            }
+        }
+    }
+}
+
+// Shifts the table of the previous iteration past the removed seam and refreshes the affected cone;
+// energy_map is already up to date (width columns) and the new buffers may be the old ones
+void update_seam_table_sequential(unsigned char* energy_map, int width, int height, int* seam, int* dp, signed char* backtrack, int* new_dp, signed char* new_backtrack) {
+    remove_seam_sequential((unsigned char*)dp, (unsigned char*)new_dp, width + 1, height, sizeof(int), seam);
+    remove_seam_sequential((unsigned char*)backtrack, (unsigned char*)new_backtrack, width + 1, height, 1, seam);
+    refresh_seam_table(energy_map, width, height, seam, new_dp, new_backtrack);
+}
+
+// Orders seam starts by cumulative cost, lowest column first on ties
+static int compare_seam_starts(const void* a, const void* b) {
+    const seam_start* sa = a;
+    const seam_start* sb = b;
+    if (sa->cost != sb->cost)
+        return sa->cost < sb->cost ? -1 : 1;
+    return sa->x - sb->x;
+}
+
+// Extracts up to k pairwise-disjoint seams from one filled table by backtracking from the cheapest bottom-row
+// columns and rejecting any path that runs into a pixel already taken; seams[s * height + y] holds seam s.
+// Columns of cost INT_MAX (unreachable in a masked table) are never started from. used is a width * height
+// scratch mask and order holds width entries. Returns the number of seams found.
+int find_seams_sequential(int* dp, signed char* backtrack, int width, int height, int k, int* seams, unsigned char* used, seam_start* order) {
+    int* last_row = dp + (size_t)(height - 1) * width;
+    for (int x = 0; x < width; x++) {
+        order[x].cost = last_row[x];
+        order[x].x = x;
+    }
+    qsort(order, width, sizeof(seam_start), compare_seam_starts);
+
+    memset(used, 0, (size_t)width * height);
+
+    int found = 0;
+    for (int c = 0; c < width && found < k && order[c].cost != INT_MAX; c++) {
+        int* seam = seams + (size_t)found * height;
+        int x = order[c].x;
+        int y = height - 1;
+
+        for (; y >= 0; y--) {
+            if (used[(size_t)y * width + x])
+                break;
+            seam[y] = x;
+            x += backtrack[(size_t)y * width + x];
+        }
+        if (y >= 0)
+            continue;
+
+        for (y = 0; y < height; y++)
+            used[(size_t)y * width + seam[y]] = 1;
+        found++;
+    }
+
+    return found;
+}
+
+// One cell of the rolling-row DP; same tie-breaking as seam_dp_cell (straight up, then left, then right)
+static inline uint32_t seam_compact_cell(uint32_t* prev_row, int width, int x, uint32_t energy, int* step) {
+    uint32_t min_energy = prev_row[x];
+    int best_step = 0;
+
+    if (x > 0 && prev_row[x - 1] < min_energy) {
+        min_energy = prev_row[x - 1];
+        best_step = -1;
+    }
+
+    if (x < width - 1 && prev_row[x + 1] < min_energy) {
+        min_energy = prev_row[x + 1];
+        best_step = 1;
+    }
+
+    *step = best_step;
+    return energy + min_energy;
+}
+
+// Packs the step bytes of columns [chunk, chunk_end) four to a byte. Four step bytes b0..b3 of a little-endian
+// word land in bits 0-1, 2-3, 4-5 and 6-7; the shifts only stay apart while every byte is below 4, so a
+// partial last group is padded with zero steps (step_bytes has room for three more).
+static void pack_step_bytes(unsigned char* step_bytes, unsigned char* step_row, int chunk, int chunk_end) {
+    memset(step_bytes + (chunk_end - chunk), 0, 3);
+    for (int group = chunk; group < chunk_end; group += 4) {
+        uint32_t word;
+        memcpy(&word, step_bytes + (group - chunk), sizeof(word));
+        step_row[group >> 2] = (unsigned char)((word | word >> 6 | word >> 12 | word >> 18) & 0xFF);
+    }
+}
+
+// Fills row y of the rolling cost buffer and its packed steps for columns [x_begin, x_end); x_begin is a
+// multiple of four so every packed byte belongs to a single caller. Interior columns go through the vector
+// kernel a chunk at a time with their steps in bytes, which are then packed four to a byte.
+void seam_compact_row(const unsigned char* energy_row, int width, int y, uint32_t* cost_rows, unsigned char* steps, int x_begin, int x_end) {
+    uint32_t* prev_row = cost_rows + (size_t)((y - 1) & 1) * width;
+    uint32_t* row = cost_rows + (size_t)(y & 1) * width;
+    unsigned char* step_row = steps + (size_t)y * SEAM_STEP_ROW_BYTES(width);
+    unsigned char step_bytes[SEAM_DP_CHUNK + 4];
+
+    for (int chunk = x_begin; chunk < x_end; chunk += SEAM_DP_CHUNK) {
+        int chunk_end = chunk + SEAM_DP_CHUNK < x_end ? chunk + SEAM_DP_CHUNK : x_end;
+        int first = chunk > 0 ? chunk : 1;
+        int last = chunk_end < width - 1 ? chunk_end : width - 1;
+        int step;
+
+        // The border columns have a single neighbour above
+        if (chunk == 0) {
+            row[0] = seam_compact_cell(prev_row, width, 0, energy_row[0], &step);
+            step_bytes[0] = (unsigned char)(step + 1);
+        }
+        if (chunk_end == width && width > 1) {
+            row[width - 1] = seam_compact_cell(prev_row, width, width - 1, energy_row[width - 1], &step);
+            step_bytes[width - 1 - chunk] = (unsigned char)(step + 1);
+        }
+        if (first < last)
+            seam_dp_span(prev_row + first, energy_row + first, row + first, step_bytes + (first - chunk), last - first);
+
+        pack_step_bytes(step_bytes, step_row, chunk, chunk_end);
+    }
+}
+
+// Follows the packed steps up from column x of the bottom row
+void trace_packed_steps(unsigned char* steps, int width, int height, int x, int* seam) {
+    size_t row_bytes = SEAM_STEP_ROW_BYTES(width);
+
+    for (int y = height - 1; y > 0; y--) {
+        seam[y] = x;
+        int packed = steps[(size_t)y * row_bytes + (x >> 2)];
+        x += ((packed >> ((x & 3) * 2)) & 3) - 1;
+    }
+    seam[0] = x;
+}
+
+// Lowest column of the cheapest entry in the last rolling cost row
+static int cheapest_compact_column(uint32_t* cost_rows, int width, int height) {
+    uint32_t* last_row = cost_rows + (size_t)((height - 1) & 1) * width;
+    int best_x = 0;
+    for (int x = 1; x < width; x++) {
+        if (last_row[x] < last_row[best_x])
+            best_x = x;
+    }
+    return best_x;
+}
+
+// C_U of column x: the gap between its left and right neighbours that closes when it is removed
+static inline uint32_t forward_up_cost(const unsigned char* current, int width, int channels, int x) {
+    int left_x = x > 0 ? x - 1 : x;
+    int right_x = x < width - 1 ? x + 1 : x;
+    return abs(current[(size_t)right_x * channels] - current[(size_t)left_x * channels]);
+}
+
+// Forward-energy cell for the border columns, which have a single neighbour above
+static inline uint32_t seam_forward_cell(const uint32_t* prev_row, const unsigned char* above, const unsigned char* current, int width, int channels, int x, int* step) {
+    uint32_t up_cost = forward_up_cost(current, width, channels, x);
+    uint32_t min_cost = prev_row[x] + up_cost;
+    int above_pixel = above[(size_t)x * channels];
+    int best_step = 0;
+
+    if (x > 0) {
+        uint32_t left_cost = prev_row[x - 1] + up_cost + abs(above_pixel - current[(size_t)(x - 1) * channels]);
+        if (left_cost < min_cost) {
+            min_cost = left_cost;
+            best_step = -1;
+        }
+    }
+
+    if (x < width - 1) {
+        uint32_t right_cost = prev_row[x + 1] + up_cost + abs(above_pixel - current[(size_t)(x + 1) * channels]);
+        if (right_cost < min_cost) {
+            min_cost = right_cost;
+            best_step = 1;
+        }
     }
 
-    free(dp);
-    free(backtrack);
+    *step = best_step;
+    return min_cost;
 }
 
-// Highlights the seam in the image by changing its color to red and saves the result
-void highlight_seam_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename) {
-    unsigned char* highlighted_image = malloc(width * height * channels);
-    memcpy(highlighted_image, image_data, width * height * channels);
+// Forward-energy counterpart of seam_compact_row reading channel 0 of image rows y - 1 and y; row 0 only gets
+// its C_U costs. Multi-channel rows are gathered into contiguous channel-0 runs for the vector kernel.
+void seam_forward_row(const unsigned char* image_data, int width, int channels, int y, uint32_t* cost_rows, unsigned char* steps, int x_begin, int x_end) {
+    size_t row_bytes = (size_t)width * channels;
+    const unsigned char* current = image_data + (size_t)y * row_bytes;
+    uint32_t* row = cost_rows + (size_t)(y & 1) * width;
+
+    if (y == 0) {
+        for (int x = x_begin; x < x_end; x++)
+            row[x] = forward_up_cost(current, width, channels, x);
+        return;
+    }
+
+    const unsigned char* above = current - row_bytes;
+    uint32_t* prev_row = cost_rows + (size_t)((y - 1) & 1) * width;
+    unsigned char* step_row = steps + (size_t)y * SEAM_STEP_ROW_BYTES(width);
+    unsigned char step_bytes[SEAM_DP_CHUNK + 4];
+    unsigned char packed[2][SEAM_DP_CHUNK + 2];
+
+    for (int chunk = x_begin; chunk < x_end; chunk += SEAM_DP_CHUNK) {
+        int chunk_end = chunk + SEAM_DP_CHUNK < x_end ? chunk + SEAM_DP_CHUNK : x_end;
+        int first = chunk > 0 ? chunk : 1;
+        int last = chunk_end < width - 1 ? chunk_end : width - 1;
+        int step;
+
+        if (chunk == 0) {
+            row[0] = seam_forward_cell(prev_row, above, current, width, channels, 0, &step);
+            step_bytes[0] = (unsigned char)(step + 1);
+        }
+        if (chunk_end == width && width > 1) {
+            row[width - 1] = seam_forward_cell(prev_row, above, current, width, channels, width - 1, &step);
+            step_bytes[width - 1 - chunk] = (unsigned char)(step + 1);
+        }
+        if (first < last) {
+            if (channels == 1) {
+                seam_forward_span(prev_row + first, above + first, current + first, row + first, step_bytes + (first - chunk), last - first);
+            } else {
+                size_t offset = (size_t)(first - 1) * channels;
+                copy_channel0(above + offset, channels, packed[0], last - first + 2);
+                copy_channel0(current + offset, channels, packed[1], last - first + 2);
+                seam_forward_span(prev_row + first, packed[0] + 1, packed[1] + 1, row + first, step_bytes + (first - chunk), last - first);
+            }
+        }
+
+        pack_step_bytes(step_bytes, step_row, chunk, chunk_end);
+    }
+}
 
+// Cheapest seam without the full table: costs live in two rolling rows, steps in 2 bits per pixel
+void compute_seam_compact_sequential(unsigned char* energy_map, int width, int height, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    for (int x = 0; x < width; x++)
+        cost_rows[x] = energy_map[x];
+
+    for (int y = 1; y < height; y++)
+        seam_compact_row(energy_map + (size_t)y * width, width, y, cost_rows, steps, 0, width);
+
+    trace_packed_steps(steps, width, height, cheapest_compact_column(cost_rows, width, height), seam);
+}
+
+// Fused energy + seam search: each energy row is computed from the three image rows around it into
+// energy_row (width bytes) and goes straight into the DP, so no energy map is written or read back
+void compute_seam_fused_sequential(unsigned char* image_data, int width, int height, int channels, unsigned char* energy_row, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    compute_energy_row(image_data, width, height, channels, 0, 0, width, energy_row);
+    for (int x = 0; x < width; x++)
+        cost_rows[x] = energy_row[x];
+
+    for (int y = 1; y < height; y++) {
+        compute_energy_row(image_data, width, height, channels, y, 0, width, energy_row);
+        seam_compact_row(energy_row, width, y, cost_rows, steps, 0, width);
+    }
+
+    trace_packed_steps(steps, width, height, cheapest_compact_column(cost_rows, width, height), seam);
+}
+
+// Cheapest seam under forward energy (the cost of the edges a removal creates), searched in rolling rows
+// straight from the image with no energy pass
+void compute_seam_forward_sequential(unsigned char* image_data, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    for (int y = 0; y < height; y++)
+        seam_forward_row(image_data, width, channels, y, cost_rows, steps, 0, width);
+
+    trace_packed_steps(steps, width, height, cheapest_compact_column(cost_rows, width, height), seam);
+}
+
+// Computes the seam (vertical path of minimum energy) for image resizing
+int compute_seam_sequential(unsigned char* energy_map, int width, int height, int* seam) {
+    uint32_t* cost_rows = malloc(2 * (size_t)width * sizeof(uint32_t));
+    unsigned char* steps = malloc((size_t)height * SEAM_STEP_ROW_BYTES(width));
+    int status = cost_rows && steps ? 0 : -1;
+    if (status == 0)
+        compute_seam_compact_sequential(energy_map, width, height, cost_rows, steps, seam);
+    else
+        perror("Seam search allocation failed");
+
+    free(cost_rows);
+    free(steps);
+    return status;
+}
+
+static inline __attribute__((always_inline)) void transpose_tile_row_kernel(const unsigned char* image_data, unsigned char* transposed, int width, int height, int channels, int ty) {
+    int y_end = ty + TRANSPOSE_TILE < height ? ty + TRANSPOSE_TILE : height;
+    for (int tx = 0; tx < width; tx += TRANSPOSE_TILE) {
+        int x_end = tx + TRANSPOSE_TILE < width ? tx + TRANSPOSE_TILE : width;
+        for (int y = ty; y < y_end; y++) {
+            for (int x = tx; x < x_end; x++) {
+                const unsigned char* src = &image_data[((size_t)y * width + x) * channels];
+                unsigned char* dst = &transposed[((size_t)x * height + y) * channels];
+                for (int c = 0; c < channels; c++)
+                    dst[c] = src[c];
+            }
+        }
+    }
+}
+
+// Transposes the row of tiles starting at row ty
+void transpose_tile_row(const unsigned char* image_data, unsigned char* transposed, int width, int height, int channels, int ty) {
+    SEAM_SPECIALIZE_CHANNELS(channels, transpose_tile_row_kernel(image_data, transposed, width, height, seam_channels, ty));
+}
+
+// Transposes the image (height x width becomes width x height) tile by tile so that both the reads
+// and the writes stay within a few cache lines; horizontal seams are carved as vertical ones on the result
+void transpose_image_sequential(unsigned char* image_data, unsigned char* transposed, int width, int height, int channels) {
+    for (int ty = 0; ty < height; ty += TRANSPOSE_TILE)
+        transpose_tile_row(image_data, transposed, width, height, channels, ty);
+}
+
+// Removes the computed seam from the image in memory; image_data and new_image_data may be the same buffer
+void remove_seam_sequential(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seam) {
+    size_t row_bytes = (size_t)width * channels;
+    size_t new_row_bytes = (size_t)(width - 1) * channels;
+
+    // Rows are compacted front to back, so the destination never overtakes unread source rows
     for (int y = 0; y < height; ++y) {
         int seam_x = seam[y];
-        int idx = (y * width + seam_x) * channels;
-        highlighted_image[idx] = 255;       
-        highlighted_image[idx + 1] = 0;     
-        highlighted_image[idx + 2] = 0;     
+        unsigned char* src = image_data + y * row_bytes;
+        unsigned char* dst = new_image_data + y * new_row_bytes;
+        memmove(dst, src, (size_t)seam_x * channels);
+        memmove(dst + (size_t)seam_x * channels, src + (size_t)(seam_x + 1) * channels, (size_t)(width - seam_x - 1) * channels);
     }
+}
 
-    write_png_sequential(output_filename, highlighted_image, width, height, channels);
-    free(highlighted_image);
+static int compare_columns(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
 }
 
-// Removes the computed seam from the image and saves the result as a new PNG file
-void remove_and_save_seam_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename) {
-    unsigned char* new_image_data = malloc((width - 1) * height * channels);
+// Removes k disjoint seams in a single compaction pass; image_data and new_image_data may be the same buffer.
+// Returns -1 if more than SEAM_COLUMNS_ON_STACK seams need a column buffer that cannot be allocated.
+int remove_seams_sequential(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k) {
+    int stack_columns[SEAM_COLUMNS_ON_STACK + 1];
+    int* columns = k <= SEAM_COLUMNS_ON_STACK ? stack_columns : malloc(((size_t)k + 1) * sizeof(int));
+    if (!columns) {
+        perror("Seam column allocation failed");
+        return -1;
+    }
+    size_t row_bytes = (size_t)width * channels;
+    size_t new_row_bytes = (size_t)(width - k) * channels;
 
     for (int y = 0; y < height; ++y) {
-        int seam_x = seam[y];
-        for (int x = 0; x < seam_x; ++x) {
-            int src_idx = (y * width + x) * channels;
-            int dst_idx = (y * (width - 1) + x) * channels;
-            memcpy(&new_image_data[dst_idx], &image_data[src_idx], channels);
+        for (int s = 0; s < k; s++)
+            columns[s] = seams[(size_t)s * height + y];
+        qsort(columns, k, sizeof(int), compare_columns);
+        columns[k] = width;
+
+        unsigned char* src = image_data + y * row_bytes;
+        unsigned char* dst = new_image_data + y * new_row_bytes;
+        memmove(dst, src, (size_t)columns[0] * channels);
+        dst += (size_t)columns[0] * channels;
+        for (int s = 0; s < k; s++) {
+            size_t run = (size_t)(columns[s + 1] - columns[s] - 1) * channels;
+            memmove(dst, src + (size_t)(columns[s] + 1) * channels, run);
+            dst += run;
         }
-        for (int x = seam_x + 1; x < width; ++x) {
-            int src_idx = (y * width + x) * channels;
-            int dst_idx = (y * (width - 1) + (x - 1)) * channels;
-            memcpy(&new_image_data[dst_idx], &image_data[src_idx], channels);
+    }
+
+    if (columns != stack_columns)
+        free(columns);
+    return 0;
+}
+
+// Builds the enlarged image (width + k columns) in one pass: every seam pixel is followed by the average of
+// itself and its right neighbour; seams are in the coordinates of image_data and must be disjoint per row; returns -1 like remove_seams_sequential
+int insert_seams_sequential(unsigned char* image_data, unsigned char* new_image_data, int width, int height, int channels, int* seams, int k) {
+    int stack_columns[SEAM_COLUMNS_ON_STACK + 1];
+    int* columns = k <= SEAM_COLUMNS_ON_STACK ? stack_columns : malloc(((size_t)k + 1) * sizeof(int));
+    if (!columns) {
+        perror("Seam column allocation failed");
+        return -1;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int s = 0; s < k; s++)
+            columns[s] = seams[(size_t)s * height + y];
+        qsort(columns, k, sizeof(int), compare_columns);
+        columns[k] = width;
+
+        unsigned char* src = image_data + (size_t)y * width * channels;
+        unsigned char* dst = new_image_data + (size_t)y * (width + k) * channels;
+        int x = 0;
+        for (int s = 0; s <= k; s++) {
+            int run_end = s < k ? columns[s] + 1 : width;
+            memcpy(dst, src + (size_t)x * channels, (size_t)(run_end - x) * channels);
+            dst += (size_t)(run_end - x) * channels;
+            x = run_end;
+            if (s == k)
+                break;
+
+            unsigned char* left = src + (size_t)columns[s] * channels;
+            unsigned char* right = columns[s] + 1 < width ? left + channels : left;
+            for (int c = 0; c < channels; c++)
+                dst[c] = (left[c] + right[c]) / 2;
+            dst += channels;
         }
     }
 
+    if (columns != stack_columns)
+        free(columns);
+    return 0;
+}
+
+// Removes the computed seam from the image and saves the result as a new PNG file
+void remove_and_save_seam_sequential(unsigned char* image_data, int width, int height, int channels, int* seam, const char* output_filename) {
+    unsigned char* new_image_data = malloc((width - 1) * height * channels);
+
+    remove_seam_sequential(image_data, new_image_data, width, height, channels, seam);
+
     write_png_sequential(output_filename, new_image_data, width - 1, height, channels);
     free(new_image_data);
 }
-
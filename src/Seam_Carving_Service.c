@@ -0,0 +1,610 @@
+#include "../include/Seam_Carving_Service.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void service_options_init(service_options* options) {
+    options->socket_path = "seam_carving.sock";
+    options->concurrency = SERVICE_DEFAULT_CONCURRENCY;
+    options->batch_size = SERVICE_DEFAULT_BATCH;
+    options->large_image_pixels = BATCH_LARGE_IMAGE_PIXELS;
+    options->max_request = SERVICE_DEFAULT_MAX_REQUEST;
+    png_write_settings_init(&options->settings);
+}
+
+// Sends exactly `length` bytes; returns 0, or -1 on an error, a timeout or a closed peer
+static int send_all(int fd, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    while (length > 0) {
+        // A client that hung up must not take the whole service down with SIGPIPE
+        ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return -1;
+        bytes += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+// Receives exactly `length` bytes; returns 0, or -1 on an error, a timeout or a closed peer
+static int receive_all(int fd, void* data, size_t length) {
+    unsigned char* bytes = data;
+    while (length > 0) {
+        ssize_t received = recv(fd, bytes, length, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return -1;
+        bytes += received;
+        length -= received;
+    }
+    return 0;
+}
+
+// Receives exactly `length` bytes before omp_get_wtime() reaches `deadline`; returns 0, or -1 on an error, the
+// deadline or a closed peer. A client that trickles its bytes in cannot stretch the wait past the deadline.
+static int receive_all_before(int fd, void* data, size_t length, double deadline) {
+    unsigned char* bytes = data;
+    while (length > 0) {
+        int remaining_ms = (int)((deadline - omp_get_wtime()) * 1000);
+        if (remaining_ms <= 0)
+            return -1;
+
+        struct pollfd readable = { fd, POLLIN, 0 };
+        int ready = poll(&readable, 1, remaining_ms);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            return -1;
+
+        ssize_t received = recv(fd, bytes, length, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return -1;
+        bytes += received;
+        length -= received;
+    }
+    return 0;
+}
+
+static int socket_address(const char* socket_path, struct sockaddr_un* address) {
+    if (strlen(socket_path) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, socket_path);
+    return 0;
+}
+
+int service_connect(const char* socket_path) {
+    struct sockaddr_un address;
+    if (socket_address(socket_path, &address) != 0)
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket failed");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        perror(socket_path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int service_send_request(int fd, service_input kind, const void* input, size_t input_length, int target_width, int target_height, const char* output_path) {
+    size_t output_length = output_path ? strlen(output_path) : 0;
+    if (input_length == 0 || input_length > SERVICE_MAX_PAYLOAD || output_length > SERVICE_MAX_PAYLOAD) {
+        fprintf(stderr, "Request payload of %zu bytes is out of range\n", input_length);
+        return -1;
+    }
+
+    service_request request = {
+        .magic = SERVICE_REQUEST_MAGIC,
+        .input_kind = kind,
+        .target_width = target_width,
+        .target_height = target_height,
+        .input_length = (uint32_t)input_length,
+        .output_length = (uint32_t)output_length,
+    };
+    if (send_all(fd, &request, sizeof(request)) != 0 || send_all(fd, input, input_length) != 0 ||
+        send_all(fd, output_path, output_length) != 0)
+        return -1;
+    return 0;
+}
+
+int service_read_response(int fd, service_response* response, unsigned char** payload) {
+    *payload = NULL;
+    if (receive_all(fd, response, sizeof(*response)) != 0 || response->magic != SERVICE_RESPONSE_MAGIC)
+        return -1;
+    if (response->length == 0)
+        return 0;
+
+    *payload = malloc(response->length);
+    if (!*payload || receive_all(fd, *payload, response->length) != 0) {
+        free(*payload);
+        *payload = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// One accepted request on its way from the acceptor to the dispatcher
+typedef struct service_job {
+    int fd;
+    service_request request;
+    unsigned char* input;           // input_length bytes, NUL-terminated so that a path can be used as is
+    char* output_path;              // NULL sends the PNG back
+    long pixels;                    // From the PNG header, for scheduling; 0 if unknown
+    struct service_job* next;
+} service_job;
+
+typedef struct {
+    const service_options* options;
+    service_report* report;
+    int thread_count;               // Size of the dispatcher's OpenMP team
+    seam_carver* carvers;           // One per OpenMP thread of the dispatcher, kept for the life of the service
+    service_job** batch;
+    service_job* head;              // Accepted requests waiting for a batch, oldest first
+    service_job* tail;
+    int in_flight;                  // Accepted and not yet answered, those being read and queued included
+    int readers;                    // Reader threads still taking in a request
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t slot_free;
+    pthread_cond_t readers_done;
+} service_state;
+
+// What a reader thread is handed by the acceptor
+typedef struct {
+    service_state* state;
+    int fd;
+} service_reader;
+
+static volatile sig_atomic_t service_stopping = 0;
+
+static void request_stop(int signal_number) {
+    (void)signal_number;
+    service_stopping = 1;
+}
+
+// Answers with status -1 and the message as the payload
+static int send_failure(int fd, const char* message) {
+    service_response response = { SERVICE_RESPONSE_MAGIC, -1, 0, 0, (uint32_t)strlen(message) };
+    return send_all(fd, &response, sizeof(response)) == 0 && send_all(fd, message, response.length) == 0 ? 0 : -1;
+}
+
+static void free_job(service_job* job) {
+    close(job->fd);
+    free(job->input);
+    free(job->output_path);
+    free(job);
+}
+
+// Reads the request of an accepted connection, all of it within SERVICE_IO_TIMEOUT seconds. A malformed,
+// oversized or late one is answered and closed here; returns NULL then.
+static service_job* receive_job(int fd, size_t max_request) {
+    double deadline = omp_get_wtime() + SERVICE_IO_TIMEOUT;
+
+    // Bounds how long a client that does not read its response can hold up its carving thread
+    struct timeval timeout = { SERVICE_IO_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    service_job* job = calloc(1, sizeof(service_job));
+    if (!job) {
+        perror("Request allocation failed");
+        close(fd);
+        return NULL;
+    }
+    job->fd = fd;
+
+    service_request* request = &job->request;
+    const char* error = NULL;
+    if (receive_all_before(fd, request, sizeof(*request), deadline) != 0)
+        error = "Incomplete request";
+    else if (request->magic != SERVICE_REQUEST_MAGIC)
+        error = "Not a seam carving request";
+    else if (request->input_kind > SERVICE_INPUT_PNG || request->input_length == 0 || request->input_length > SERVICE_MAX_PAYLOAD ||
+             request->output_length > SERVICE_MAX_PAYLOAD || request->target_width < 0 || request->target_height < 0)
+        error = "Malformed request";
+    else if ((size_t)request->input_length + request->output_length > max_request)
+        error = "Request too large";
+    else {
+        job->input = malloc((size_t)request->input_length + 1);
+        job->output_path = request->output_length > 0 ? malloc((size_t)request->output_length + 1) : NULL;
+        if (!job->input || (request->output_length > 0 && !job->output_path))
+            error = "Request too large";
+        else if (receive_all_before(fd, job->input, request->input_length, deadline) != 0 ||
+                 (job->output_path && receive_all_before(fd, job->output_path, request->output_length, deadline) != 0))
+            error = "Incomplete request";
+    }
+
+    if (error) {
+        send_failure(fd, error);
+        free_job(job);
+        return NULL;
+    }
+
+    job->input[request->input_length] = '\0';
+    if (job->output_path)
+        job->output_path[request->output_length] = '\0';
+    job->pixels = request->input_kind == SERVICE_INPUT_PATH
+        ? png_pixel_count((const char*)job->input)
+        : png_header_pixel_count(job->input, request->input_length);
+    return job;
+}
+
+// Decodes, carves and encodes one request and answers it; the mode decides whether its kernels use the thread
+// team. Returns 0 once a carved image was delivered, -1 otherwise.
+static int serve_job(service_job* job, const service_options* options, carve_mode mode, seam_carver* carver) {
+    SEAM_TRACE_BEGIN(request_span, TRACE_REQUEST);
+    const service_request* request = &job->request;
+    service_response response = { SERVICE_RESPONSE_MAGIC, -1, 0, 0, 0 };
+    char message[512] = "";
+    unsigned char* image_data = NULL;
+    unsigned char* energy_map = NULL;
+    char* png_data = NULL;
+    size_t png_size = 0;
+    int width, height, channels;
+    int parallel = mode == CARVE_MODE_PARALLEL;
+
+    int read_status;
+    if (request->input_kind == SERVICE_INPUT_PATH) {
+        const char* path = (const char*)job->input;
+        read_status = parallel
+            ? read_png_streaming_parallel(path, &image_data, &energy_map, &width, &height, &channels)
+            : read_png_streaming_sequential(path, &image_data, &energy_map, &width, &height, &channels);
+    } else {
+        read_status = parallel
+            ? read_png_memory_streaming_parallel(job->input, request->input_length, &image_data, &energy_map, &width, &height, &channels)
+            : read_png_memory_streaming_sequential(job->input, request->input_length, &image_data, &energy_map, &width, &height, &channels);
+    }
+    if (read_status != 0) {
+        snprintf(message, sizeof(message), "Failed to read image");
+        goto respond;
+    }
+
+    int target_width = request->target_width > 0 ? request->target_width : width;
+    int target_height = request->target_height > 0 ? request->target_height : height;
+    if (target_width > width || target_height > height) {
+        snprintf(message, sizeof(message), "Cannot carve a %dx%d image to %dx%d", width, height, target_width, target_height);
+        goto respond;
+    }
+
+    carve_options carve;
+    carve_options_init(&carve, mode);
+    carve.carver = carver;
+    carve.initial_energy = energy_map;
+    int carve_status = target_height < height
+        ? carve_to_size(&image_data, &width, &height, channels, target_width, target_height, &carve)
+        : carve_seams(&image_data, &width, height, channels, width - target_width, &carve);
+    if (carve_status != 0) {
+        snprintf(message, sizeof(message), "Seam carving failed");
+        goto respond;
+    }
+
+    if (job->output_path) {
+        if (write_png_with_settings(job->output_path, image_data, width, height, channels, &options->settings) != 0) {
+            snprintf(message, sizeof(message), "Failed to write %s", job->output_path);
+            goto respond;
+        }
+    } else {
+        stream_encoder encoder;
+        int status = stream_encoder_open_memory(&encoder, &png_data, &png_size, width, height, channels, &options->settings);
+        if (status == 0)
+            status = stream_encoder_close(&encoder, stream_encoder_write_rows(&encoder, image_data, height));
+        if (status != 0 || png_size > UINT32_MAX) {
+            snprintf(message, sizeof(message), "Failed to encode the carved image");
+            goto respond;
+        }
+        response.length = (uint32_t)png_size;
+    }
+    response.status = 0;
+    response.width = width;
+    response.height = height;
+
+respond:;
+    const void* payload = png_data;
+    if (response.status != 0) {
+        payload = message;
+        response.length = (uint32_t)strlen(message);
+    }
+    int delivered = send_all(job->fd, &response, sizeof(response)) == 0 && send_all(job->fd, payload, response.length) == 0;
+
+    free(image_data);
+    free(energy_map);
+    free(png_data);
+    SEAM_TRACE_BYTES(request_span, sizeof(*request) + request->input_length + request->output_length, sizeof(response) + response.length);
+    SEAM_TRACE_END(request_span);
+    return response.status == 0 && delivered ? 0 : -1;
+}
+
+// Reader thread body: takes in one request and queues it for the dispatcher, or gives its slot back
+static void* read_job(void* arg) {
+    service_reader* reader = arg;
+    service_state* state = reader->state;
+    service_job* job = receive_job(reader->fd, state->options->max_request);
+    free(reader);
+
+    pthread_mutex_lock(&state->lock);
+    if (job) {
+        if (state->tail)
+            state->tail->next = job;
+        else
+            state->head = job;
+        state->tail = job;
+        pthread_cond_signal(&state->not_empty);
+    } else {
+        state->in_flight--;
+        state->report->requests++;
+        state->report->failures++;
+        pthread_cond_signal(&state->slot_free);
+    }
+    if (--state->readers == 0)
+        pthread_cond_broadcast(&state->readers_done);
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+}
+
+// Hands an accepted connection to a reader thread of its own, which blocks SIGINT and SIGTERM like the
+// dispatcher; returns -1 if the thread could not be started
+static int start_reader(service_state* state, int fd, const sigset_t* signals) {
+    service_reader* reader = malloc(sizeof(service_reader));
+    if (!reader)
+        return -1;
+    reader->state = state;
+    reader->fd = fd;
+
+    pthread_mutex_lock(&state->lock);
+    state->in_flight++;
+    state->readers++;
+    pthread_mutex_unlock(&state->lock);
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    sigset_t previous;
+    pthread_sigmask(SIG_BLOCK, signals, &previous);
+    pthread_t thread;
+    int started = pthread_create(&thread, &attributes, read_job, reader) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    pthread_attr_destroy(&attributes);
+    if (started)
+        return 0;
+
+    free(reader);
+    pthread_mutex_lock(&state->lock);
+    state->in_flight--;
+    state->readers--;
+    pthread_mutex_unlock(&state->lock);
+    return -1;
+}
+
+// Closes the connection of an answered request and frees its slot for the acceptor
+static void finish_job(service_state* state, service_job* job, int status) {
+    free_job(job);
+
+    pthread_mutex_lock(&state->lock);
+    state->in_flight--;
+    state->report->requests++;
+    if (status != 0)
+        state->report->failures++;
+    pthread_cond_signal(&state->slot_free);
+    pthread_mutex_unlock(&state->lock);
+}
+
+static int compare_jobs_by_size(const void* a, const void* b) {
+    const service_job* ja = *(service_job* const*)a;
+    const service_job* jb = *(service_job* const*)b;
+    return (ja->pixels < jb->pixels) - (ja->pixels > jb->pixels);
+}
+
+// Dispatcher thread body: takes whatever has queued up as the next batch and carves it on the OpenMP team,
+// which stays alive between batches since it always belongs to this thread
+static void* dispatch_jobs(void* arg) {
+    service_state* state = arg;
+    const service_options* options = state->options;
+
+    // A new thread starts from the default thread count, not from what --threads set on the main thread; the
+    // team must not outgrow the carvers sized for it
+    omp_set_num_threads(state->thread_count);
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        while (!state->head && !state->closed)
+            pthread_cond_wait(&state->not_empty, &state->lock);
+        if (!state->head) {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+
+        int count = 0;
+        while (state->head && count < options->batch_size) {
+            state->batch[count++] = state->head;
+            state->head = state->head->next;
+        }
+        if (!state->head)
+            state->tail = NULL;
+        state->report->batches++;
+        pthread_mutex_unlock(&state->lock);
+
+        // Largest first, as in run_batch; a request on its own gets the whole team however small it is
+        qsort(state->batch, count, sizeof(service_job*), compare_jobs_by_size);
+        int first_small = 0;
+        while (first_small < count && (count == 1 || state->batch[first_small]->pixels >= options->large_image_pixels)) {
+            service_job* job = state->batch[first_small++];
+            finish_job(state, job, serve_job(job, options, CARVE_MODE_PARALLEL, &state->carvers[0]));
+        }
+
+        if (first_small < count) {
+            #pragma omp parallel
+            #pragma omp single
+            for (int i = first_small; i < count; i++) {
+                #pragma omp task firstprivate(i)
+                {
+                    service_job* job = state->batch[i];
+                    finish_job(state, job, serve_job(job, options, CARVE_MODE_SEQUENTIAL, &state->carvers[omp_get_thread_num()]));
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+// Binds the listening socket, replacing a socket file that no service answers on any more; returns it or -1
+static int listen_on(const char* socket_path, int backlog) {
+    struct sockaddr_un address;
+    if (socket_address(socket_path, &address) != 0)
+        return -1;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket failed");
+        return -1;
+    }
+
+    struct stat info;
+    if (stat(socket_path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+        if (connect(listener, (struct sockaddr*)&address, sizeof(address)) == 0) {
+            fprintf(stderr, "A service is already listening on %s\n", socket_path);
+            close(listener);
+            return -1;
+        }
+        unlink(socket_path);
+    }
+
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, backlog) != 0) {
+        perror(socket_path);
+        close(listener);
+        return -1;
+    }
+
+    // accept() also wakes up every second, in case a signal landed just before it was entered
+    struct timeval timeout = { 1, 0 };
+    setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return listener;
+}
+
+// Serves requests until SIGINT or SIGTERM; the calling thread accepts, reader threads take in the requests and
+// the dispatcher carves
+int run_service(const service_options* options, service_report* report) {
+    memset(report, 0, sizeof(*report));
+    if (options->concurrency < 1 || options->batch_size < 1) {
+        fprintf(stderr, "Concurrency and batch size must be positive\n");
+        return -1;
+    }
+
+    int listener = listen_on(options->socket_path, options->concurrency);
+    if (listener < 0)
+        return -1;
+
+    int thread_count = omp_get_max_threads();
+    service_state state = { .options = options, .report = report, .thread_count = thread_count };
+    state.carvers = malloc(thread_count * sizeof(seam_carver));
+    state.batch = malloc(options->batch_size * sizeof(service_job*));
+    if (!state.carvers || !state.batch) {
+        perror("Service allocation failed");
+        free(state.carvers);
+        free(state.batch);
+        close(listener);
+        unlink(options->socket_path);
+        return -1;
+    }
+    for (int t = 0; t < thread_count; t++)
+        seam_carver_init(&state.carvers[t]);
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.not_empty, NULL);
+    pthread_cond_init(&state.slot_free, NULL);
+    pthread_cond_init(&state.readers_done, NULL);
+
+    // The dispatcher and its team block SIGINT and SIGTERM, so that they interrupt accept() on this thread
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+    int status = 0;
+    pthread_t dispatcher;
+    int dispatching = pthread_create(&dispatcher, NULL, dispatch_jobs, &state) == 0;
+    if (!dispatching) {
+        perror("Failed to start the dispatcher");
+        status = -1;
+    }
+
+    // No SA_RESTART: the signal has to break accept() out
+    struct sigaction action, previous_int, previous_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    service_stopping = 0;
+    sigaction(SIGINT, &action, &previous_int);
+    sigaction(SIGTERM, &action, &previous_term);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    double start = omp_get_wtime();
+    while (status == 0 && !service_stopping) {
+        pthread_mutex_lock(&state.lock);
+        while (state.in_flight >= options->concurrency)
+            pthread_cond_wait(&state.slot_free, &state.lock);
+        pthread_mutex_unlock(&state.lock);
+
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED) {
+                perror("accept failed");
+                status = -1;
+            }
+            continue;
+        }
+
+        if (start_reader(&state, fd, &signals) != 0) {
+            perror("Failed to start a reader");
+            send_failure(fd, "Service overloaded");
+            close(fd);
+            pthread_mutex_lock(&state.lock);
+            report->requests++;
+            report->failures++;
+            pthread_mutex_unlock(&state.lock);
+        }
+    }
+
+    // Whatever was accepted is still read, carved and answered before the dispatcher stops
+    pthread_mutex_lock(&state.lock);
+    while (state.readers > 0)
+        pthread_cond_wait(&state.readers_done, &state.lock);
+    state.closed = 1;
+    pthread_cond_broadcast(&state.not_empty);
+    pthread_mutex_unlock(&state.lock);
+    if (dispatching)
+        pthread_join(dispatcher, NULL);
+    report->seconds = omp_get_wtime() - start;
+
+    sigaction(SIGINT, &previous_int, NULL);
+    sigaction(SIGTERM, &previous_term, NULL);
+    close(listener);
+    unlink(options->socket_path);
+
+    for (int t = 0; t < thread_count; t++)
+        seam_carver_free(&state.carvers[t]);
+    free(state.carvers);
+    free(state.batch);
+    pthread_mutex_destroy(&state.lock);
+    pthread_cond_destroy(&state.not_empty);
+    pthread_cond_destroy(&state.slot_free);
+    pthread_cond_destroy(&state.readers_done);
+    return status;
+}
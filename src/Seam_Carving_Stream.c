@@ -0,0 +1,318 @@
+#include "../include/Seam_Carving_Stream.h"
+
+void stream_decoder_close(stream_decoder* decoder) {
+    png_destroy_read_struct(&decoder->png, &decoder->info, NULL);
+    if (decoder->fp)
+        fclose(decoder->fp);
+}
+
+// Reads the header from an open stream, which the decoder then owns, and applies the same expansions as
+// read_png_sequential; returns 0 or -1
+static int stream_decoder_start(stream_decoder* decoder, FILE* fp, const char* name) {
+    decoder->png = NULL;
+    decoder->info = NULL;
+    decoder->fp = fp;
+    if (!decoder->fp) {
+        perror("File opening failed");
+        return -1;
+    }
+
+    decoder->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (decoder->png)
+        decoder->info = png_create_info_struct(decoder->png);
+    if (!decoder->info || setjmp(png_jmpbuf(decoder->png))) {
+        fprintf(stderr, "Failed to read PNG header: %s\n", name);
+        stream_decoder_close(decoder);
+        return -1;
+    }
+
+    png_init_io(decoder->png, decoder->fp);
+    png_read_info(decoder->png, decoder->info);
+
+    png_byte color_type = png_get_color_type(decoder->png, decoder->info);
+    png_byte bit_depth = png_get_bit_depth(decoder->png, decoder->info);
+
+    if (bit_depth == 16)
+        png_set_strip_16(decoder->png);
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(decoder->png);
+    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+        png_set_expand_gray_1_2_4_to_8(decoder->png);
+    if (png_get_valid(decoder->png, decoder->info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(decoder->png);
+    decoder->passes = png_set_interlace_handling(decoder->png);
+
+    png_read_update_info(decoder->png, decoder->info);
+
+    // Channels after the expansions, so palette and tRNS images report what actually lands in the buffer
+    decoder->width = png_get_image_width(decoder->png, decoder->info);
+    decoder->height = png_get_image_height(decoder->png, decoder->info);
+    decoder->channels = png_get_channels(decoder->png, decoder->info);
+    decoder->row_bytes = png_get_rowbytes(decoder->png, decoder->info);
+    return 0;
+}
+
+int stream_decoder_open(stream_decoder* decoder, const char* filename) {
+    return stream_decoder_start(decoder, fopen(filename, "rb"), filename);
+}
+
+int stream_decoder_open_memory(stream_decoder* decoder, const unsigned char* png_data, size_t size) {
+    // fmemopen only reads the buffer in "rb" mode
+    return stream_decoder_start(decoder, size > 0 ? fmemopen((void*)png_data, size, "rb") : NULL, "<memory>");
+}
+
+// Decodes the next count rows of the current pass, row_bytes apart; returns -1 if libpng reports an error
+int stream_decoder_read_rows(stream_decoder* decoder, unsigned char* rows, int count) {
+    if (setjmp(png_jmpbuf(decoder->png)))
+        return -1;
+
+    for (int y = 0; y < count; y++)
+        png_read_row(decoder->png, rows + (size_t)y * decoder->row_bytes, NULL);
+    return 0;
+}
+
+// Interlaced images: every pass rewrites the rows, so they are only final once all passes are through
+static int stream_read_interlaced(stream_decoder* decoder, unsigned char* image_data) {
+    for (int pass = 0; pass < decoder->passes; pass++) {
+        if (stream_decoder_read_rows(decoder, image_data, decoder->height) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Allocates the image and energy buffers for the decoder's size
+static int stream_allocate(const stream_decoder* decoder, unsigned char** image_data, unsigned char** energy_map) {
+    *image_data = malloc(decoder->row_bytes * decoder->height);
+    *energy_map = malloc((size_t)decoder->width * decoder->height);
+    SEAM_TRACE_ALLOCATION(decoder->row_bytes * decoder->height + (size_t)decoder->width * decoder->height);
+    if (!*image_data || !*energy_map) {
+        perror("Failed to allocate image buffers");
+        free(*image_data);
+        free(*energy_map);
+        return -1;
+    }
+    return 0;
+}
+
+// Hands the decoded buffers and dimensions to the caller, or frees them after a failed decode
+static int stream_finish(stream_decoder* decoder, int status, const char* filename, unsigned char* image, unsigned char* energy,
+                         unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    if (status == 0) {
+        *image_data = image;
+        *energy_map = energy;
+        *width = decoder->width;
+        *height = decoder->height;
+        *channels = decoder->channels;
+    } else {
+        fprintf(stderr, "Failed to decode PNG: %s\n", filename);
+        free(image);
+        free(energy);
+    }
+    stream_decoder_close(decoder);
+    return status;
+}
+
+// Decodes one row at a time and computes the energy of the row above it while both are still in cache
+static int stream_decode_sequential(stream_decoder* decoder, const char* name, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    SEAM_TRACE_BEGIN(span, TRACE_DECODE);
+    unsigned char* image;
+    unsigned char* energy;
+    if (stream_allocate(decoder, &image, &energy) != 0) {
+        stream_decoder_close(decoder);
+        SEAM_TRACE_END(span);
+        return -1;
+    }
+
+    int w = decoder->width, h = decoder->height, c = decoder->channels;
+    int status = 0;
+
+    if (decoder->passes > 1) {
+        status = stream_read_interlaced(decoder, image);
+        if (status == 0)
+            compute_energy_map_sequential(image, w, h, c, energy);
+    } else {
+        for (int y = 0; y < h && status == 0; y++) {
+            status = stream_decoder_read_rows(decoder, image + (size_t)y * decoder->row_bytes, 1);
+            if (status == 0 && y > 0)
+                compute_energy_row(image, w, h, c, y - 1, 0, w, energy + (size_t)(y - 1) * w);
+        }
+        if (status == 0)
+            compute_energy_row(image, w, h, c, h - 1, 0, w, energy + (size_t)(h - 1) * w);
+    }
+
+    SEAM_TRACE_BYTES(span, ftell(decoder->fp), 0);
+    SEAM_TRACE_END(span);
+    return stream_finish(decoder, status, name, image, energy, image_data, energy_map, width, height, channels);
+}
+
+int read_png_streaming_sequential(const char* filename, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    stream_decoder decoder;
+    if (stream_decoder_open(&decoder, filename) != 0)
+        return -1;
+    return stream_decode_sequential(&decoder, filename, image_data, energy_map, width, height, channels);
+}
+
+int read_png_memory_streaming_sequential(const unsigned char* png_data, size_t size, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    stream_decoder decoder;
+    if (stream_decoder_open_memory(&decoder, png_data, size) != 0)
+        return -1;
+    return stream_decode_sequential(&decoder, "<memory>", image_data, energy_map, width, height, channels);
+}
+
+// Parallelize the streaming reader with OpenMP: one thread decodes and spawns a task for every
+// STREAM_ENERGY_ROWS energy rows whose neighbours have arrived, which the other threads pick up meanwhile
+static int stream_decode_parallel(stream_decoder* decoder, const char* name, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    SEAM_TRACE_BEGIN(span, TRACE_DECODE);
+    unsigned char* image;
+    unsigned char* energy;
+    if (stream_allocate(decoder, &image, &energy) != 0) {
+        stream_decoder_close(decoder);
+        SEAM_TRACE_END(span);
+        return -1;
+    }
+
+    int w = decoder->width, h = decoder->height, c = decoder->channels;
+    int status = 0;
+
+    if (decoder->passes > 1) {
+        status = stream_read_interlaced(decoder, image);
+        if (status == 0)
+            compute_energy_map_parallel(image, w, h, c, energy);
+    } else {
+        #pragma omp parallel
+        #pragma omp single
+        {
+            int ready = 0;      // Energy rows [0, ready) already handed to tasks
+
+            for (int y = 0; y < h; y += STREAM_ENERGY_ROWS) {
+                int end = y + STREAM_ENERGY_ROWS < h ? y + STREAM_ENERGY_ROWS : h;
+                if (stream_decoder_read_rows(decoder, image + (size_t)y * decoder->row_bytes, end - y) != 0) {
+                    status = -1;
+                    break;
+                }
+
+                // Row r needs row r + 1, so the newest decoded row waits for the next chunk
+                int available = end == h ? h : end - 1;
+                int begin = ready;
+                #pragma omp task firstprivate(begin, available)
+                for (int r = begin; r < available; r++)
+                    compute_energy_row(image, w, h, c, r, 0, w, energy + (size_t)r * w);
+                ready = available;
+            }
+        }
+    }
+
+    SEAM_TRACE_BYTES(span, ftell(decoder->fp), 0);
+    SEAM_TRACE_END(span);
+    return stream_finish(decoder, status, name, image, energy, image_data, energy_map, width, height, channels);
+}
+
+int read_png_streaming_parallel(const char* filename, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    stream_decoder decoder;
+    if (stream_decoder_open(&decoder, filename) != 0)
+        return -1;
+    return stream_decode_parallel(&decoder, filename, image_data, energy_map, width, height, channels);
+}
+
+int read_png_memory_streaming_parallel(const unsigned char* png_data, size_t size, unsigned char** image_data, unsigned char** energy_map, int* width, int* height, int* channels) {
+    stream_decoder decoder;
+    if (stream_decoder_open_memory(&decoder, png_data, size) != 0)
+        return -1;
+    return stream_decode_parallel(&decoder, "<memory>", image_data, energy_map, width, height, channels);
+}
+
+// Checks the channel count and starts encoding into an open stream, which the encoder then owns
+static int stream_encoder_start(stream_encoder* encoder, FILE* fp, const char* name, int width, int height, int channels, const png_write_settings* settings) {
+    encoder->png = NULL;
+    encoder->info = NULL;
+    encoder->row_bytes = (size_t)width * channels;
+    encoder->fp = fp;
+
+    int color_type = png_color_type_for(channels);
+    if (color_type < 0) {
+        fprintf(stderr, "Cannot write a PNG with %d channels: %s\n", channels, name);
+        if (encoder->fp)
+            fclose(encoder->fp);
+        encoder->fp = NULL;
+        return -1;
+    }
+
+    if (!encoder->fp) {
+        perror("File opening failed");
+        return -1;
+    }
+
+    encoder->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (encoder->png)
+        encoder->info = png_create_info_struct(encoder->png);
+    if (!encoder->info || setjmp(png_jmpbuf(encoder->png))) {
+        fprintf(stderr, "Failed to write PNG header: %s\n", name);
+        png_destroy_write_struct(&encoder->png, &encoder->info);
+        fclose(encoder->fp);
+        encoder->fp = NULL;
+        return -1;
+    }
+
+    png_init_io(encoder->png, encoder->fp);
+    if (settings && settings->compression_level >= 0)
+        png_set_compression_level(encoder->png, settings->compression_level);
+    if (settings && settings->filters >= 0)
+        png_set_filter(encoder->png, PNG_FILTER_TYPE_BASE, settings->filters);
+
+    png_set_IHDR(encoder->png, encoder->info, width, height, 8, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(encoder->png, encoder->info);
+    return 0;
+}
+
+int stream_encoder_open(stream_encoder* encoder, const char* filename, int width, int height, int channels, const png_write_settings* settings) {
+    return stream_encoder_start(encoder, png_color_type_for(channels) >= 0 ? fopen(filename, "wb") : NULL, filename, width, height, channels, settings);
+}
+
+int stream_encoder_open_memory(stream_encoder* encoder, char** png_data, size_t* size, int width, int height, int channels, const png_write_settings* settings) {
+    *png_data = NULL;
+    *size = 0;
+    return stream_encoder_start(encoder, png_color_type_for(channels) >= 0 ? open_memstream(png_data, size) : NULL, "<memory>", width, height, channels, settings);
+}
+
+// Encodes the next count rows, row_bytes apart; returns -1 if libpng reports an error
+static int stream_encoder_rows(stream_encoder* encoder, const unsigned char* rows, int count) {
+    if (setjmp(png_jmpbuf(encoder->png)))
+        return -1;
+
+    for (int y = 0; y < count; y++)
+        png_write_row(encoder->png, rows + (size_t)y * encoder->row_bytes);
+    return 0;
+}
+
+int stream_encoder_write_rows(stream_encoder* encoder, const unsigned char* rows, int count) {
+    SEAM_TRACE_BEGIN(span, TRACE_ENCODE);
+    int status = stream_encoder_rows(encoder, rows, count);
+    SEAM_TRACE_END(span);
+    return status;
+}
+
+static int stream_encoder_end(stream_encoder* encoder) {
+    if (setjmp(png_jmpbuf(encoder->png)))
+        return -1;
+
+    png_write_end(encoder->png, NULL);
+    return 0;
+}
+
+// Writes the end of the file once every row is in; with status -1 the file is only closed. Returns 0 or -1.
+int stream_encoder_close(stream_encoder* encoder, int status) {
+    if (!encoder->fp)
+        return -1;
+
+    SEAM_TRACE_BEGIN(span, TRACE_ENCODE);
+    if (status == 0)
+        status = stream_encoder_end(encoder);
+    SEAM_TRACE_BYTES(span, 0, ftell(encoder->fp));
+    SEAM_TRACE_END(span);
+
+    png_destroy_write_struct(&encoder->png, &encoder->info);
+    if (fclose(encoder->fp) != 0)
+        status = -1;
+    encoder->fp = NULL;
+    return status;
+}
@@ -0,0 +1,494 @@
+#include "../include/Seam_Carving_Tiled.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void tiled_options_init(tiled_options* options, carve_mode mode) {
+    options->mode = mode;
+    options->memory_budget = TILED_DEFAULT_BUDGET;
+    options->scratch_dir = NULL;
+    png_write_settings_init(&options->settings);
+}
+
+// A mapped byte range of a scratch file; mappings start on a page boundary, so the range may begin inside one
+typedef struct {
+    void* base;
+    size_t length;
+} tiled_window;
+
+// The image being carved and the scratch files that hold it
+typedef struct {
+    int parallel;
+    int image_fd;                   // Decoded pixels, original_width * channels bytes per row
+    int plane_fd;                   // Channel 0 as a packed plane, width bytes per row; the image itself for gray
+    int steps_fd;                   // Packed steps of the seam being searched
+    int seams_fd;                   // Removed seams in the columns of the plane they were removed from
+    int original_width;
+    int height;
+    int channels;
+    int width;                      // Width of the plane, with the pending seam still in it
+    int search_rows;                // Rows per strip of the plane sweeps (even, so the rolling rows keep parity)
+    int gather_rows;                // Rows per strip of the final gather and encode
+    int decode_rows;                // Rows per strip while decoding
+    uint32_t* cost_rows;
+    unsigned char* energy_row;
+    int* seam;
+    int* pending;                   // Seam the next sweep takes out of the plane, when has_pending is set
+    int has_pending;
+} tiled_carve;
+
+// Creates a scratch file of the given size in dir and unlinks it right away, so it goes when it is closed;
+// returns the descriptor or -1
+static int open_scratch(const char* dir, size_t bytes) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/seam_scratch_XXXXXX", dir);
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Scratch file creation failed");
+        return -1;
+    }
+    unlink(path);
+
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        perror("Scratch file sizing failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Maps bytes [begin, end) of a scratch file and returns the address of byte begin, or NULL
+static unsigned char* map_range(int fd, size_t begin, size_t end, int writable, tiled_window* window) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t aligned = begin / page * page;
+
+    window->length = end - aligned;
+    window->base = mmap(NULL, window->length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, (off_t)aligned);
+    if (window->base == MAP_FAILED) {
+        perror("Scratch file mapping failed");
+        window->base = NULL;
+        return NULL;
+    }
+
+    // Strips are walked front to back, so let the kernel read ahead
+    madvise(window->base, window->length, MADV_SEQUENTIAL);
+    return (unsigned char*)window->base + (begin - aligned);
+}
+
+static void unmap_range(tiled_window* window) {
+    if (window->base)
+        munmap(window->base, window->length);
+    window->base = NULL;
+}
+
+// Rows of row_bytes each that fit in the bytes available, at most height
+static int rows_within(size_t available, size_t row_bytes, int height) {
+    size_t rows = available / row_bytes;
+    return rows < (size_t)height ? (int)rows : height;
+}
+
+// Splits the budget: the rows the carve always keeps come first, then every sweep gets as many rows per strip
+// as fit in the rest; returns 0 or -1 if the budget cannot hold two rows
+static int plan_strips(tiled_carve* carve, size_t budget, int seams) {
+    int w = carve->original_width, h = carve->height, c = carve->channels;
+    size_t row_bytes = (size_t)w * c;
+
+    // Rolling cost rows, the energy row, the seam and the pending seam, and the halo rows of a plane strip
+    size_t fixed = TILED_RESERVED_BYTES + 2 * (size_t)w * sizeof(uint32_t) + w + 2 * (size_t)h * sizeof(int) + 2 * ((size_t)w + 1);
+    size_t available = budget > fixed ? budget - fixed : 0;
+
+    size_t search_row = (size_t)w + 1 + SEAM_STEP_ROW_BYTES(w);
+    size_t decode_row = row_bytes + (c > 1 ? (size_t)w : 0);
+    size_t gather_row = c > 1
+        ? row_bytes + (size_t)(w - seams) * c + ((size_t)seams + 1) * sizeof(int) + (size_t)LAZY_BLOCKS(w) * (sizeof(uint64_t) + sizeof(int))
+        : (size_t)(w - seams);
+
+    carve->search_rows = rows_within(available, search_row, h);
+    if (carve->search_rows < h)
+        carve->search_rows &= ~1;
+    carve->decode_rows = rows_within(available, decode_row, h);
+    carve->gather_rows = rows_within(available, gather_row, h);
+
+    if (carve->search_rows < 1 || carve->decode_rows < 1 || carve->gather_rows < 1) {
+        fprintf(stderr, "A memory budget of %zu bytes is too small for a %dx%d image\n", budget, w, h);
+        return -1;
+    }
+    return 0;
+}
+
+// Decodes the PNG into the scratch image strip by strip; once the last pass has filled a strip, its channel 0
+// is copied into the plane
+static int decode_to_scratch(tiled_carve* carve, stream_decoder* decoder) {
+    int w = carve->original_width, h = carve->height, c = carve->channels;
+    size_t row_bytes = decoder->row_bytes;
+
+    for (int pass = 0; pass < decoder->passes; pass++) {
+        for (int y0 = 0; y0 < h; y0 += carve->decode_rows) {
+            int y1 = y0 + carve->decode_rows < h ? y0 + carve->decode_rows : h;
+            tiled_window image_window, plane_window = { NULL, 0 };
+
+            unsigned char* image = map_range(carve->image_fd, (size_t)y0 * row_bytes, (size_t)y1 * row_bytes, 1, &image_window);
+            if (!image)
+                return -1;
+
+            int status = stream_decoder_read_rows(decoder, image, y1 - y0);
+            if (status == 0 && pass == decoder->passes - 1 && c > 1) {
+                unsigned char* plane = map_range(carve->plane_fd, (size_t)y0 * w, (size_t)y1 * w, 1, &plane_window);
+                if (!plane)
+                    status = -1;
+                else {
+                    #pragma omp parallel for schedule(static) if (carve->parallel)
+                    for (int y = 0; y < y1 - y0; y++)
+                        copy_channel0(image + (size_t)y * row_bytes, c, plane + (size_t)y * w, w);
+                }
+            }
+
+            unmap_range(&plane_window);
+            unmap_range(&image_window);
+            if (status != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// Energy of rows [y0, y1), from plane rows [first, last) mapped at plane, run through the rolling-row DP with
+// the strip's packed steps going to steps. y0 is even, so the strip-local rows keep the rolling rows' parity.
+static void search_strip(tiled_carve* carve, const unsigned char* plane, int first, int last, int y0, int y1, unsigned char* steps) {
+    int w = carve->width;
+    int blocks = (w + SEAM_ROW_BLOCK_COLUMNS - 1) / SEAM_ROW_BLOCK_COLUMNS;
+    uint32_t* cost_rows = carve->cost_rows;
+    unsigned char* energy_row = carve->energy_row;
+
+    #pragma omp parallel if (carve->parallel && w >= SEAM_PARALLEL_MIN_WIDTH)
+    for (int y = y0; y < y1; y++) {
+        #pragma omp for schedule(static)
+        for (int block = 0; block < blocks; block++) {
+            int x_begin = block * SEAM_ROW_BLOCK_COLUMNS;
+            int x_end = x_begin + SEAM_ROW_BLOCK_COLUMNS < w ? x_begin + SEAM_ROW_BLOCK_COLUMNS : w;
+
+            // The strip's first and last mapped rows are its neighbours, so only the image borders clamp
+            compute_energy_row(plane, w, last - first, 1, y - first, x_begin, x_end, energy_row);
+            if (y == 0) {
+                for (int x = x_begin; x < x_end; x++)
+                    cost_rows[x] = energy_row[x];
+            } else {
+                seam_compact_row(energy_row, w, y - y0, cost_rows, steps, x_begin, x_end);
+            }
+        }
+    }
+}
+
+// One pass down the plane. Every strip first has the pending seam taken out of its rows and of the row below
+// it, which its last energy row reads; when searching, its energy rows then go through the DP and its steps
+// are spilled. Returns 0 or -1.
+static int sweep_plane(tiled_carve* carve, int search) {
+    int h = carve->height;
+    int old_width = carve->width;
+    int w = carve->has_pending ? old_width - 1 : old_width;
+    size_t step_row_bytes = SEAM_STEP_ROW_BYTES(w);
+    int compacted = carve->has_pending ? 0 : h;     // Rows [0, compacted) are already w wide
+
+    carve->width = w;
+    carve->has_pending = 0;
+
+    for (int y0 = 0; y0 < h; y0 += carve->search_rows) {
+        int y1 = y0 + carve->search_rows < h ? y0 + carve->search_rows : h;
+        int first = y0 > 0 ? y0 - 1 : 0;
+        int last = search && y1 < h ? y1 + 1 : y1;
+
+        // Rows still to be compacted are read at their old, wider offsets, which reach further into the file
+        size_t end = (size_t)last * (compacted < last ? old_width : w);
+        tiled_window plane_window, steps_window = { NULL, 0 };
+        unsigned char* plane = map_range(carve->plane_fd, (size_t)first * w, end, 1, &plane_window);
+        if (!plane)
+            return -1;
+
+        // Front to back, as in remove_seam_sequential, so no row is overwritten before it has moved
+        if (compacted < last) {
+            unsigned char* source = plane + ((size_t)compacted * old_width - (size_t)first * w);
+            remove_seam_sequential(source, plane + (size_t)(compacted - first) * w, old_width, last - compacted, 1, carve->pending + compacted);
+            compacted = last;
+        }
+
+        int status = 0;
+        if (search) {
+            unsigned char* steps = map_range(carve->steps_fd, (size_t)y0 * step_row_bytes, (size_t)y1 * step_row_bytes, 1, &steps_window);
+            if (steps)
+                search_strip(carve, plane, first, last, y0, y1, steps);
+            else
+                status = -1;
+        }
+
+        unmap_range(&steps_window);
+        unmap_range(&plane_window);
+        if (status != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Follows the spilled steps up from the cheapest cell of the last row, a strip at a time from the bottom
+static int trace_spilled_steps(tiled_carve* carve) {
+    int w = carve->width, h = carve->height;
+    size_t step_row_bytes = SEAM_STEP_ROW_BYTES(w);
+    uint32_t* last_row = carve->cost_rows + (size_t)((h - 1) & 1) * w;
+
+    int x = 0;
+    for (int candidate = 1; candidate < w; candidate++) {
+        if (last_row[candidate] < last_row[x])
+            x = candidate;
+    }
+
+    int strips = (h + carve->search_rows - 1) / carve->search_rows;
+    for (int strip = strips - 1; strip >= 0; strip--) {
+        int y0 = strip * carve->search_rows;
+        int y1 = y0 + carve->search_rows < h ? y0 + carve->search_rows : h;
+        tiled_window window;
+        const unsigned char* steps = map_range(carve->steps_fd, (size_t)y0 * step_row_bytes, (size_t)y1 * step_row_bytes, 0, &window);
+        if (!steps)
+            return -1;
+
+        for (int y = y1 - 1; y >= y0; y--) {
+            carve->seam[y] = x;
+            if (y > 0) {
+                int packed = steps[(size_t)(y - y0) * step_row_bytes + (x >> 2)];
+                x += ((packed >> ((x & 3) * 2)) & 3) - 1;
+            }
+        }
+        unmap_range(&window);
+    }
+    return 0;
+}
+
+// Reads rows [y0, y0 + rows) of every logged seam into seams[s * rows + y]
+static int read_strip_seams(const tiled_carve* carve, int count, int y0, int rows, int* seams) {
+    size_t bytes = (size_t)rows * sizeof(int);
+    for (int s = 0; s < count; s++) {
+        off_t offset = ((off_t)s * carve->height + y0) * (off_t)sizeof(int);
+        if (pread(carve->seams_fd, seams + (size_t)s * rows, bytes, offset) != (ssize_t)bytes) {
+            perror("Seam log read failed");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Streams the carved image to the encoder a strip at a time. For gray images the compacted plane is the
+// result; otherwise each strip replays the logged seams on its own alive masks and gathers the surviving
+// pixels from the scratch image.
+static int write_carved(tiled_carve* carve, const char* output, int seams, const png_write_settings* settings) {
+    int w = carve->width, h = carve->height, c = carve->channels;
+    int rows = carve->gather_rows;
+    size_t row_bytes = (size_t)carve->original_width * c;
+    size_t masks = (size_t)rows * LAZY_BLOCKS(carve->original_width);
+
+    stream_encoder encoder;
+    if (stream_encoder_open(&encoder, output, w, h, c, settings) != 0)
+        return -1;
+
+    unsigned char* carved = NULL;
+    uint64_t* alive = NULL;
+    int* counts = NULL;
+    int* strip_seams = NULL;
+    int* originals = NULL;
+    int status = 0;
+    if (c > 1) {
+        carved = malloc((size_t)rows * w * c);
+        alive = malloc(masks * sizeof(uint64_t));
+        counts = malloc(masks * sizeof(int));
+        strip_seams = malloc((size_t)(seams > 0 ? seams : 1) * rows * sizeof(int));
+        originals = malloc((size_t)rows * sizeof(int));
+        if (!carved || !alive || !counts || !strip_seams || !originals) {
+            perror("Gather buffer allocation failed");
+            status = -1;
+        }
+    }
+
+    for (int y0 = 0; y0 < h && status == 0; y0 += rows) {
+        int count = y0 + rows < h ? rows : h - y0;
+        tiled_window window = { NULL, 0 };
+
+        if (c == 1) {
+            const unsigned char* plane = map_range(carve->plane_fd, (size_t)y0 * w, (size_t)(y0 + count) * w, 0, &window);
+            status = plane ? stream_encoder_write_rows(&encoder, plane, count) : -1;
+        } else {
+            unsigned char* image = map_range(carve->image_fd, (size_t)y0 * row_bytes, (size_t)(y0 + count) * row_bytes, 0, &window);
+            status = image ? read_strip_seams(carve, seams, y0, count, strip_seams) : -1;
+            if (status == 0) {
+                SEAM_TRACE_BEGIN_INDEX(gather_span, TRACE_GATHER, y0);
+                lazy_columns columns;
+                lazy_columns_init(&columns, alive, counts, carve->original_width, count);
+                // Each seam was found after the one before it came out, so they are replayed one at a time
+                for (int s = 0; s < seams; s++)
+                    lazy_columns_remove_seams(&columns, strip_seams + (size_t)s * count, 1, originals);
+                if (carve->parallel)
+                    gather_columns_parallel(&columns, image, carved, c);
+                else
+                    gather_columns_sequential(&columns, image, carved, c);
+                SEAM_TRACE_END(gather_span);
+                status = stream_encoder_write_rows(&encoder, carved, count);
+            }
+        }
+        unmap_range(&window);
+    }
+
+    free(carved);
+    free(alive);
+    free(counts);
+    free(strip_seams);
+    free(originals);
+    return stream_encoder_close(&encoder, status);
+}
+
+// Directory of path into dir, "." when it has none
+static void parent_directory(const char* path, char* dir, size_t size) {
+    const char* slash = strrchr(path, '/');
+    if (!slash)
+        snprintf(dir, size, ".");
+    else if (slash == path)
+        snprintf(dir, size, "/");
+    else
+        snprintf(dir, size, "%.*s", (int)(slash - path), path);
+}
+
+int carve_png_tiled(const char* input, const char* output, int target_width, int seams, const tiled_options* options) {
+    stream_decoder decoder;
+    if (stream_decoder_open(&decoder, input) != 0)
+        return -1;
+
+    SEAM_TRACE_BEGIN(carve_span, TRACE_CARVE);
+    tiled_carve carve = { 0 };
+    carve.parallel = options->mode == CARVE_MODE_PARALLEL;
+    carve.image_fd = carve.plane_fd = carve.steps_fd = carve.seams_fd = -1;
+    carve.original_width = carve.width = decoder.width;
+    carve.height = decoder.height;
+    carve.channels = decoder.channels;
+
+    int status = -1;
+    int decoding = 1;
+    int w = decoder.width, h = decoder.height, c = decoder.channels;
+    if (target_width > 0)
+        seams = w - target_width;
+    if (seams < 0 || seams >= w) {
+        fprintf(stderr, "Cannot remove %d seams from an image %d pixels wide\n", seams, w);
+        goto cleanup;
+    }
+    if (plan_strips(&carve, options->memory_budget, seams) != 0)
+        goto cleanup;
+
+    char dir[1024];
+    if (options->scratch_dir)
+        snprintf(dir, sizeof(dir), "%s", options->scratch_dir);
+    else
+        parent_directory(output, dir, sizeof(dir));
+
+    carve.cost_rows = malloc(2 * (size_t)w * sizeof(uint32_t));
+    carve.energy_row = malloc(w);
+    carve.seam = malloc((size_t)h * sizeof(int));
+    carve.pending = malloc((size_t)h * sizeof(int));
+    if (!carve.cost_rows || !carve.energy_row || !carve.seam || !carve.pending) {
+        perror("Seam buffer allocation failed");
+        goto cleanup;
+    }
+
+    // Gray images are carved in place in the scratch image; the seam log is only needed to gather colour
+    carve.image_fd = open_scratch(dir, (size_t)h * decoder.row_bytes);
+    carve.plane_fd = c > 1 ? open_scratch(dir, (size_t)w * h) : carve.image_fd;
+    carve.steps_fd = open_scratch(dir, (size_t)h * SEAM_STEP_ROW_BYTES(w));
+    if (c > 1 && seams > 0)
+        carve.seams_fd = open_scratch(dir, (size_t)seams * h * sizeof(int));
+    if (carve.image_fd < 0 || carve.plane_fd < 0 || carve.steps_fd < 0 || (c > 1 && seams > 0 && carve.seams_fd < 0))
+        goto cleanup;
+
+    SEAM_TRACE_BEGIN(decode_span, TRACE_DECODE);
+    int decoded = decode_to_scratch(&carve, &decoder);
+    SEAM_TRACE_BYTES(decode_span, (uint64_t)ftell(decoder.fp), 0);
+    SEAM_TRACE_END(decode_span);
+    if (decoded != 0) {
+        fprintf(stderr, "Failed to decode PNG: %s\n", input);
+        goto cleanup;
+    }
+    stream_decoder_close(&decoder);
+    decoding = 0;
+
+    for (int i = 0; i < seams; i++) {
+        // The sweeps compute the energy as they go, so the whole search counts as seam time
+        SEAM_TRACE_BEGIN_INDEX(seam_span, TRACE_SEAM, i);
+        int searched = sweep_plane(&carve, 1) == 0 && trace_spilled_steps(&carve) == 0;
+        SEAM_TRACE_END(seam_span);
+        if (!searched)
+            goto cleanup;
+
+        if (carve.seams_fd >= 0) {
+            size_t bytes = (size_t)h * sizeof(int);
+            if (pwrite(carve.seams_fd, carve.seam, bytes, (off_t)i * (off_t)bytes) != (ssize_t)bytes) {
+                perror("Seam log write failed");
+                goto cleanup;
+            }
+        }
+
+        int* removed = carve.seam;
+        carve.seam = carve.pending;
+        carve.pending = removed;
+        carve.has_pending = 1;
+    }
+
+    // The colour gather works from the seam log, but a gray result is the plane itself
+    if (c == 1 && carve.has_pending && sweep_plane(&carve, 0) != 0)
+        goto cleanup;
+    if (c > 1)
+        carve.width = w - seams;
+
+    status = write_carved(&carve, output, seams, &options->settings);
+
+cleanup:
+    if (decoding)
+        stream_decoder_close(&decoder);
+    if (carve.plane_fd >= 0 && carve.plane_fd != carve.image_fd)
+        close(carve.plane_fd);
+    if (carve.image_fd >= 0)
+        close(carve.image_fd);
+    if (carve.steps_fd >= 0)
+        close(carve.steps_fd);
+    if (carve.seams_fd >= 0)
+        close(carve.seams_fd);
+    free(carve.cost_rows);
+    free(carve.energy_row);
+    free(carve.seam);
+    free(carve.pending);
+    SEAM_TRACE_END(carve_span);
+    return status;
+}
+
+int run_tiled(char** paths, int count, const char* output_dir, int target_width, int seams, const tiled_options* options, tiled_report* report) {
+    memset(report, 0, sizeof(*report));
+    if (mkdir(output_dir, 0755) != 0 && errno != EEXIST) {
+        perror(output_dir);
+        return -1;
+    }
+
+    double start = omp_get_wtime();
+    for (int i = 0; i < count; i++) {
+        const char* name = strrchr(paths[i], '/');
+        char output_filename[1024];
+        snprintf(output_filename, sizeof(output_filename), "%s/%s", output_dir, name ? name + 1 : paths[i]);
+
+        if (carve_png_tiled(paths[i], output_filename, target_width, seams, options) != 0) {
+            fprintf(stderr, "Failed to carve image: %s\n", paths[i]);
+            report->failures++;
+        }
+    }
+    report->seconds = omp_get_wtime() - start;
+    report->images = count;
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        report->peak_memory = (size_t)usage.ru_maxrss * 1024;
+    return report->failures == 0 ? 0 : -1;
+}
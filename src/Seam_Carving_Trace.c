@@ -0,0 +1,382 @@
+#include "../include/Seam_Carving_Trace.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// Events are kept in blocks, so a thread's trace grows without moving what it already recorded
+#define TRACE_BLOCK_EVENTS 4096
+
+int trace_enabled = 0;
+
+static const char* stage_names[TRACE_STAGE_COUNT] = { "decode", "energy", "seam", "removal", "gather", "encode", "iteration", "carve", "request" };
+
+static const char* counter_names[TRACE_COUNTERS] = { "cycles", "instructions", "llc_misses", "branch_misses" };
+
+typedef struct {
+    int64_t start;                  // Nanoseconds since trace_start
+    int64_t duration;
+    long index;
+    int stage;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t allocated;
+    uint64_t counters[TRACE_COUNTERS];
+} trace_event;
+
+typedef struct trace_block {
+    trace_event events[TRACE_BLOCK_EVENTS];
+    int count;
+    struct trace_block* next;
+} trace_block;
+
+typedef struct {
+    uint64_t calls;
+    int64_t total;
+    int64_t longest;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t allocated;
+    uint64_t counters[TRACE_COUNTERS];
+} trace_totals;
+
+// Everything one thread recorded; only that thread writes it while the trace runs
+typedef struct trace_thread {
+    int id;
+    trace_block* head;
+    trace_block* tail;
+    long events;
+    long dropped;
+    trace_totals totals[TRACE_STAGE_COUNT];
+    uint64_t allocated[TRACE_MAX_DEPTH + 1];    // Bytes allocated inside each open span; [0] outside any
+    int depth;
+    int counter_fd;                 // perf_event_open group leader, -1 without hardware counters
+    int member_fds[TRACE_COUNTERS - 1];
+    struct trace_thread* next;
+} trace_thread;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_thread* trace_threads = NULL;
+static int trace_thread_count = 0;
+static int trace_hardware = 0;
+static int trace_hardware_warned = 0;
+static int64_t trace_origin = 0;
+
+// Bumped by trace_finish, so threads register again with the next trace instead of using freed state
+static unsigned trace_generation = 1;
+static __thread trace_thread* trace_self = NULL;
+static __thread unsigned trace_self_generation = 0;
+
+static int64_t trace_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int open_counter(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // This thread only, on whichever CPU it runs
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+// Opens the counter group of the calling thread; without it the thread's spans carry no counters
+static void open_counters(trace_thread* self) {
+    static const uint64_t configs[TRACE_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    self->counter_fd = open_counter(configs[0], -1);
+    int error = errno;
+    int opened = self->counter_fd >= 0;
+    for (int i = 1; i < TRACE_COUNTERS && opened; i++) {
+        self->member_fds[i - 1] = open_counter(configs[i], self->counter_fd);
+        error = errno;
+        opened = self->member_fds[i - 1] >= 0;
+        if (!opened) {
+            for (int j = 0; j < i - 1; j++)
+                close(self->member_fds[j]);
+            close(self->counter_fd);
+        }
+    }
+    if (opened)
+        return;
+
+    self->counter_fd = -1;
+    pthread_mutex_lock(&trace_lock);
+    if (!trace_hardware_warned)
+        fprintf(stderr, "Hardware counters unavailable (%s); tracing without them\n", strerror(error));
+    trace_hardware_warned = 1;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void close_counters(trace_thread* thread) {
+    if (thread->counter_fd < 0)
+        return;
+    for (int i = 0; i < TRACE_COUNTERS - 1; i++)
+        close(thread->member_fds[i]);
+    close(thread->counter_fd);
+}
+
+static void read_counters(const trace_thread* self, uint64_t* counters) {
+    // PERF_FORMAT_GROUP: the number of counters, then their values in the order they were opened
+    uint64_t values[TRACE_COUNTERS + 1];
+    if (self->counter_fd < 0 || read(self->counter_fd, values, sizeof(values)) != (ssize_t)sizeof(values)) {
+        memset(counters, 0, TRACE_COUNTERS * sizeof(uint64_t));
+        return;
+    }
+    memcpy(counters, values + 1, TRACE_COUNTERS * sizeof(uint64_t));
+}
+
+// The calling thread's record, registered on its first span of this trace; NULL if that failed
+static trace_thread* trace_thread_self(void) {
+    if (trace_self && trace_self_generation == trace_generation)
+        return trace_self;
+
+    trace_thread* self = calloc(1, sizeof(trace_thread));
+    if (!self)
+        return NULL;
+    self->counter_fd = -1;
+    if (trace_hardware)
+        open_counters(self);
+
+    pthread_mutex_lock(&trace_lock);
+    self->id = trace_thread_count++;
+    self->next = trace_threads;
+    trace_threads = self;
+    trace_self_generation = trace_generation;
+    pthread_mutex_unlock(&trace_lock);
+
+    trace_self = self;
+    return self;
+}
+
+int trace_start(int hardware_counters) {
+    trace_hardware = hardware_counters;
+    trace_origin = trace_clock();
+    trace_enabled = 1;
+    return 0;
+}
+
+void trace_span_open(trace_span* span, trace_stage stage, long index) {
+    trace_thread* self = trace_thread_self();
+    if (!self || self->depth >= TRACE_MAX_DEPTH) {
+        span->active = 0;
+        return;
+    }
+
+    span->stage = stage;
+    span->index = index;
+    span->depth = ++self->depth;
+    self->allocated[span->depth] = 0;
+    read_counters(self, span->counters);
+    span->start = trace_clock();
+}
+
+static trace_event* trace_append(trace_thread* self) {
+    if (self->events >= TRACE_MAX_EVENTS) {
+        self->dropped++;
+        return NULL;
+    }
+    if (!self->tail || self->tail->count == TRACE_BLOCK_EVENTS) {
+        trace_block* block = malloc(sizeof(trace_block));
+        if (!block) {
+            self->dropped++;
+            return NULL;
+        }
+        block->count = 0;
+        block->next = NULL;
+        if (self->tail)
+            self->tail->next = block;
+        else
+            self->head = block;
+        self->tail = block;
+    }
+    self->events++;
+    return &self->tail->events[self->tail->count++];
+}
+
+void trace_span_close(trace_span* span) {
+    int64_t end = trace_clock();
+    trace_thread* self = trace_self;
+    // A span still open when the trace finished belongs to nothing any more
+    if (!trace_enabled || trace_self_generation != trace_generation)
+        return;
+    uint64_t counters[TRACE_COUNTERS];
+    read_counters(self, counters);
+
+    // Spans that were never closed above this one are dropped with it
+    uint64_t allocated = 0;
+    for (int d = span->depth; d <= self->depth; d++)
+        allocated += self->allocated[d];
+    self->depth = span->depth - 1;
+    self->allocated[self->depth] += allocated;
+
+    trace_totals* totals = &self->totals[span->stage];
+    int64_t duration = end - span->start;
+    totals->calls++;
+    totals->total += duration;
+    totals->longest = duration > totals->longest ? duration : totals->longest;
+    totals->bytes_read += span->bytes_read;
+    totals->bytes_written += span->bytes_written;
+    totals->allocated += allocated;
+    for (int i = 0; i < TRACE_COUNTERS; i++)
+        totals->counters[i] += counters[i] - span->counters[i];
+
+    trace_event* event = trace_append(self);
+    if (!event)
+        return;
+    event->start = span->start - trace_origin;
+    event->duration = duration;
+    event->index = span->index;
+    event->stage = span->stage;
+    event->bytes_read = span->bytes_read;
+    event->bytes_written = span->bytes_written;
+    event->allocated = allocated;
+    for (int i = 0; i < TRACE_COUNTERS; i++)
+        event->counters[i] = counters[i] - span->counters[i];
+}
+
+// Counts an allocation against the innermost open span of the calling thread
+void trace_record_allocation(size_t bytes) {
+    trace_thread* self = trace_thread_self();
+    if (self)
+        self->allocated[self->depth] += bytes;
+}
+
+uint64_t trace_file_bytes(const char* path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? (uint64_t)info.st_size : 0;
+}
+
+// Writes every recorded span as Chrome trace-event JSON; returns 0 or -1
+int trace_write_chrome(const char* filename) {
+    FILE* fp = fopen(filename, "w");
+    if (!fp) {
+        perror(filename);
+        return -1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    int first = 1;
+    pthread_mutex_lock(&trace_lock);
+    for (trace_thread* thread = trace_threads; thread; thread = thread->next) {
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", thread->id, thread->id);
+        first = 0;
+
+        for (trace_block* block = thread->head; block; block = block->next) {
+            for (int e = 0; e < block->count; e++) {
+                const trace_event* event = &block->events[e];
+                fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"seam_carving\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                        stage_names[event->stage], thread->id, event->start / 1e3, event->duration / 1e3);
+                fprintf(fp, "\"index\":%ld,\"bytes_read\":%llu,\"bytes_written\":%llu,\"allocated\":%llu", event->index,
+                        (unsigned long long)event->bytes_read, (unsigned long long)event->bytes_written, (unsigned long long)event->allocated);
+                if (thread->counter_fd >= 0) {
+                    for (int i = 0; i < TRACE_COUNTERS; i++)
+                        fprintf(fp, ",\"%s\":%llu", counter_names[i], (unsigned long long)event->counters[i]);
+                }
+                fprintf(fp, "}}");
+            }
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    fprintf(fp, "\n]}\n");
+
+    if (fclose(fp) != 0) {
+        perror(filename);
+        return -1;
+    }
+    return 0;
+}
+
+// Prints calls, time, bytes and counters per stage, summed over the threads. Nested stages are each timed
+// in full, so an iteration's time includes its energy, seam and removal time.
+void trace_print_summary(FILE* out) {
+    trace_totals totals[TRACE_STAGE_COUNT];
+    int threads[TRACE_STAGE_COUNT];
+    memset(totals, 0, sizeof(totals));
+    memset(threads, 0, sizeof(threads));
+    long dropped = 0;
+    int counting = 0;
+
+    pthread_mutex_lock(&trace_lock);
+    for (trace_thread* thread = trace_threads; thread; thread = thread->next) {
+        dropped += thread->dropped;
+        counting = counting || thread->counter_fd >= 0;
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            const trace_totals* own = &thread->totals[s];
+            if (own->calls == 0)
+                continue;
+            threads[s]++;
+            totals[s].calls += own->calls;
+            totals[s].total += own->total;
+            totals[s].longest = own->longest > totals[s].longest ? own->longest : totals[s].longest;
+            totals[s].bytes_read += own->bytes_read;
+            totals[s].bytes_written += own->bytes_written;
+            totals[s].allocated += own->allocated;
+            for (int i = 0; i < TRACE_COUNTERS; i++)
+                totals[s].counters[i] += own->counters[i];
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+
+    fprintf(out, "%-10s %8s %7s %11s %10s %10s %9s %9s %9s", "stage", "calls", "threads", "total ms", "mean us", "max us",
+            "read MB", "write MB", "alloc MB");
+    if (counting)
+        fprintf(out, " %6s %12s %12s", "IPC", "LLC miss/K", "br miss/K");
+    fprintf(out, "\n");
+
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        const trace_totals* t = &totals[s];
+        if (t->calls == 0)
+            continue;
+        fprintf(out, "%-10s %8llu %7d %11.2f %10.1f %10.1f %9.2f %9.2f %9.2f", stage_names[s], (unsigned long long)t->calls,
+                threads[s], t->total / 1e6, t->total / 1e3 / t->calls, t->longest / 1e3,
+                t->bytes_read / 1048576.0, t->bytes_written / 1048576.0, t->allocated / 1048576.0);
+        if (counting) {
+            // Per thousand instructions
+            double instructions = t->counters[1] > 0 ? (double)t->counters[1] : 1.0;
+            fprintf(out, " %6.2f %12.2f %12.2f", t->counters[0] > 0 ? t->counters[1] / (double)t->counters[0] : 0.0,
+                    t->counters[2] * 1000.0 / instructions, t->counters[3] * 1000.0 / instructions);
+        }
+        fprintf(out, "\n");
+    }
+    if (dropped > 0)
+        fprintf(out, "%ld spans were left out of the trace file (more than %d on one thread)\n", dropped, TRACE_MAX_EVENTS);
+}
+
+// Stops recording and releases every thread's events
+void trace_finish(void) {
+    trace_enabled = 0;
+
+    pthread_mutex_lock(&trace_lock);
+    trace_thread* thread = trace_threads;
+    while (thread) {
+        trace_thread* next = thread->next;
+        close_counters(thread);
+        while (thread->head) {
+            trace_block* block = thread->head;
+            thread->head = block->next;
+            free(block);
+        }
+        free(thread);
+        thread = next;
+    }
+    trace_threads = NULL;
+    trace_thread_count = 0;
+    trace_generation++;
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,53 @@
+#include "../include/Seam_Carving_Workspace.h"
+
+static size_t align_up(size_t bytes) {
+    return (bytes + WORKSPACE_ALIGNMENT - 1) & ~(size_t)(WORKSPACE_ALIGNMENT - 1);
+}
+
+void seam_buffer_init(seam_buffer* buffer) {
+    buffer->data = NULL;
+    buffer->capacity = 0;
+}
+
+void seam_buffer_free(seam_buffer* buffer) {
+    free(buffer->data);
+    seam_buffer_init(buffer);
+}
+
+// Makes the buffer hold at least bytes and returns it; NULL when out of memory
+void* seam_buffer_reserve(seam_buffer* buffer, size_t bytes) {
+    if (bytes <= buffer->capacity)
+        return buffer->data;
+
+    // Nothing in it is worth keeping, so drop it first instead of paying for realloc's copy
+    free(buffer->data);
+    size_t capacity = align_up(bytes);
+    buffer->data = aligned_alloc(WORKSPACE_ALIGNMENT, capacity);
+    if (!buffer->data) {
+        perror("Workspace allocation failed");
+        buffer->capacity = 0;
+        return NULL;
+    }
+
+    buffer->capacity = capacity;
+    SEAM_TRACE_ALLOCATION(capacity);
+    return buffer->data;
+}
+
+// Splits the buffer into cache-line aligned regions of the given sizes; returns 0 on success
+int seam_buffer_layout(seam_buffer* buffer, const size_t* sizes, void** buffers[], int count) {
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+        total += align_up(sizes[i]);
+
+    unsigned char* base = seam_buffer_reserve(buffer, total);
+    if (!base && total > 0)
+        return -1;
+
+    size_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        *buffers[i] = sizes[i] ? base + offset : NULL;
+        offset += align_up(sizes[i]);
+    }
+    return 0;
+}
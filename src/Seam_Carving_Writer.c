@@ -0,0 +1,113 @@
+#include "../include/Seam_Carving_Writer.h"
+
+// Encoder thread: takes frames off the queue until it is closed and drained
+static void* png_writer_thread(void* arg) {
+    png_writer* writer = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&writer->lock);
+        while (writer->count == 0 && !writer->closed)
+            pthread_cond_wait(&writer->not_empty, &writer->lock);
+        if (writer->count == 0) {
+            pthread_mutex_unlock(&writer->lock);
+            return NULL;
+        }
+
+        png_write_job job = writer->jobs[writer->head];
+        writer->head = (writer->head + 1) % writer->capacity;
+        writer->count--;
+        pthread_cond_signal(&writer->not_full);
+        pthread_mutex_unlock(&writer->lock);
+
+        int status = write_png_with_settings(job.filename, job.image_data, job.width, job.height, job.channels, &job.settings);
+        free(job.image_data);
+
+        if (status != 0) {
+            pthread_mutex_lock(&writer->lock);
+            writer->failures++;
+            pthread_mutex_unlock(&writer->lock);
+        }
+    }
+}
+
+png_writer* png_writer_create(int threads, int queue_capacity) {
+    png_writer* writer = calloc(1, sizeof(png_writer));
+    if (!writer)
+        return NULL;
+
+    writer->capacity = queue_capacity > 0 ? queue_capacity : 1;
+    writer->jobs = malloc(writer->capacity * sizeof(png_write_job));
+    writer->threads = malloc((threads > 0 ? threads : 1) * sizeof(pthread_t));
+    if (!writer->jobs || !writer->threads) {
+        free(writer->jobs);
+        free(writer->threads);
+        free(writer);
+        return NULL;
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->not_empty, NULL);
+    pthread_cond_init(&writer->not_full, NULL);
+
+    for (int i = 0; i < (threads > 0 ? threads : 1); i++) {
+        if (pthread_create(&writer->threads[i], NULL, png_writer_thread, writer) != 0)
+            break;
+        writer->thread_count++;
+    }
+
+    if (writer->thread_count == 0) {
+        png_writer_finish(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+// Queues a frame for encoding; blocks while the queue is full so memory stays bounded
+int png_writer_submit(png_writer* writer, const char* filename, unsigned char* image_data, int width, int height, int channels, const png_write_settings* settings) {
+    png_write_job job;
+    snprintf(job.filename, sizeof(job.filename), "%s", filename);
+    job.image_data = image_data;
+    job.width = width;
+    job.height = height;
+    job.channels = channels;
+    if (settings)
+        job.settings = *settings;
+    else
+        png_write_settings_init(&job.settings);
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == writer->capacity && !writer->closed)
+        pthread_cond_wait(&writer->not_full, &writer->lock);
+    if (writer->closed) {
+        pthread_mutex_unlock(&writer->lock);
+        free(image_data);
+        return -1;
+    }
+
+    writer->jobs[(writer->head + writer->count) % writer->capacity] = job;
+    writer->count++;
+    pthread_cond_signal(&writer->not_empty);
+    pthread_mutex_unlock(&writer->lock);
+    return 0;
+}
+
+// Waits for every queued frame to be written, stops the threads and returns the number of failed writes
+int png_writer_finish(png_writer* writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->closed = 1;
+    pthread_cond_broadcast(&writer->not_empty);
+    pthread_cond_broadcast(&writer->not_full);
+    pthread_mutex_unlock(&writer->lock);
+
+    for (int i = 0; i < writer->thread_count; i++)
+        pthread_join(writer->threads[i], NULL);
+
+    int failures = writer->failures;
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->not_empty);
+    pthread_cond_destroy(&writer->not_full);
+    free(writer->jobs);
+    free(writer->threads);
+    free(writer);
+    return failures;
+}
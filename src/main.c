@@ -1,11 +1,272 @@
 #include "../include/Seam_Carving_Sequential.h"
 #include "../include/Seam_Carving_Parallel.h"
+#include "../include/Seam_Carving_Engine.h"
+#include "../include/Seam_Carving_Batch.h"
+#include "../include/Seam_Carving_Sequence.h"
+#include "../include/Seam_Carving_Tiled.h"
+#include "../include/Seam_Carving_Service.h"
 
 
 #include <time.h>
 
+// Background encoder threads and queued frames used when intermediate images are saved
+#define INTERMEDIATE_WRITER_THREADS 2
+#define INTERMEDIATE_WRITER_QUEUE 4
+
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options] INPUT...\n"
+        "  INPUT             PNG file or directory of PNG files\n"
+        "  --width W         carve every image to W pixels wide\n"
+        "  --seams N         remove N vertical seams from every image\n"
+        "  --widths W1,W2    write every listed width, cut from a reusable seam map\n"
+        "  --map-min-width M narrowest width the seam maps cover (default: smallest of --widths)\n"
+        "  --output DIR      directory for the carved images (default: outputs)\n"
+        "  --per-pass K      seams removed per energy and DP pass (default: 1)\n"
+        "  --compact         search each seam in two rolling cost rows instead of a kept DP table (one seam per pass only)\n"
+        "  --fused           like --compact, computing each energy row inside the search instead of keeping an energy map\n"
+        "  --pyramid L       approximate seams coarse-to-fine over L halvings (one seam per pass only)\n"
+        "  --band B          columns searched on each side of the coarse or previous frame's seam (default: 8)\n"
+        "  --forward         cost seams with forward energy (one seam per pass only)\n"
+        "  --sequence        carve the inputs in order as video frames, each guided by the previous frame's seams\n"
+        "  --scene-change D  mean channel-0 difference that restarts the full search in a sequence (default: 24)\n"
+        "  --keyframe N      search every Nth frame of a sequence over the full width (default: only at cuts)\n"
+        "  --out-of-core     carve through scratch files within a memory budget, one image at a time\n"
+        "  --memory MB       memory budget of --out-of-core (default: 256)\n"
+        "  --scratch DIR     directory for the --out-of-core scratch files (default: next to the output)\n"
+        "  --serve SOCKET    carve requests from a Unix domain socket until interrupted (no INPUT)\n"
+        "  --concurrency N   requests --serve holds at once; more wait to be accepted (default: 32)\n"
+        "  --batch N         queued requests --serve carves together (default: 16)\n"
+        "  --max-request MB  largest request --serve takes in, PNG and output path together (default: 16)\n"
+        "  --compression Z   zlib level 0-9 of sequence, out-of-core and served outputs (default: the library's)\n"
+        "  --threads T       OpenMP threads\n"
+        "  --trace FILE      write a Chrome trace of every stage to FILE and print a summary (-DSEAM_TRACE builds)\n"
+        "  --trace-counters  also read cycles, instructions, cache and branch misses around every traced stage\n"
+        "Without arguments the program runs interactively on input.png.\n",
+        program);
+}
+
+static double seconds_between(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// Starts the trace --trace asked for; fails in builds without SEAM_TRACE, whose stages record nothing
+static int start_trace(const char* trace_file, int hardware_counters) {
+    if (!trace_file)
+        return 0;
+#ifdef SEAM_TRACE
+    return trace_start(hardware_counters);
+#else
+    (void)hardware_counters;
+    fprintf(stderr, "--trace needs a build with -DSEAM_TRACE\n");
+    return -1;
+#endif
+}
+
+static void finish_trace(const char* trace_file) {
+    if (!trace_file)
+        return;
+    if (trace_write_chrome(trace_file) == 0)
+        printf("Trace written to %s\n", trace_file);
+    trace_print_summary(stdout);
+    trace_finish();
+}
+
+// Non-interactive mode: carves a list of images and reports throughput and latency
+static int run_batch_cli(int argc, char** argv) {
+    batch_options options;
+    batch_options_init(&options);
+    char** inputs = malloc(argc * sizeof(char*));
+    int* widths = malloc(argc * sizeof(int));
+    int input_count = 0;
+    int sequence = 0;
+    double scene_change = SEQUENCE_SCENE_CHANGE;
+    int compression_level = -1;
+    int keyframe_interval = 0;
+    int out_of_core = 0;
+    tiled_options tiled;
+    tiled_options_init(&tiled, CARVE_MODE_PARALLEL);
+    int serve = 0;
+    service_options service;
+    service_options_init(&service);
+    const char* trace_file = NULL;
+    int trace_counters = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+
+        if (strcmp(arg, "--width") == 0 && has_value)
+            options.target_width = atoi(argv[++i]);
+        else if (strcmp(arg, "--seams") == 0 && has_value)
+            options.seams = atoi(argv[++i]);
+        else if (strcmp(arg, "--widths") == 0 && has_value) {
+            options.width_count = 0;
+            for (char* token = strtok(argv[++i], ","); token && options.width_count < argc; token = strtok(NULL, ","))
+                widths[options.width_count++] = atoi(token);
+            options.widths = widths;
+        } else if (strcmp(arg, "--map-min-width") == 0 && has_value)
+            options.map_min_width = atoi(argv[++i]);
+        else if (strcmp(arg, "--output") == 0 && has_value)
+            options.output_dir = argv[++i];
+        else if (strcmp(arg, "--per-pass") == 0 && has_value)
+            options.seams_per_pass = atoi(argv[++i]);
+        else if (strcmp(arg, "--compact") == 0)
+            options.incremental_seams = 0;
+        else if (strcmp(arg, "--fused") == 0) {
+            options.incremental_seams = 0;
+            options.fused_energy = 1;
+        }
+        else if (strcmp(arg, "--pyramid") == 0 && has_value)
+            options.pyramid_levels = atoi(argv[++i]);
+        else if (strcmp(arg, "--band") == 0 && has_value)
+            options.pyramid_band = atoi(argv[++i]);
+        else if (strcmp(arg, "--forward") == 0)
+            options.forward_energy = 1;
+        else if (strcmp(arg, "--sequence") == 0)
+            sequence = 1;
+        else if (strcmp(arg, "--scene-change") == 0 && has_value)
+            scene_change = atof(argv[++i]);
+        else if (strcmp(arg, "--keyframe") == 0 && has_value)
+            keyframe_interval = atoi(argv[++i]);
+        else if (strcmp(arg, "--out-of-core") == 0)
+            out_of_core = 1;
+        else if (strcmp(arg, "--memory") == 0 && has_value)
+            tiled.memory_budget = (size_t)atol(argv[++i]) << 20;
+        else if (strcmp(arg, "--scratch") == 0 && has_value)
+            tiled.scratch_dir = argv[++i];
+        else if (strcmp(arg, "--serve") == 0 && has_value) {
+            serve = 1;
+            service.socket_path = argv[++i];
+        } else if (strcmp(arg, "--concurrency") == 0 && has_value)
+            service.concurrency = atoi(argv[++i]);
+        else if (strcmp(arg, "--batch") == 0 && has_value)
+            service.batch_size = atoi(argv[++i]);
+        else if (strcmp(arg, "--max-request") == 0 && has_value)
+            service.max_request = (size_t)atol(argv[++i]) << 20;
+        else if (strcmp(arg, "--compression") == 0 && has_value)
+            compression_level = atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0 && has_value)
+            omp_set_num_threads(atoi(argv[++i]));
+        else if (strcmp(arg, "--trace") == 0 && has_value)
+            trace_file = argv[++i];
+        else if (strcmp(arg, "--trace-counters") == 0)
+            trace_counters = 1;
+        else if (arg[0] == '-') {
+            print_usage(argv[0]);
+            free(inputs);
+            free(widths);
+            return 1;
+        } else
+            inputs[input_count++] = argv[i];
+    }
+
+    if (serve) {
+        free(inputs);
+        free(widths);
+        if (input_count > 0 || sequence || out_of_core || service.concurrency < 1 || service.batch_size < 1 || service.max_request == 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        service.settings.compression_level = compression_level;
+        if (start_trace(trace_file, trace_counters) != 0)
+            return 1;
+
+        printf("Listening on %s\n", service.socket_path);
+        fflush(stdout);
+        service_report report;
+        int status = run_service(&service, &report);
+
+        printf("Requests: %ld (%ld failed) in %ld batches\n", report.requests, report.failures, report.batches);
+        printf("Time spent: %.2f seconds\n", report.seconds);
+        finish_trace(trace_file);
+        return status == 0 ? 0 : 1;
+    }
+
+    int widths_valid = 1;
+    for (int i = 0; i < options.width_count; i++)
+        widths_valid = widths_valid && widths[i] > 0;
+    if (input_count == 0 || !widths_valid || (options.target_width <= 0 && options.seams <= 0 && options.width_count == 0) ||
+        ((sequence || out_of_core) && options.width_count > 0) || (sequence && out_of_core)) {
+        print_usage(argv[0]);
+        free(inputs);
+        free(widths);
+        return 1;
+    }
+    if (options.seams_per_pass < 1)
+        options.seams_per_pass = 1;
+
+    char** paths;
+    int count = collect_batch_inputs(inputs, input_count, &paths);
+    free(inputs);
+    if (count <= 0) {
+        fprintf(stderr, "No input images found.\n");
+        free(widths);
+        return 1;
+    }
+    if (start_trace(trace_file, trace_counters) != 0) {
+        free_batch_inputs(paths, count);
+        free(widths);
+        return 1;
+    }
+
+    if (out_of_core) {
+        tiled.settings.compression_level = compression_level;
+
+        tiled_report report;
+        int status = run_tiled(paths, count, options.output_dir, options.target_width, options.seams, &tiled, &report);
+        free_batch_inputs(paths, count);
+        free(widths);
+
+        printf("Images: %d (%d failed)\n", report.images, report.failures);
+        printf("Time spent: %.2f seconds, peak memory %.1f MB\n", report.seconds, report.peak_memory / 1048576.0);
+        finish_trace(trace_file);
+        return status == 0 ? 0 : 1;
+    }
+
+    if (sequence) {
+        sequence_options frames;
+        sequence_options_init(&frames);
+        frames.output_dir = options.output_dir;
+        frames.target_width = options.target_width;
+        frames.seams = options.seams;
+        frames.band = options.pyramid_band;
+        frames.scene_change = scene_change;
+        frames.keyframe_interval = keyframe_interval;
+        frames.settings.compression_level = compression_level;
+
+        sequence_report report;
+        int status = run_sequence(paths, count, &frames, &report);
+        free_batch_inputs(paths, count);
+        free(widths);
+
+        printf("Frames: %d (%d failed, %d searched over the full width)\n", report.frames, report.failures, report.full_searches);
+        printf("Time spent: %.2f seconds, %.2f frames/sec\n", report.seconds,
+               report.seconds > 0 ? report.frames / report.seconds : 0.0);
+        finish_trace(trace_file);
+        return status == 0 ? 0 : 1;
+    }
+
+    batch_report report;
+    int status = run_batch(paths, count, &options, &report);
+    free_batch_inputs(paths, count);
+    free(widths);
+
+    printf("Images: %d (%d failed, %d skipped)\n", report.images, report.failures, report.skipped);
+    printf("Time spent: %.2f seconds, %.2f images/sec\n", report.seconds,
+           report.seconds > 0 ? report.images / report.seconds : 0.0);
+    printf("Latency: p50 %.1f ms, p99 %.1f ms\n", report.p50_latency * 1000, report.p99_latency * 1000);
+    finish_trace(trace_file);
+
+    return status == 0 ? 0 : 1;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc > 1)
+        return run_batch_cli(argc, argv);
 
-int main() {
     const char* output_dir = "outputs";
     const char* highlighted_seams_dir = "highlighted_seams";
 
@@ -16,97 +277,122 @@ int main() {
     printf("Choose mode:\n1 - Parallel\n2 - Sequential\n> ");
     scanf("%d", &choice);
 
-    clock_t start_time = clock();
-    
-    if(choice == 1){
-        unsigned char* image_data = read_png_sequential("input.png", &width, &height, &channels);
-        if (!image_data) {
-            printf("Failed to read image.\n");
-            return 1;
-        }
-
-        int iterations;
-        printf("Enter the number of iterations: ");
-        scanf("%d", &iterations);
-
-        unsigned char* energy_map = malloc(width * height);
-        int* seam = malloc(height * sizeof(int));
-
-        char current_image_filename[256];
-        snprintf(current_image_filename, sizeof(current_image_filename), "input.png");
+    if (choice != CARVE_MODE_PARALLEL && choice != CARVE_MODE_SEQUENTIAL) {
+        printf("Unknown mode: %d\n", choice);
+        return 1;
+    }
 
-        for (int i = 0; i < iterations; i++) {
-            image_data = read_png_sequential(current_image_filename, &width, &height, &channels);
-            if (!image_data) {
-                printf("Failed to read image: %s\n", current_image_filename);
-                return 1;
-            }
+    // Wall-clock time: clock() adds up CPU time over every OpenMP thread. Only decoding, carving and encoding
+    // are timed, not the prompts in between.
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-            compute_energy_map_sequential(image_data, width, height, channels, energy_map);
-            compute_seam_sequential(energy_map, width, height, seam);
+    // The input is decoded once, with its energy map computed as the rows arrive; every iteration then
+    // works on the in-memory buffer
+    unsigned char* image_data;
+    unsigned char* energy_map;
+    int read_status = choice == CARVE_MODE_PARALLEL
+        ? read_png_streaming_parallel("input.png", &image_data, &energy_map, &width, &height, &channels)
+        : read_png_streaming_sequential("input.png", &image_data, &energy_map, &width, &height, &channels);
+    if (read_status != 0) {
+        printf("Failed to read image.\n");
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    double time_spent = seconds_between(&start_time, &end_time);
 
-            char highlighted_filename[256];
-            snprintf(highlighted_filename, sizeof(highlighted_filename), "highlighted_seams/seam_%d.png", i);
-            highlight_seam_sequential(image_data, width, height, channels, seam, highlighted_filename);
+    int iterations;
+    printf("Enter the number of iterations (negative to insert seams): ");
+    scanf("%d", &iterations);
 
-            char output_filename[256];
-            snprintf(output_filename, sizeof(output_filename), "outputs/output_%d.png", i);
-            remove_and_save_seam_sequential(image_data, width, height, channels, seam, output_filename);
+    carve_options options;
+    carve_options_init(&options, (carve_mode)choice);
+    options.output_dir = output_dir;
+    options.initial_energy = energy_map;
 
-            snprintf(current_image_filename, sizeof(current_image_filename), "outputs/output_%d.png", i);
-        }
+    int horizontal_seams;
+    printf("Enter the number of horizontal seams: ");
+    scanf("%d", &horizontal_seams);
 
+    // Insertion only widens, and carve_to_size only shrinks
+    if (horizontal_seams < 0 || (iterations < 0 && horizontal_seams > 0)) {
+        printf("Horizontal seams can only be removed, and not while vertical seams are inserted.\n");
         free(image_data);
         free(energy_map);
-        free(seam);
+        return 1;
     }
-    else if(choice == 2){
-        unsigned char* image_data = read_png_parallel("input.png", &width, &height, &channels);
-        if (!image_data) {
-            printf("Failed to read image.\n");
-            return 1;
-        }
 
-        int iterations;
-        printf("Enter the number of iterations: ");
-        scanf("%d", &iterations);
+    printf("Seams removed per pass (1 - exact): ");
+    scanf("%d", &options.seams_per_pass);
+    if (options.seams_per_pass < 1)
+        options.seams_per_pass = 1;
 
-        unsigned char* energy_map = malloc(width * height);
-        int* seam = malloc(height * sizeof(int));
+    printf("Save intermediate images?\n1 - Yes\n0 - No\n> ");
+    scanf("%d", &options.save_intermediate);
 
-        char current_image_filename[256];
-        snprintf(current_image_filename, sizeof(current_image_filename), "input.png");
+    // Intermediate frames are compressed in the background, favouring speed over size
+    if (options.save_intermediate) {
+        options.writer = png_writer_create(INTERMEDIATE_WRITER_THREADS, INTERMEDIATE_WRITER_QUEUE);
+        options.intermediate_settings.compression_level = 1;
+    }
 
-        for (int i = 0; i < iterations; i++) {
-            image_data = read_png_parallel(current_image_filename, &width, &height, &channels);
-            if (!image_data) {
-                printf("Failed to read image: %s\n", current_image_filename);
-                return 1;
-            }
+    // The overlay needs the untouched input, so only keep a copy when it was asked for
+    int overlay;
+    printf("Write seam overlay?\n1 - Yes\n0 - No\n> ");
+    scanf("%d", &overlay);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
 
-            compute_energy_map_parallel(image_data, width, height, channels, energy_map);
-            compute_seam_sequential(energy_map, width, height, seam);
+    seam_log recorded_seams;
+    seam_log_init(&recorded_seams);
+    unsigned char* original = NULL;
+    int original_width = width, original_height = height;
+    if (overlay) {
+        original = malloc((size_t)width * height * channels);
+        if (original) {
+            memcpy(original, image_data, (size_t)width * height * channels);
+            options.recorded_seams = &recorded_seams;
+        } else {
+            perror("Overlay copy allocation failed");
+            printf("Carving without the overlay.\n");
+            overlay = 0;
+        }
+    }
 
-            char highlighted_filename[256];
-            snprintf(highlighted_filename, sizeof(highlighted_filename), "highlighted_seams/seam_%d.png", i);
-            highlight_seam_sequential(image_data, width, height, channels, seam, highlighted_filename);
+    int status;
+    if (iterations < 0)
+        status = enlarge_seams(&image_data, &width, height, channels, -iterations, &options);
+    else if (horizontal_seams > 0)
+        status = carve_to_size(&image_data, &width, &height, channels, width - iterations, height - horizontal_seams, &options);
+    else
+        status = carve_seams(&image_data, &width, height, channels, iterations, &options);
+    if (options.writer && png_writer_finish(options.writer) != 0)
+        printf("Some intermediate images could not be written.\n");
+    free(energy_map);
 
-            char output_filename[256];
-            snprintf(output_filename, sizeof(output_filename), "outputs/output_%d.png", i);
-            remove_and_save_seam_sequential(image_data, width, height, channels, seam, output_filename);
+    if (status != 0) {
+        printf("Seam carving failed.\n");
+        free(image_data);
+        free(original);
+        seam_log_free(&recorded_seams);
+        return 1;
+    }
 
-            snprintf(current_image_filename, sizeof(current_image_filename), "outputs/output_%d.png", i);
-        }
+    char output_filename[256];
+    snprintf(output_filename, sizeof(output_filename), "%s/output.png", output_dir);
+    write_png_sequential(output_filename, image_data, width, height, channels);
 
-        free(image_data);
-        free(energy_map);
-        free(seam);
+    free(image_data);
+
+    if (overlay) {
+        snprintf(output_filename, sizeof(output_filename), "%s/overlay.png", highlighted_seams_dir);
+        write_seam_overlay(output_filename, original, original_width, original_height, channels, &recorded_seams);
+        free(original);
     }
+    seam_log_free(&recorded_seams);
 
-    clock_t end_time = clock();
-    double time_spent = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    time_spent += seconds_between(&start_time, &end_time);
     printf("Time spent: %.2f seconds\n", time_spent);
 
     return 0;
 }
-
@@ -0,0 +1,1658 @@
+#include "../include/Seam_Carving_Sequential.h"
+#include "../include/Seam_Carving_Parallel.h"
+#include "../include/Seam_Carving_Engine.h"
+#include "../include/Seam_Carving_Pyramid.h"
+#include "../include/Seam_Carving_Stream.h"
+#include "../include/Seam_Carving_Seam_Map.h"
+#include "../include/Seam_Carving_Tiled.h"
+#include <unistd.h>
+
+// Differential tests: every optimised kernel is run on random inputs against a plain reference or the path it
+// replaced, and has to agree bit for bit. Exits non-zero if any check finds a mismatch.
+
+#define DIFF_DEFAULT_CASES 200
+#define DIFF_DEFAULT_SEED 1
+
+// Largest random map; a few cases are drawn wider so the parallel paths take their thread team
+#define DIFF_MAX_WIDTH 320
+#define DIFF_MAX_HEIGHT 96
+#define DIFF_WIDE_WIDTH 1100
+
+static const int thread_counts[] = { 1, 3, 8 };
+#define DIFF_THREAD_COUNTS ((int)(sizeof(thread_counts) / sizeof(thread_counts[0])))
+
+static uint64_t rng_state;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static int random_below(int bound) {
+    return (int)(next_random() % (uint32_t)bound);
+}
+
+// Random size; every fourth case is wide or one pixel thin, where the kernels have their edge cases
+static void random_size(int* width, int* height) {
+    switch (random_below(8)) {
+    case 0:
+        *width = DIFF_WIDE_WIDTH / 2 + random_below(DIFF_WIDE_WIDTH / 2);
+        *height = 1 + random_below(24);
+        break;
+    case 1:
+        *width = 1 + random_below(9);
+        *height = 1 + random_below(DIFF_MAX_HEIGHT);
+        break;
+    default:
+        *width = 1 + random_below(DIFF_MAX_WIDTH);
+        *height = 1 + random_below(DIFF_MAX_HEIGHT);
+        break;
+    }
+}
+
+// Uniform bytes, or a handful of values so that the DP meets ties everywhere
+static void fill_random(unsigned char* data, size_t count) {
+    int levels = random_below(3) == 0 ? 2 + random_below(3) : 256;
+    for (size_t i = 0; i < count; i++)
+        data[i] = (unsigned char)(random_below(levels) * (255 / (levels - 1)));
+}
+
+// Full-table DP with the tie rules of the engine: straight up first, then left, then right, each only when
+// strictly cheaper; the first cheapest column of the bottom row. With a guide, only cells within band columns
+// of guide[y] are reachable, which is what the guided search has to find.
+static void reference_banded_seam(const unsigned char* energy_map, int width, int height, const int* guide, int band, int* seam) {
+    long* cost = malloc((size_t)width * height * sizeof(long));
+    signed char* step = malloc((size_t)width * height);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t cell = (size_t)y * width + x;
+            if (guide && abs(x - guide[y]) > band) {
+                cost[cell] = LONG_MAX;
+                continue;
+            }
+            if (y == 0) {
+                cost[cell] = energy_map[x];
+                continue;
+            }
+
+            const long* above = cost + (size_t)(y - 1) * width;
+            long best = above[x];
+            int best_step = 0;
+            if (x > 0 && above[x - 1] < best) {
+                best = above[x - 1];
+                best_step = -1;
+            }
+            if (x < width - 1 && above[x + 1] < best) {
+                best = above[x + 1];
+                best_step = 1;
+            }
+            cost[cell] = best == LONG_MAX ? LONG_MAX : best + energy_map[cell];
+            step[cell] = (signed char)best_step;
+        }
+    }
+
+    int x = 0;
+    const long* bottom = cost + (size_t)(height - 1) * width;
+    for (int i = 1; i < width; i++)
+        if (bottom[i] < bottom[x])
+            x = i;
+    for (int y = height - 1; y >= 0; y--) {
+        seam[y] = x;
+        if (y > 0)
+            x += step[(size_t)y * width + x];
+    }
+
+    free(cost);
+    free(step);
+}
+
+static void reference_seam(const unsigned char* energy_map, int width, int height, int* seam) {
+    reference_banded_seam(energy_map, width, height, NULL, 0, seam);
+}
+
+// Forward energy the naive way, over a full cost table: removing pixel x of row y costs C_U = |I(x+1) - I(x-1)|
+// (border columns use themselves as the missing neighbour), plus |I(y-1, x) - I(y, x-1)| when the seam comes
+// from the upper left and |I(y-1, x) - I(y, x+1)| from the upper right; only channel 0 counts. Ties as above.
+static void reference_forward_seam(const unsigned char* image_data, int width, int height, int channels, int* seam) {
+    long* cost = malloc((size_t)width * height * sizeof(long));
+    signed char* step = malloc((size_t)width * height);
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* current = image_data + (size_t)y * width * channels;
+        for (int x = 0; x < width; x++) {
+            int left = current[(size_t)(x > 0 ? x - 1 : x) * channels];
+            int right = current[(size_t)(x < width - 1 ? x + 1 : x) * channels];
+            long up_cost = abs(right - left);
+            if (y == 0) {
+                cost[x] = up_cost;
+                continue;
+            }
+
+            const long* above = cost + (size_t)(y - 1) * width;
+            int above_pixel = current[(size_t)x * channels - (size_t)width * channels];
+            long best = above[x] + up_cost;
+            int best_step = 0;
+            if (x > 0 && above[x - 1] + up_cost + abs(above_pixel - left) < best) {
+                best = above[x - 1] + up_cost + abs(above_pixel - left);
+                best_step = -1;
+            }
+            if (x < width - 1 && above[x + 1] + up_cost + abs(above_pixel - right) < best) {
+                best = above[x + 1] + up_cost + abs(above_pixel - right);
+                best_step = 1;
+            }
+            cost[(size_t)y * width + x] = best;
+            step[(size_t)y * width + x] = (signed char)best_step;
+        }
+    }
+
+    int x = 0;
+    const long* bottom = cost + (size_t)(height - 1) * width;
+    for (int i = 1; i < width; i++)
+        if (bottom[i] < bottom[x])
+            x = i;
+    for (int y = height - 1; y >= 0; y--) {
+        seam[y] = x;
+        if (y > 0)
+            x += step[(size_t)y * width + x];
+    }
+
+    free(cost);
+    free(step);
+}
+
+// Connected seam through random columns, for removals that need not be the cheapest
+static void random_seam(int width, int height, int* seam) {
+    seam[0] = random_below(width);
+    for (int y = 1; y < height; y++) {
+        int x = seam[y - 1] + random_below(3) - 1;
+        seam[y] = x < 0 ? 0 : x >= width ? width - 1 : x;
+    }
+}
+
+// Whether every row of the seam is inside the map and moves at most one column from the row above
+static int seam_is_connected(const int* seam, int width, int height) {
+    for (int y = 0; y < height; y++) {
+        if (seam[y] < 0 || seam[y] >= width || (y > 0 && abs(seam[y] - seam[y - 1]) > 1))
+            return 0;
+    }
+    return 1;
+}
+
+static long seam_cost(const unsigned char* energy_map, int width, int height, const int* seam) {
+    long cost = 0;
+    for (int y = 0; y < height; y++)
+        cost += energy_map[(size_t)y * width + seam[y]];
+    return cost;
+}
+
+static int random_channels(void) {
+    static const int channels[] = { 1, 3, 4 };
+    return channels[random_below(3)];
+}
+
+// Removes k seams one at a time, recomputing the energy and the whole DP for each: what every carve path of the
+// engine has to reproduce, or with forward energy what the forward search has to. Returns the carved image,
+// (width - k) x height; seams, when given, receives seam i at seams[i * height] like carve_options.seam_history.
+static unsigned char* reference_carve(const unsigned char* image_data, int width, int height, int channels, int k, int forward, int* seams) {
+    unsigned char* current = malloc((size_t)width * height * channels);
+    unsigned char* next = malloc((size_t)width * height * channels);
+    unsigned char* energy_map = malloc((size_t)width * height);
+    int* seam = malloc(height * sizeof(int));
+    memcpy(current, image_data, (size_t)width * height * channels);
+
+    for (int w = width; w > width - k; w--) {
+        if (forward) {
+            reference_forward_seam(current, w, height, channels, seam);
+        } else {
+            compute_energy_map_sequential(current, w, height, channels, energy_map);
+            reference_seam(energy_map, w, height, seam);
+        }
+        if (seams)
+            memcpy(seams + (size_t)(width - w) * height, seam, height * sizeof(int));
+        remove_seam_sequential(current, next, w, height, channels, seam);
+        unsigned char* previous = current;
+        current = next;
+        next = previous;
+    }
+
+    free(next);
+    free(energy_map);
+    free(seam);
+    return current;
+}
+
+// Carves a copy of the image through carve_seams and compares it with the reference carve
+static int carve_matches(const unsigned char* image_data, const unsigned char* expected, int width, int height, int channels, int k, const carve_options* options) {
+    unsigned char* carved = malloc((size_t)width * height * channels);
+    memcpy(carved, image_data, (size_t)width * height * channels);
+    int carved_width = width;
+    int matches = carve_seams(&carved, &carved_width, height, channels, k, options) == 0 && carved_width == width - k &&
+        memcmp(carved, expected, (size_t)carved_width * height * channels) == 0;
+    free(carved);
+    return matches;
+}
+
+// Path of a scratch file for the checks that go through PNG files; unique per process
+static void scratch_path(char* path, size_t size, const char* name) {
+    const char* directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/seam_diff_%ld_%s", directory && *directory ? directory : "/tmp", (long)getpid(), name);
+}
+
+static int report_mismatch(const char* check, const char* variant, int index, int width, int height, int channels) {
+    fprintf(stderr, "%s: %s differs in case %d, %dx%d with %d channels\n", check, variant, index, width, height, channels);
+    return 1;
+}
+
+// One engine carve under test: what carve options may depend on
+typedef struct {
+    int width;
+    int height;
+    const int* reference_seams;     // The seams of the reference carve, seam i at [i * height]
+} carve_case;
+
+static const char* const carve_variants[] = { "sequential carve", "parallel carve", "lazy sequential carve", "lazy parallel carve" };
+
+// Carves random images through carve_seams, eagerly and lazily in both modes, with the options configure sets
+// (if any), and compares every result with the reference carve (of forward energy if asked) and the seams logged in
+// seam_history with the reference's seams
+static int check_engine_carves(const char* check, int cases, int forward, void (*configure)(carve_options* options, const carve_case* carve)) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        width = width < 2 ? 2 : width > DIFF_MAX_WIDTH ? DIFF_MAX_WIDTH : width;
+        int channels = random_channels();
+        int k = 1 + random_below(width - 1 < 12 ? width - 1 : 12);
+        unsigned char* image = malloc((size_t)width * height * channels);
+        int* expected_seams = malloc((size_t)k * height * sizeof(int));
+        int* history = malloc((size_t)k * height * sizeof(int));
+        fill_random(image, (size_t)width * height * channels);
+        unsigned char* expected = reference_carve(image, width, height, channels, k, forward, expected_seams);
+        carve_case carve = { width, height, expected_seams };
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int variant = 0; variant < 4 && failures == 0; variant++) {
+            carve_options options;
+            carve_options_init(&options, variant & 1 ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+            options.lazy_removal = variant >= 2;
+            options.forward_energy = forward;
+            options.seam_history = history;
+            if (configure)
+                configure(&options, &carve);
+            if (!carve_matches(image, expected, width, height, channels, k, &options) ||
+                memcmp(history, expected_seams, (size_t)k * height * sizeof(int)) != 0)
+                failures += report_mismatch(check, carve_variants[variant], i, width, height, channels);
+        }
+
+        free(image);
+        free(expected_seams);
+        free(history);
+        free(expected);
+    }
+    return failures;
+}
+
+// compute_seam_* and the table-plus-trace pair of both back ends against the reference, at several team sizes
+static int check_seam(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* energy_map = malloc(cells);
+        int* dp = malloc(cells * sizeof(int));
+        signed char* backtrack = malloc(cells);
+        int* expected = malloc(height * sizeof(int));
+        int* seam = malloc(height * sizeof(int));
+        fill_random(energy_map, cells);
+        reference_seam(energy_map, width, height, expected);
+
+        size_t seam_bytes = height * sizeof(int);
+        if (compute_seam_sequential(energy_map, width, height, seam) != 0 || memcmp(seam, expected, seam_bytes) != 0)
+            failures += report_mismatch("seam", "compute_seam_sequential", i, width, height, 1);
+        compute_seam_table_sequential(energy_map, width, height, dp, backtrack);
+        trace_seam_sequential(dp, backtrack, width, height, seam);
+        if (memcmp(seam, expected, seam_bytes) != 0)
+            failures += report_mismatch("seam", "table + trace_seam_sequential", i, width, height, 1);
+
+        for (int t = 0; t < DIFF_THREAD_COUNTS && failures == 0; t++) {
+            omp_set_num_threads(thread_counts[t]);
+            if (compute_seam_parallel(energy_map, width, height, seam) != 0 || memcmp(seam, expected, seam_bytes) != 0)
+                failures += report_mismatch("seam", "compute_seam_parallel", i, width, height, 1);
+            compute_seam_table_parallel(energy_map, width, height, dp, backtrack);
+            trace_seam_parallel(dp, backtrack, width, height, seam);
+            if (memcmp(seam, expected, seam_bytes) != 0)
+                failures += report_mismatch("seam", "table + trace_seam_parallel", i, width, height, 1);
+        }
+
+        free(energy_map);
+        free(dp);
+        free(backtrack);
+        free(expected);
+        free(seam);
+    }
+    return failures;
+}
+
+// k incremental energy updates of both back ends, each compared with a full recompute of the carved image;
+// the seams are the cheapest ones or random connected ones
+static int check_energy_update(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        if (width < 2)
+            width = 2;
+        int channels = random_channels();
+        int k = 1 + random_below(width - 1 < 8 ? width - 1 : 8);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* image = malloc(cells * channels);
+        unsigned char* carved = malloc(cells * channels);
+        unsigned char* sequential = malloc(cells);
+        unsigned char* parallel = malloc(cells);
+        unsigned char* parallel_scratch = malloc(cells);
+        unsigned char* expected = malloc(cells);
+        int* seam = malloc(height * sizeof(int));
+        fill_random(image, cells * channels);
+        compute_energy_map_sequential(image, width, height, channels, sequential);
+        memcpy(parallel, sequential, cells);
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int w = width; w > width - k && failures == 0; w--) {
+            if (random_below(2))
+                reference_seam(sequential, w, height, seam);
+            else
+                random_seam(w, height, seam);
+
+            remove_seam_sequential(image, carved, w, height, channels, seam);
+            memcpy(image, carved, (size_t)(w - 1) * height * channels);
+            update_energy_map_sequential(image, w - 1, height, channels, seam, sequential, sequential);
+            update_energy_map_parallel(image, w - 1, height, channels, seam, parallel, parallel_scratch);
+            memcpy(parallel, parallel_scratch, (size_t)(w - 1) * height);
+
+            size_t updated = (size_t)(w - 1) * height;
+            compute_energy_map_sequential(image, w - 1, height, channels, expected);
+            if (memcmp(sequential, expected, updated) != 0)
+                failures += report_mismatch("energy_update", "update_energy_map_sequential", i, w - 1, height, channels);
+            else if (memcmp(parallel, expected, updated) != 0)
+                failures += report_mismatch("energy_update", "update_energy_map_parallel", i, w - 1, height, channels);
+            compute_energy_map_parallel(image, w - 1, height, channels, expected);
+            if (failures == 0 && memcmp(sequential, expected, updated) != 0)
+                failures += report_mismatch("energy_update", "compute_energy_map_parallel", i, w - 1, height, channels);
+        }
+
+        free(image);
+        free(carved);
+        free(sequential);
+        free(parallel);
+        free(parallel_scratch);
+        free(expected);
+        free(seam);
+    }
+    return failures;
+}
+
+// Shifted-and-refreshed seam tables of both back ends against a full rebuild after every removal: the costs,
+// the steps and the seam traced from them
+static int check_table_refresh(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        if (width < 2)
+            width = 2;
+        int channels = random_channels();
+        int k = 1 + random_below(width - 1 < 8 ? width - 1 : 8);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* image = malloc(cells * channels);
+        unsigned char* carved = malloc(cells * channels);
+        unsigned char* energy_map = malloc(cells);
+        int* dp[2] = { malloc(cells * sizeof(int)), malloc(cells * sizeof(int)) };
+        signed char* backtrack[2] = { malloc(cells), malloc(cells) };
+        int* parallel_dp = malloc(cells * sizeof(int));
+        signed char* parallel_backtrack = malloc(cells);
+        int* expected_dp = malloc(cells * sizeof(int));
+        signed char* expected_backtrack = malloc(cells);
+        int* seam = malloc(height * sizeof(int));
+        int* expected = malloc(height * sizeof(int));
+        fill_random(image, cells * channels);
+        compute_energy_map_sequential(image, width, height, channels, energy_map);
+        compute_seam_table_sequential(energy_map, width, height, dp[0], backtrack[0]);
+        memcpy(dp[1], dp[0], cells * sizeof(int));
+        memcpy(backtrack[1], backtrack[0], cells);
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int w = width; w > width - k && failures == 0; w--) {
+            if (random_below(4))
+                trace_seam_sequential(dp[0], backtrack[0], w, height, seam);
+            else
+                random_seam(w, height, seam);
+
+            remove_seam_sequential(image, carved, w, height, channels, seam);
+            memcpy(image, carved, (size_t)(w - 1) * height * channels);
+            compute_energy_map_sequential(image, w - 1, height, channels, energy_map);
+            update_seam_table_sequential(energy_map, w - 1, height, seam, dp[0], backtrack[0], dp[0], backtrack[0]);
+            update_seam_table_parallel(energy_map, w - 1, height, seam, dp[1], backtrack[1], parallel_dp, parallel_backtrack);
+            memcpy(dp[1], parallel_dp, (size_t)(w - 1) * height * sizeof(int));
+            memcpy(backtrack[1], parallel_backtrack, (size_t)(w - 1) * height);
+
+            size_t updated = (size_t)(w - 1) * height;
+            compute_seam_table_sequential(energy_map, w - 1, height, expected_dp, expected_backtrack);
+            reference_seam(energy_map, w - 1, height, expected);
+            for (int b = 0; b < 2 && failures == 0; b++) {
+                const char* variant = b == 0 ? "update_seam_table_sequential" : "update_seam_table_parallel";
+                trace_seam_sequential(dp[b], backtrack[b], w - 1, height, seam);
+                if (memcmp(dp[b], expected_dp, updated * sizeof(int)) != 0 || memcmp(backtrack[b], expected_backtrack, updated) != 0 ||
+                    memcmp(seam, expected, height * sizeof(int)) != 0)
+                    failures += report_mismatch("table_refresh", variant, i, w - 1, height, channels);
+            }
+        }
+
+        free(image);
+        free(carved);
+        free(energy_map);
+        for (int b = 0; b < 2; b++) {
+            free(dp[b]);
+            free(backtrack[b]);
+        }
+        free(parallel_dp);
+        free(parallel_backtrack);
+        free(expected_dp);
+        free(expected_backtrack);
+        free(seam);
+        free(expected);
+    }
+    return failures;
+}
+
+// A rolling-row seam search under test and the reference it must agree with. The input is an image of
+// `channels` channels, or an energy map when reads_image is 0.
+typedef void (*rolling_search_fn)(unsigned char* input, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam);
+
+typedef struct {
+    int reads_image;
+    const char* sequential_name;
+    rolling_search_fn sequential;
+    const char* parallel_name;
+    rolling_search_fn parallel;
+    void (*reference)(const unsigned char* input, int width, int height, int channels, int* seam);
+} rolling_search;
+
+// Runs both back ends of a rolling-row search on random inputs, including the sizes their packing and blocking
+// make awkward (one to three columns, widths that are not a multiple of four, one row). The cost rows are poisoned
+// before every run so that a column or row a kernel skips cannot inherit the previous run's result.
+static int check_rolling_search(const char* check, int cases, const rolling_search* search) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        if (i % 4 == 1)
+            width = 1 + random_below(3);
+        else if (i % 4 == 2)
+            height = 1;
+        else if (i % 4 == 3 && width % 4 == 0)
+            width += 1 + random_below(3);
+        int channels = search->reads_image ? random_channels() : 1;
+        size_t cells = (size_t)width * height;
+        size_t cost_bytes = 2 * (size_t)width * sizeof(uint32_t);
+
+        unsigned char* input = malloc(cells * channels);
+        uint32_t* cost_rows = malloc(cost_bytes);
+        unsigned char* steps = malloc((size_t)height * SEAM_STEP_ROW_BYTES(width));
+        int* expected = malloc(height * sizeof(int));
+        int* seam = malloc(height * sizeof(int));
+        fill_random(input, cells * channels);
+        search->reference(input, width, height, channels, expected);
+
+        memset(cost_rows, 0xA5, cost_bytes);
+        search->sequential(input, width, height, channels, cost_rows, steps, seam);
+        if (memcmp(seam, expected, height * sizeof(int)) != 0)
+            failures += report_mismatch(check, search->sequential_name, i, width, height, channels);
+        for (int t = 0; t < DIFF_THREAD_COUNTS && failures == 0; t++) {
+            memset(cost_rows, 0xA5, cost_bytes);
+            omp_set_num_threads(thread_counts[t]);
+            search->parallel(input, width, height, channels, cost_rows, steps, seam);
+            if (memcmp(seam, expected, height * sizeof(int)) != 0)
+                failures += report_mismatch(check, search->parallel_name, i, width, height, channels);
+        }
+
+        free(input);
+        free(cost_rows);
+        free(steps);
+        free(expected);
+        free(seam);
+    }
+    return failures;
+}
+
+static void reference_map_seam(const unsigned char* energy_map, int width, int height, int channels, int* seam) {
+    (void)channels;
+    reference_seam(energy_map, width, height, seam);
+}
+
+static void reference_image_seam(const unsigned char* image_data, int width, int height, int channels, int* seam) {
+    unsigned char* energy_map = malloc((size_t)width * height);
+    compute_energy_map_sequential((unsigned char*)image_data, width, height, channels, energy_map);
+    reference_seam(energy_map, width, height, seam);
+    free(energy_map);
+}
+
+static void compact_sequential(unsigned char* energy_map, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    (void)channels;
+    compute_seam_compact_sequential(energy_map, width, height, cost_rows, steps, seam);
+}
+
+static void compact_parallel(unsigned char* energy_map, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    (void)channels;
+    compute_seam_compact_parallel(energy_map, width, height, cost_rows, steps, seam);
+}
+
+// The fused searches get a poisoned energy row of their own on every run
+static void fused_sequential(unsigned char* image_data, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    unsigned char* energy_row = malloc(width);
+    memset(energy_row, 0xA5, width);
+    compute_seam_fused_sequential(image_data, width, height, channels, energy_row, cost_rows, steps, seam);
+    free(energy_row);
+}
+
+static void fused_parallel(unsigned char* image_data, int width, int height, int channels, uint32_t* cost_rows, unsigned char* steps, int* seam) {
+    unsigned char* energy_row = malloc(width);
+    memset(energy_row, 0xA5, width);
+    compute_seam_fused_parallel(image_data, width, height, channels, energy_row, cost_rows, steps, seam);
+    free(energy_row);
+}
+
+static const rolling_search compact_search = {
+    0, "compute_seam_compact_sequential", compact_sequential, "compute_seam_compact_parallel", compact_parallel, reference_map_seam,
+};
+
+static const rolling_search fused_search = {
+    1, "compute_seam_fused_sequential", fused_sequential, "compute_seam_fused_parallel", fused_parallel, reference_image_seam,
+};
+
+static const rolling_search forward_search = {
+    1, "compute_seam_forward_sequential", compute_seam_forward_sequential, "compute_seam_forward_parallel", compute_seam_forward_parallel,
+    reference_forward_seam,
+};
+
+static void use_rolling_rows(carve_options* options, const carve_case* carve) {
+    (void)carve;
+    options->incremental_seams = 0;
+}
+
+// The rolling-row search against the reference, then whole carves with the DP table and with the rolling rows
+static int check_compact(int cases) {
+    int failures = check_rolling_search("compact", cases, &compact_search);
+    if (failures == 0)
+        failures += check_engine_carves("compact", cases / 8, 0, NULL);
+    if (failures == 0)
+        failures += check_engine_carves("compact", cases / 8, 0, use_rolling_rows);
+    return failures;
+}
+
+// Carves one copy eagerly and one lazily with the same options; both the pixels and the seam logs must agree
+static int lazy_matches(const unsigned char* image_data, int width, int height, int channels, int k, carve_options* options) {
+    size_t bytes = (size_t)width * height * channels;
+    unsigned char* carved[2] = { malloc(bytes), malloc(bytes) };
+    int carved_width[2] = { width, width };
+    seam_log logs[2];
+    int status[2];
+    for (int lazy = 0; lazy < 2; lazy++) {
+        memcpy(carved[lazy], image_data, bytes);
+        seam_log_init(&logs[lazy]);
+        options->lazy_removal = lazy;
+        options->recorded_seams = &logs[lazy];
+        status[lazy] = carve_seams(&carved[lazy], &carved_width[lazy], height, channels, k, options);
+    }
+    options->recorded_seams = NULL;
+
+    int matches = status[0] == 0 && status[1] == 0 && carved_width[0] == width - k && carved_width[1] == width - k &&
+        memcmp(carved[0], carved[1], (size_t)(width - k) * height * channels) == 0 &&
+        logs[0].seam_count == k && logs[1].seam_count == k && logs[0].pixel_count == logs[1].pixel_count &&
+        memcmp(logs[0].pixels, logs[1].pixels, logs[0].pixel_count * sizeof(int)) == 0;
+    for (int lazy = 0; lazy < 2; lazy++) {
+        free(carved[lazy]);
+        seam_log_free(&logs[lazy]);
+    }
+    return matches;
+}
+
+static int check_lazy(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases / 2 && failures == 0; i++) {
+        int width = 48 + random_below(33);
+        int height = 1 + random_below(DIFF_MAX_HEIGHT);
+        int channels = 2 + random_below(3);
+        int k = 1 + random_below(24);
+        unsigned char* image = malloc((size_t)width * height * channels);
+        fill_random(image, (size_t)width * height * channels);
+        unsigned char* expected = reference_carve(image, width, height, channels, k, 0, NULL);
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int variant = 0; variant < 8 && failures == 0; variant++) {
+            carve_options options;
+            carve_options_init(&options, variant & 1 ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+            options.seams_per_pass = variant & 2 ? 8 : 1;
+            options.incremental_seams = !(variant & 4);
+            const char* name = variant & 2 ? "lazy carve, 8 seams per pass" : variant & 4 ? "lazy carve in rolling rows" : "lazy carve with the DP table";
+            // Several seams per pass are not exact, so those only have to agree with the eager carve
+            if (!(variant & 2)) {
+                options.lazy_removal = 1;
+                if (!carve_matches(image, expected, width, height, channels, k, &options)) {
+                    failures += report_mismatch("lazy", name, i, width, height, channels);
+                    break;
+                }
+            }
+            if (!lazy_matches(image, width, height, channels, k, &options))
+                failures += report_mismatch("lazy", name, i, width, height, channels);
+        }
+
+        free(image);
+        free(expected);
+    }
+    return failures;
+}
+
+// A band as wide as the image makes the pyramid search exact
+static void use_full_pyramid_band(carve_options* options, const carve_case* carve) {
+    options->pyramid_levels = 1 + random_below(4);
+    options->pyramid_band = carve->width;
+}
+
+// With a band as wide as the map the pyramid search is exact and must return the reference seam; with narrow
+// bands it must still return a connected seam, the same one on both back ends, and never beat the optimum
+static int check_pyramid(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        int levels = 1 + random_below(4);
+        int exact = i % 2 == 0;
+        int band = exact ? width : 1 + random_below(8);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* energy_map = malloc(cells);
+        size_t workspace_bytes = seam_pyramid_bytes(width, height, levels, band);
+        void* workspace = malloc(workspace_bytes);
+        int* expected = malloc(height * sizeof(int));
+        int* seam = malloc(height * sizeof(int));
+        int* parallel_seam = malloc(height * sizeof(int));
+        fill_random(energy_map, cells);
+        reference_seam(energy_map, width, height, expected);
+
+        compute_seam_pyramid_sequential(energy_map, width, height, levels, band, workspace, seam);
+        if (exact ? memcmp(seam, expected, height * sizeof(int)) != 0
+                  : !seam_is_connected(seam, width, height) || seam_cost(energy_map, width, height, seam) < seam_cost(energy_map, width, height, expected))
+            failures += report_mismatch("pyramid", exact ? "compute_seam_pyramid_sequential with a full band" : "compute_seam_pyramid_sequential", i, width, height, 1);
+        for (int t = 0; t < DIFF_THREAD_COUNTS && failures == 0; t++) {
+            // Stale levels of the previous run must not hide a row the parallel build skips
+            memset(workspace, 0xA5, workspace_bytes);
+            omp_set_num_threads(thread_counts[t]);
+            compute_seam_pyramid_parallel(energy_map, width, height, levels, band, workspace, parallel_seam);
+            if (memcmp(parallel_seam, seam, height * sizeof(int)) != 0)
+                failures += report_mismatch("pyramid", "compute_seam_pyramid_parallel", i, width, height, 1);
+        }
+
+        free(energy_map);
+        free(workspace);
+        free(expected);
+        free(seam);
+        free(parallel_seam);
+    }
+
+    if (failures == 0)
+        failures += check_engine_carves("pyramid", cases / 4, 0, use_full_pyramid_band);
+    return failures;
+}
+
+static void use_fused_energy(carve_options* options, const carve_case* carve) {
+    (void)carve;
+    options->incremental_seams = 0;
+    options->fused_energy = 1;
+}
+
+// The fused search computes each energy row itself and must find the seam of the full energy map; engine carves
+// with fused energy must match the reference carve
+static int check_fused(int cases) {
+    int failures = check_rolling_search("fused", cases, &fused_search);
+    if (failures == 0)
+        failures += check_engine_carves("fused", cases / 4, 0, use_fused_energy);
+    return failures;
+}
+
+// The forward-energy search against the full-table forward reference; engine carves with forward energy against
+// the reference carve that uses it
+static int check_forward(int cases) {
+    int failures = check_rolling_search("forward", cases, &forward_search);
+    if (failures == 0)
+        failures += check_engine_carves("forward", cases / 4, 1, NULL);
+    return failures;
+}
+
+// Guiding each seam by the one the reference removed must find that seam again, however narrow the band
+static void use_reference_guide(carve_options* options, const carve_case* carve) {
+    options->seam_prior = carve->reference_seams;
+    options->prior_band = 1 + random_below(4);
+}
+
+// The guided search is the exact DP restricted to the band around the guide: a band covering the map gives the
+// reference seam, a narrow one the brute-force banded optimum; engine carves follow in check_engine_carves.
+static int check_guided(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        int band = i % 2 == 0 ? width : 1 + random_below(6);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* energy_map = malloc(cells);
+        void* workspace = malloc(seam_guided_bytes(height, band));
+        int* guide = malloc(height * sizeof(int));
+        int* expected = malloc(height * sizeof(int));
+        int* seam = malloc(height * sizeof(int));
+        fill_random(energy_map, cells);
+        random_seam(width, height, guide);
+        reference_banded_seam(energy_map, width, height, guide, band, expected);
+
+        compute_seam_guided(energy_map, width, height, guide, band, workspace, seam);
+        int inside = 1;
+        for (int y = 0; y < height; y++)
+            inside = inside && abs(seam[y] - guide[y]) <= band;
+        if (!seam_is_connected(seam, width, height) || !inside || memcmp(seam, expected, height * sizeof(int)) != 0)
+            failures += report_mismatch("guided", band == width ? "compute_seam_guided with a full band" : "compute_seam_guided", i, width, height, 1);
+
+        free(energy_map);
+        free(workspace);
+        free(guide);
+        free(expected);
+        free(seam);
+    }
+
+    if (failures == 0)
+        failures += check_engine_carves("guided", cases / 4, 0, use_reference_guide);
+    return failures;
+}
+
+// Multi-seam extraction from one table: the seams must be disjoint in every row and connected, the first one the
+// reference seam. Removing them all at once, past the on-stack column limit too, must drop exactly their pixels.
+static int check_find_seams(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        int channels = random_channels();
+        int k = 1 + random_below(width < 2 * SEAM_COLUMNS_ON_STACK ? width : 2 * SEAM_COLUMNS_ON_STACK);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* energy_map = malloc(cells);
+        unsigned char* image = malloc(cells * channels);
+        int* dp = malloc(cells * sizeof(int));
+        signed char* backtrack = malloc(cells);
+        unsigned char* used = malloc(cells);
+        seam_start* order = malloc(width * sizeof(seam_start));
+        int* seams = malloc((size_t)k * height * sizeof(int));
+        int* expected = malloc(height * sizeof(int));
+        unsigned char* taken = calloc(cells, 1);
+        unsigned char* kept = malloc(cells * channels);
+        unsigned char* carved = malloc(cells * channels);
+        fill_random(energy_map, cells);
+        fill_random(image, cells * channels);
+        reference_seam(energy_map, width, height, expected);
+
+        compute_seam_table_sequential(energy_map, width, height, dp, backtrack);
+        int found = find_seams_sequential(dp, backtrack, width, height, k, seams, used, order);
+        int valid = found >= 1 && found <= k && memcmp(seams, expected, height * sizeof(int)) == 0;
+        for (int s = 0; s < found && valid; s++) {
+            const int* seam = seams + (size_t)s * height;
+            valid = seam_is_connected(seam, width, height);
+            for (int y = 0; y < height && valid; y++) {
+                unsigned char* pixel = taken + (size_t)y * width + seam[y];
+                valid = !*pixel;
+                *pixel = 1;
+            }
+        }
+        if (!valid)
+            failures += report_mismatch("find_seams", "find_seams_sequential", i, width, height, 1);
+
+        // What survives the removal: every pixel no seam took, in order
+        size_t kept_bytes = 0;
+        for (size_t p = 0; p < cells && failures == 0; p++) {
+            if (!taken[p]) {
+                memcpy(kept + kept_bytes, image + p * channels, channels);
+                kept_bytes += channels;
+            }
+        }
+
+        if (failures == 0 && (remove_seams_sequential(image, carved, width, height, channels, seams, found) != 0 ||
+                              memcmp(carved, kept, kept_bytes) != 0))
+            failures += report_mismatch("find_seams", "remove_seams_sequential", i, width, height, channels);
+        for (int t = 0; t < DIFF_THREAD_COUNTS && failures == 0; t++) {
+            omp_set_num_threads(thread_counts[t]);
+            if (remove_seams_parallel(image, carved, width, height, channels, seams, found) != 0 ||
+                memcmp(carved, kept, kept_bytes) != 0)
+                failures += report_mismatch("find_seams", "remove_seams_parallel", i, width, height, channels);
+        }
+
+        free(energy_map);
+        free(image);
+        free(dp);
+        free(backtrack);
+        free(used);
+        free(order);
+        free(seams);
+        free(expected);
+        free(taken);
+        free(kept);
+        free(carved);
+    }
+    return failures;
+}
+
+// Carves with a seam log in every engine variant: the log must hold the reference seams in removal order, mapped
+// to the input's pixel indices, and write_seam_overlay must repaint exactly those pixels, seam s with the colour
+// of its place in that order, and leave every other one untouched
+static int check_overlay(int cases) {
+    char path[512];
+    scratch_path(path, sizeof(path), "overlay.png");
+
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        width = width < 2 ? 2 : width > DIFF_MAX_WIDTH ? DIFF_MAX_WIDTH : width;
+        int channels = random_channels();
+        int k = 1 + random_below(width - 1 < 12 ? width - 1 : 12);
+        size_t cells = (size_t)width * height;
+
+        unsigned char* image = malloc(cells * channels);
+        int* reference_seams = malloc((size_t)k * height * sizeof(int));
+        int* origin = malloc(cells * sizeof(int));
+        int* expected = malloc((size_t)k * height * sizeof(int));
+        int* painted = malloc(cells * sizeof(int));
+        fill_random(image, cells * channels);
+        free(reference_carve(image, width, height, channels, k, 0, reference_seams));
+
+        // Follow every pixel's original index through the reference removals
+        for (size_t p = 0; p < cells; p++) {
+            origin[p] = (int)p;
+            painted[p] = -1;
+        }
+        for (int s = 0; s < k; s++) {
+            const int* seam = reference_seams + (size_t)s * height;
+            for (int y = 0; y < height; y++) {
+                int pixel = origin[(size_t)y * (width - s) + seam[y]];
+                expected[(size_t)s * height + y] = pixel;
+                painted[pixel] = s;
+            }
+            remove_seam_sequential((unsigned char*)origin, (unsigned char*)origin, width - s, height, sizeof(int), (int*)seam);
+        }
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int variant = 0; variant < 4 && failures == 0; variant++) {
+            seam_log log;
+            seam_log_init(&log);
+            carve_options options;
+            carve_options_init(&options, variant & 1 ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+            options.lazy_removal = variant >= 2;
+            options.recorded_seams = &log;
+
+            unsigned char* carved = malloc(cells * channels);
+            memcpy(carved, image, cells * channels);
+            int carved_width = width;
+            int logged = carve_seams(&carved, &carved_width, height, channels, k, &options) == 0 && log.seam_count == k &&
+                log.pixel_count == (size_t)k * height && memcmp(log.pixels, expected, (size_t)k * height * sizeof(int)) == 0;
+            for (int s = 0; s <= k && logged; s++)
+                logged = log.offsets[s] == (size_t)s * height;
+            if (!logged)
+                failures += report_mismatch("overlay", carve_variants[variant], i, width, height, channels);
+
+            int overlay_width = 0, overlay_height = 0, overlay_channels = 0;
+            unsigned char* overlay = NULL;
+            if (failures == 0) {
+                write_seam_overlay(path, image, width, height, channels, &log);
+                overlay = read_png_sequential(path, &overlay_width, &overlay_height, &overlay_channels);
+            }
+            int matches = overlay && overlay_width == width && overlay_height == height && overlay_channels == channels;
+            for (size_t p = 0; p < cells && matches; p++) {
+                const unsigned char* pixel = overlay + p * channels;
+                const unsigned char* source = image + p * channels;
+                if (painted[p] < 0) {
+                    matches = memcmp(pixel, source, channels) == 0;
+                    continue;
+                }
+                // Red to yellow on colour images, channel 0 alone on gray ones; alpha stays as it was
+                unsigned char green = k > 1 ? (unsigned char)(255 * painted[p] / (k - 1)) : 0;
+                int colour_channels = channels >= 3 ? 3 : 1;
+                matches = pixel[0] == 255 && (colour_channels == 1 || (pixel[1] == green && pixel[2] == 0)) &&
+                    memcmp(pixel + colour_channels, source + colour_channels, channels - colour_channels) == 0;
+            }
+            if (failures == 0 && !matches)
+                failures += report_mismatch("overlay", "write_seam_overlay", i, width, height, channels);
+
+            free(overlay);
+            free(carved);
+            seam_log_free(&log);
+        }
+
+        free(image);
+        free(reference_seams);
+        free(origin);
+        free(expected);
+        free(painted);
+    }
+
+    remove(path);
+    return failures;
+}
+
+// Writes the image through one of the PNG writers: 0 write_png_with_settings with random settings,
+// 1 write_png_sequential, 2 write_png_parallel, 3 the row-streaming encoder in random chunks
+static int write_png_variant(int variant, const char* path, unsigned char* image_data, int width, int height, int channels) {
+    png_write_settings settings;
+    png_write_settings_init(&settings);
+    settings.compression_level = random_below(11) - 1;
+    settings.filters = random_below(2) ? -1 : random_below(2) ? PNG_FILTER_NONE : PNG_ALL_FILTERS;
+
+    switch (variant) {
+    case 0:
+        return write_png_with_settings(path, image_data, width, height, channels, &settings);
+    case 1:
+        write_png_sequential(path, image_data, width, height, channels);
+        return 0;
+    case 2:
+        write_png_parallel(path, image_data, width, height, channels);
+        return 0;
+    default: {
+        stream_encoder encoder;
+        if (stream_encoder_open(&encoder, path, width, height, channels, &settings) != 0)
+            return -1;
+        int status = 0;
+        for (int y = 0; y < height && status == 0;) {
+            int count = 1 + random_below(height - y);
+            status = stream_encoder_write_rows(&encoder, image_data + (size_t)y * width * channels, count);
+            y += count;
+        }
+        return stream_encoder_close(&encoder, status);
+    }
+    }
+}
+
+static const char* const png_writers[] = { "write_png_with_settings", "write_png_sequential", "write_png_parallel", "stream_encoder" };
+
+// Every PNG writer and reader with 1 to 4 channels: whatever is written has to read back unchanged, size and
+// channel count included, through read_png_* and the row-streaming decoder alike
+static int check_png_round_trip(int cases) {
+    char path[512];
+    scratch_path(path, sizeof(path), "round_trip.png");
+
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        int channels = 1 + i % 4;
+        size_t image_bytes = (size_t)width * height * channels;
+        unsigned char* image = malloc(image_bytes);
+        fill_random(image, image_bytes);
+
+        int variant = random_below(4);
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        if (write_png_variant(variant, path, image, width, height, channels) != 0)
+            failures += report_mismatch("png_round_trip", png_writers[variant], i, width, height, channels);
+
+        for (int reader = 0; reader < 3 && failures == 0; reader++) {
+            int read_width = 0, read_height = 0, read_channels = 0;
+            unsigned char* read = NULL;
+            if (reader == 0) {
+                read = read_png_sequential(path, &read_width, &read_height, &read_channels);
+            } else if (reader == 1) {
+                read = read_png_parallel(path, &read_width, &read_height, &read_channels);
+            } else {
+                stream_decoder decoder;
+                if (stream_decoder_open(&decoder, path) == 0) {
+                    read_width = decoder.width;
+                    read_height = decoder.height;
+                    read_channels = decoder.channels;
+                    read = malloc(decoder.row_bytes * decoder.height);
+                    if (decoder.passes != 1 || stream_decoder_read_rows(&decoder, read, decoder.height) != 0) {
+                        free(read);
+                        read = NULL;
+                    }
+                    stream_decoder_close(&decoder);
+                }
+            }
+
+            static const char* const readers[] = { "read_png_sequential", "read_png_parallel", "stream_decoder" };
+            if (!read || read_width != width || read_height != height || read_channels != channels ||
+                memcmp(read, image, image_bytes) != 0) {
+                char pair[96];
+                snprintf(pair, sizeof(pair), "%s after %s", readers[reader], png_writers[variant]);
+                failures += report_mismatch("png_round_trip", pair, i, width, height, channels);
+            }
+            free(read);
+        }
+
+        free(image);
+    }
+
+    remove(path);
+    return failures;
+}
+
+// Adam7-interlaced PNG, which none of the repo's writers produce but the readers have to take
+static int write_interlaced_png(const char* path, unsigned char* image_data, int width, int height, int channels) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+        return -1;
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    png_bytep* rows = malloc(height * sizeof(png_bytep));
+    if (!info || !rows || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        free(rows);
+        fclose(fp);
+        return -1;
+    }
+
+    for (int y = 0; y < height; y++)
+        rows[y] = image_data + (size_t)y * width * channels;
+    png_init_io(png, fp);
+    png_set_IHDR(png, info, width, height, 8, png_color_type_for(channels), PNG_INTERLACE_ADAM7, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    png_set_interlace_handling(png);
+    png_write_image(png, rows);
+    png_write_end(png, NULL);
+
+    png_destroy_write_struct(&png, &info);
+    free(rows);
+    fclose(fp);
+    return 0;
+}
+
+static const char* const streaming_readers[] = {
+    "read_png_streaming_sequential", "read_png_streaming_parallel",
+    "read_png_memory_streaming_sequential", "read_png_memory_streaming_parallel",
+};
+
+// The streaming readers against read_png_sequential followed by compute_energy_map_sequential, on random images
+// with 1 to 4 channels, plain or interlaced, and on copies cut off at a random byte: they must decode the same
+// pixels and energy, and fail exactly when the plain reader does
+static int check_stream_read(int cases) {
+    char path[512];
+    scratch_path(path, sizeof(path), "stream.png");
+
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        int channels = 1 + i % 4;
+        size_t image_bytes = (size_t)width * height * channels;
+        unsigned char* image = malloc(image_bytes);
+        fill_random(image, image_bytes);
+
+        int interlaced = random_below(4) == 0;
+        int written = interlaced ? write_interlaced_png(path, image, width, height, channels)
+                                 : write_png_variant(random_below(4), path, image, width, height, channels);
+        if (written != 0)
+            failures += report_mismatch("stream_read", interlaced ? "interlaced writer" : "PNG writer", i, width, height, channels);
+
+        // Read the file back whole for the in-memory readers, and cut it short in one case out of four
+        unsigned char* file_data = NULL;
+        size_t file_size = 0;
+        FILE* fp = failures == 0 ? fopen(path, "rb") : NULL;
+        if (fp) {
+            fseek(fp, 0, SEEK_END);
+            file_size = (size_t)ftell(fp);
+            rewind(fp);
+            file_data = malloc(file_size);
+            if (fread(file_data, 1, file_size, fp) != file_size)
+                failures += report_mismatch("stream_read", "reading the file back", i, width, height, channels);
+            fclose(fp);
+        }
+        int truncated = random_below(4) == 0;
+        if (truncated && failures == 0) {
+            file_size = (size_t)random_below((int)file_size);
+            fp = fopen(path, "wb");
+            if (!fp || fwrite(file_data, 1, file_size, fp) != file_size)
+                failures += report_mismatch("stream_read", "truncating the file", i, width, height, channels);
+            if (fp)
+                fclose(fp);
+        }
+
+        int expected_width = 0, expected_height = 0, expected_channels = 0;
+        unsigned char* expected = failures == 0 ? read_png_sequential(path, &expected_width, &expected_height, &expected_channels) : NULL;
+        unsigned char* expected_energy = NULL;
+        if (expected) {
+            expected_energy = malloc((size_t)expected_width * expected_height);
+            compute_energy_map_sequential(expected, expected_width, expected_height, expected_channels, expected_energy);
+        }
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int reader = 0; reader < 4 && failures == 0; reader++) {
+            unsigned char* decoded = NULL;
+            unsigned char* energy = NULL;
+            int decoded_width = 0, decoded_height = 0, decoded_channels = 0;
+            int status;
+            switch (reader) {
+            case 0:
+                status = read_png_streaming_sequential(path, &decoded, &energy, &decoded_width, &decoded_height, &decoded_channels);
+                break;
+            case 1:
+                status = read_png_streaming_parallel(path, &decoded, &energy, &decoded_width, &decoded_height, &decoded_channels);
+                break;
+            case 2:
+                status = read_png_memory_streaming_sequential(file_data, file_size, &decoded, &energy, &decoded_width, &decoded_height, &decoded_channels);
+                break;
+            default:
+                status = read_png_memory_streaming_parallel(file_data, file_size, &decoded, &energy, &decoded_width, &decoded_height, &decoded_channels);
+                break;
+            }
+
+            int matches = expected ? status == 0 && decoded_width == expected_width && decoded_height == expected_height &&
+                                         decoded_channels == expected_channels &&
+                                         memcmp(decoded, expected, (size_t)expected_width * expected_height * expected_channels) == 0 &&
+                                         memcmp(energy, expected_energy, (size_t)expected_width * expected_height) == 0
+                                   : status != 0;
+            if (!matches)
+                failures += report_mismatch("stream_read", streaming_readers[reader], i, width, height, channels);
+            if (status == 0) {
+                free(decoded);
+                free(energy);
+            }
+        }
+
+        // Anything that survived the cut has to be the original image
+        if (expected && failures == 0 && (expected_width != width || expected_height != height ||
+                                          expected_channels != channels || memcmp(expected, image, image_bytes) != 0))
+            failures += report_mismatch("stream_read", "read_png_sequential", i, width, height, channels);
+
+        free(image);
+        free(file_data);
+        free(expected);
+        free(expected_energy);
+    }
+
+    remove(path);
+    return failures;
+}
+
+// Seam maps: a map built down to min_width must give the reference carve (or with other options the engine's)
+// at every width it covers through both retargeting passes, refuse the widths outside, and survive seam_map_write and seam_map_read unchanged;
+// a map only matches the pixels and options it was built from, and a cut-off file does not read.
+static int check_seam_map(int cases) {
+    char path[512];
+    scratch_path(path, sizeof(path), "map" SEAM_MAP_EXTENSION);
+
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        width = width > DIFF_MAX_WIDTH ? DIFF_MAX_WIDTH : width;
+        int channels = random_channels();
+        int seams = random_below(width < 24 ? width : 24);
+        size_t image_bytes = (size_t)width * height * channels;
+
+        unsigned char* image = malloc(image_bytes);
+        unsigned char* retargeted = malloc(image_bytes);
+        fill_random(image, image_bytes);
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        // Exact one-by-one seams, or options that find others and have to be recorded in the map
+        carve_options options;
+        carve_options_init(&options, i % 2 ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+        int exact = random_below(2);
+        if (!exact) {
+            options.seams_per_pass = random_below(2) ? 2 + random_below(3) : 1;
+            options.pyramid_levels = random_below(2) ? 1 + random_below(2) : 0;
+            options.pyramid_band = 1 + random_below(8);
+            options.forward_energy = random_below(2);
+        }
+        seam_map map, loaded;
+        map.order = loaded.order = NULL;
+        if (seam_map_build(&map, image, width, height, channels, width - seams, &options) != 0 || map.seams != seams ||
+            !seam_map_matches(&map, image, width, height, channels, &options))
+            failures += report_mismatch("seam_map", "seam_map_build", i, width, height, channels);
+
+        // A few covered widths, the two ends always among them
+        for (int n = 0; n < 4 && failures == 0; n++) {
+            int target_width = n == 0 ? width : n == 1 ? width - seams : width - random_below(seams + 1);
+            unsigned char* expected = exact ? reference_carve(image, width, height, channels, width - target_width, 0, NULL)
+                                            : malloc(image_bytes);
+            int carved_width = width;
+            if (!exact) {
+                memcpy(expected, image, image_bytes);
+                carve_seams(&expected, &carved_width, height, channels, width - target_width, &options);
+            }
+            size_t expected_bytes = (size_t)target_width * height * channels;
+            if (seam_map_retarget_sequential(&map, image, channels, target_width, retargeted) != 0 ||
+                memcmp(retargeted, expected, expected_bytes) != 0)
+                failures += report_mismatch("seam_map", "seam_map_retarget_sequential", i, width, height, channels);
+            else if (seam_map_retarget_parallel(&map, image, channels, target_width, retargeted) != 0 ||
+                     memcmp(retargeted, expected, expected_bytes) != 0)
+                failures += report_mismatch("seam_map", "seam_map_retarget_parallel", i, width, height, channels);
+            free(expected);
+        }
+        if (failures == 0 && (seam_map_retarget_sequential(&map, image, channels, width + 1, retargeted) == 0 ||
+                              seam_map_retarget_parallel(&map, image, channels, width - seams - 1, retargeted) == 0))
+            failures += report_mismatch("seam_map", "a width outside the map", i, width, height, channels);
+
+        if (failures == 0 && (seam_map_write(&map, path) != 0 || seam_map_read(&loaded, path) != 0 ||
+                              loaded.width != map.width || loaded.height != map.height || loaded.seams != map.seams ||
+                              loaded.channels != map.channels || loaded.source_hash != map.source_hash ||
+                              loaded.seams_per_pass != map.seams_per_pass || loaded.pyramid_levels != map.pyramid_levels ||
+                              loaded.pyramid_band != map.pyramid_band || loaded.forward_energy != map.forward_energy ||
+                              memcmp(loaded.order, map.order, (size_t)width * height * sizeof(uint16_t)) != 0))
+            failures += report_mismatch("seam_map", "seam_map_write + seam_map_read", i, width, height, channels);
+
+        // Other pixels or options that find other seams must not reuse the map
+        carve_options other = options;
+        other.seams_per_pass = 1;
+        other.forward_energy = !options.forward_energy;
+        int options_differ = seam_map_matches(&map, image, width, height, channels, &other);
+        image[random_below((int)image_bytes)] ^= 1 + random_below(255);
+        if (failures == 0 && (options_differ || seam_map_matches(&loaded, image, width, height, channels, &options)))
+            failures += report_mismatch("seam_map", "seam_map_matches", i, width, height, channels);
+
+        // Cut the file short, anywhere from the magic to the last entry
+        if (failures == 0) {
+            size_t file_size = 48 + (size_t)width * height * sizeof(uint16_t);
+            seam_map_free(&loaded);
+            if (truncate(path, (off_t)random_below((int)file_size)) != 0 || seam_map_read(&loaded, path) == 0)
+                failures += report_mismatch("seam_map", "seam_map_read of a cut-off file", i, width, height, channels);
+        }
+
+        seam_map_free(&map);
+        seam_map_free(&loaded);
+        free(image);
+        free(retargeted);
+    }
+
+    remove(path);
+    return failures;
+}
+
+// Transposed copy of an image, width x height becoming height x width
+static unsigned char* transposed_copy(const unsigned char* image_data, int width, int height, int channels) {
+    unsigned char* transposed = malloc((size_t)width * height * channels);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            memcpy(transposed + ((size_t)x * height + y) * channels, image_data + ((size_t)y * width + x) * channels, channels);
+    return transposed;
+}
+
+// Greedy two-direction carve the plain way: while both dimensions shrink, the energy and the cheapest seam of
+// the image and of its transpose are computed from scratch, and the seam with the lower mean cost per pixel
+// goes (the vertical one on ties); the rest is carved one seam at a time in the one direction left
+static unsigned char* reference_carve_to_size(const unsigned char* image_data, int width, int height, int channels, int target_width, int target_height) {
+    unsigned char* current = malloc((size_t)width * height * channels);
+    unsigned char* energy_map = malloc((size_t)width * height);
+    int* seam = malloc((width > height ? width : height) * sizeof(int));
+    int* row_seam = malloc((width > height ? width : height) * sizeof(int));
+    memcpy(current, image_data, (size_t)width * height * channels);
+
+    int w = width, h = height;
+    while (w > target_width && h > target_height) {
+        compute_energy_map_sequential(current, w, h, channels, energy_map);
+        reference_seam(energy_map, w, h, seam);
+        double column_cost = (double)seam_cost(energy_map, w, h, seam) / h;
+
+        unsigned char* transposed = transposed_copy(current, w, h, channels);
+        compute_energy_map_sequential(transposed, h, w, channels, energy_map);
+        reference_seam(energy_map, h, w, row_seam);
+        double row_cost = (double)seam_cost(energy_map, h, w, row_seam) / w;
+
+        if (row_cost < column_cost) {
+            remove_seam_sequential(transposed, transposed, h, w, channels, row_seam);
+            free(current);
+            current = transposed_copy(transposed, h - 1, w, channels);
+            h--;
+        } else {
+            remove_seam_sequential(current, current, w, h, channels, seam);
+            w--;
+        }
+        free(transposed);
+    }
+
+    unsigned char* carved;
+    if (h > target_height) {
+        unsigned char* transposed = transposed_copy(current, w, h, channels);
+        unsigned char* carved_transposed = reference_carve(transposed, h, w, channels, h - target_height, 0, NULL);
+        carved = transposed_copy(carved_transposed, target_height, w, channels);
+        free(transposed);
+        free(carved_transposed);
+    } else {
+        carved = reference_carve(current, w, h, channels, w - target_width, 0, NULL);
+    }
+
+    free(current);
+    free(energy_map);
+    free(seam);
+    free(row_seam);
+    return carved;
+}
+
+// carve_to_size in both modes: carving only rows must give the transpose of carve_seams on the transposed image,
+// carving only columns what carve_seams gives, and carving both ways the greedy reference
+static int check_carve_to_size(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width = 2 + random_below(95), height = 2 + random_below(63);
+        int channels = random_channels();
+        int shape = i % 3;
+        int target_width = shape == 0 ? width : width - 1 - random_below(width - 1 < 12 ? width - 1 : 12);
+        int target_height = shape == 1 ? height : height - 1 - random_below(height - 1 < 12 ? height - 1 : 12);
+        size_t image_bytes = (size_t)width * height * channels;
+        unsigned char* image = malloc(image_bytes);
+        fill_random(image, image_bytes);
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int variant = 0; variant < 2 && failures == 0; variant++) {
+            carve_options options;
+            carve_options_init(&options, variant ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+
+            // What each shape has to match
+            unsigned char* expected;
+            if (shape == 0) {
+                unsigned char* transposed = transposed_copy(image, width, height, channels);
+                int carved_width = height;
+                carve_seams(&transposed, &carved_width, width, channels, height - target_height, &options);
+                expected = transposed_copy(transposed, target_height, width, channels);
+                free(transposed);
+            } else if (shape == 1) {
+                expected = malloc(image_bytes);
+                memcpy(expected, image, image_bytes);
+                int carved_width = width;
+                carve_seams(&expected, &carved_width, height, channels, width - target_width, &options);
+            } else {
+                expected = reference_carve_to_size(image, width, height, channels, target_width, target_height);
+            }
+
+            unsigned char* carved = malloc(image_bytes);
+            memcpy(carved, image, image_bytes);
+            int carved_width = width, carved_height = height;
+            if (carve_to_size(&carved, &carved_width, &carved_height, channels, target_width, target_height, &options) != 0 ||
+                carved_width != target_width || carved_height != target_height ||
+                memcmp(carved, expected, (size_t)target_width * target_height * channels) != 0) {
+                static const char* const shapes[] = { "rows only", "columns only", "both directions" };
+                char name[64];
+                snprintf(name, sizeof(name), "%s carve_to_size, %s", variant ? "parallel" : "sequential", shapes[shape]);
+                failures += report_mismatch("carve_to_size", name, i, width, height, channels);
+            }
+
+            free(carved);
+            free(expected);
+        }
+        free(image);
+    }
+    return failures;
+}
+
+// enlarge_seams in both modes with a seam log, widening by up to half: the logged seams must be connected and
+// pairwise disjoint in the input's coordinates, the output width + k wide, holding every input pixel in order with each seam pixel followed
+// by its average with its right neighbour (itself at the border), and both modes must agree byte for byte
+static int check_enlarge(int cases) {
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        width = width < 2 ? 2 : width;
+        int channels = random_channels();
+        int k = 1 + random_below(width / 2 < 2 * SEAM_COLUMNS_ON_STACK ? width / 2 : 2 * SEAM_COLUMNS_ON_STACK);
+        size_t cells = (size_t)width * height;
+        size_t enlarged_bytes = (cells + (size_t)k * height) * channels;
+
+        unsigned char* image = malloc(cells * channels);
+        unsigned char* taken = malloc(cells);
+        int* seam = malloc(height * sizeof(int));
+        fill_random(image, cells * channels);
+
+        unsigned char* results[2] = { NULL, NULL };
+        seam_log logs[2];
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        for (int variant = 0; variant < 2 && failures == 0; variant++) {
+            const char* name = variant ? "parallel enlarge_seams" : "sequential enlarge_seams";
+            seam_log* log = &logs[variant];
+            seam_log_init(log);
+            carve_options options;
+            carve_options_init(&options, variant ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+            options.recorded_seams = log;
+
+            unsigned char* enlarged = malloc(cells * channels);
+            memcpy(enlarged, image, cells * channels);
+            int enlarged_width = width;
+            results[variant] = enlarged;
+            if (enlarge_seams(&results[variant], &enlarged_width, height, channels, k, &options) != 0 ||
+                enlarged_width != width + k || log->seam_count != k || log->pixel_count != (size_t)k * height) {
+                failures += report_mismatch("enlarge", name, i, width, height, channels);
+                break;
+            }
+            enlarged = results[variant];
+
+            memset(taken, 0, cells);
+            int valid = 1;
+            for (int s = 0; s < k && valid; s++) {
+                const int* pixels = log->pixels + log->offsets[s];
+                for (int y = 0; y < height && valid; y++) {
+                    valid = pixels[y] / width == y && !taken[pixels[y]];
+                    taken[pixels[y]] = 1;
+                    seam[y] = pixels[y] % width;
+                }
+                valid = valid && seam_is_connected(seam, width, height);
+            }
+            if (!valid) {
+                failures += report_mismatch("enlarge", name, i, width, height, channels);
+                break;
+            }
+
+            // Walk every row of the input alongside the output
+            const unsigned char* out = enlarged;
+            for (size_t p = 0; p < cells && valid; p++) {
+                const unsigned char* pixel = image + p * channels;
+                valid = memcmp(out, pixel, channels) == 0;
+                out += channels;
+                if (!taken[p])
+                    continue;
+                const unsigned char* right = (int)(p % width) + 1 < width ? pixel + channels : pixel;
+                for (int c = 0; c < channels && valid; c++)
+                    valid = out[c] == (pixel[c] + right[c]) / 2;
+                out += channels;
+            }
+            if (!valid)
+                failures += report_mismatch("enlarge", name, i, width, height, channels);
+        }
+
+        if (failures == 0 && (memcmp(results[0], results[1], enlarged_bytes) != 0 ||
+                              memcmp(logs[0].pixels, logs[1].pixels, (size_t)k * height * sizeof(int)) != 0))
+            failures += report_mismatch("enlarge", "parallel against sequential enlarge_seams", i, width, height, channels);
+
+        // The masked tables behind the search: the plain table with nothing taken, and the same in both modes
+        // with a random mask
+        int* dp = malloc(cells * sizeof(int));
+        int* masked_dp = malloc(cells * sizeof(int));
+        signed char* backtrack = malloc(cells);
+        signed char* masked_backtrack = malloc(cells);
+        unsigned char* energy_map = malloc(cells);
+        fill_random(energy_map, cells);
+        memset(taken, 0, cells);
+        compute_seam_table_sequential(energy_map, width, height, dp, backtrack);
+        compute_masked_seam_table_sequential(energy_map, taken, width, height, masked_dp, masked_backtrack);
+        if (failures == 0 && (memcmp(dp, masked_dp, cells * sizeof(int)) != 0 || memcmp(backtrack, masked_backtrack, cells) != 0))
+            failures += report_mismatch("enlarge", "compute_masked_seam_table_sequential with nothing taken", i, width, height, 1);
+        for (size_t p = 0; p < cells; p++)
+            taken[p] = random_below(4) == 0;
+        compute_masked_seam_table_sequential(energy_map, taken, width, height, dp, backtrack);
+        compute_masked_seam_table_parallel(energy_map, taken, width, height, masked_dp, masked_backtrack);
+        if (failures == 0 && (memcmp(dp, masked_dp, cells * sizeof(int)) != 0 || memcmp(backtrack, masked_backtrack, cells) != 0))
+            failures += report_mismatch("enlarge", "compute_masked_seam_table_parallel", i, width, height, 1);
+        free(dp);
+        free(masked_dp);
+        free(backtrack);
+        free(masked_backtrack);
+        free(energy_map);
+
+        for (int variant = 0; variant < 2; variant++) {
+            if (results[variant]) {
+                free(results[variant]);
+                seam_log_free(&logs[variant]);
+            }
+        }
+        free(image);
+        free(taken);
+        free(seam);
+    }
+    return failures;
+}
+
+// Memory budget under which every sweep of an out-of-core carve holds only `rows` rows at a time: the rows
+// plan_strips keeps come first, then rows of the widest sweep
+static size_t tiled_budget(int width, int height, int channels, int k, int rows) {
+    size_t fixed = TILED_RESERVED_BYTES + 2 * (size_t)width * sizeof(uint32_t) + width + 2 * (size_t)height * sizeof(int) + 2 * ((size_t)width + 1);
+    size_t search_row = (size_t)width + 1 + SEAM_STEP_ROW_BYTES(width);
+    size_t decode_row = (size_t)width * channels + (channels > 1 ? (size_t)width : 0);
+    size_t gather_row = channels > 1
+        ? (size_t)width * channels + (size_t)(width - k) * channels + ((size_t)k + 1) * sizeof(int) + (size_t)LAZY_BLOCKS(width) * (sizeof(uint64_t) + sizeof(int))
+        : (size_t)(width - k);
+    size_t widest = search_row > decode_row ? search_row : decode_row;
+    widest = gather_row > widest ? gather_row : widest;
+    return fixed + (size_t)rows * widest;
+}
+
+// Out-of-core carves: with a budget of a few rows, every sweep of carve_png_tiled walks the image in many strips,
+// and the PNG it writes has to hold the reference carve
+static int check_tiled(int cases) {
+    char input[512], output[512];
+    scratch_path(input, sizeof(input), "tiled_in.png");
+    scratch_path(output, sizeof(output), "tiled_out.png");
+    const char* directory = getenv("TMPDIR");
+
+    int failures = 0;
+    for (int i = 0; i < cases && failures == 0; i++) {
+        int width, height;
+        random_size(&width, &height);
+        width = width < 2 ? 2 : width;
+        height = 16 + height;
+        int channels = random_channels();
+        int k = 1 + random_below(width - 1 < 12 ? width - 1 : 12);
+        size_t image_bytes = (size_t)width * height * channels;
+        unsigned char* image = malloc(image_bytes);
+        fill_random(image, image_bytes);
+
+        int interlaced = random_below(4) == 0;
+        int written = interlaced ? write_interlaced_png(input, image, width, height, channels)
+                                 : write_png_variant(random_below(4), input, image, width, height, channels);
+        if (written != 0)
+            failures += report_mismatch("tiled", interlaced ? "interlaced writer" : "PNG writer", i, width, height, channels);
+
+        omp_set_num_threads(thread_counts[i % DIFF_THREAD_COUNTS]);
+        tiled_options options;
+        tiled_options_init(&options, i % 2 ? CARVE_MODE_PARALLEL : CARVE_MODE_SEQUENTIAL);
+        options.memory_budget = tiled_budget(width, height, channels, k, 2 + random_below(3));
+        options.scratch_dir = directory && *directory ? directory : "/tmp";
+
+        unsigned char* expected = reference_carve(image, width, height, channels, k, 0, NULL);
+        unsigned char* carved = NULL;
+        int carved_width = 0, carved_height = 0, carved_channels = 0;
+        if (failures == 0 && carve_png_tiled(input, output, 0, k, &options) == 0)
+            carved = read_png_sequential(output, &carved_width, &carved_height, &carved_channels);
+        if (failures == 0 && (!carved || carved_width != width - k || carved_height != height || carved_channels != channels ||
+                              memcmp(carved, expected, (size_t)carved_width * height * channels) != 0))
+            failures += report_mismatch("tiled", i % 2 ? "parallel carve_png_tiled" : "sequential carve_png_tiled", i, width, height, channels);
+
+        free(image);
+        free(expected);
+        free(carved);
+    }
+
+    remove(input);
+    remove(output);
+    return failures;
+}
+
+typedef struct {
+    const char* name;
+    int (*run)(int cases);
+} diff_check;
+
+static const diff_check checks[] = {
+    { "seam", check_seam },
+    { "find_seams", check_find_seams },
+    { "energy_update", check_energy_update },
+    { "table_refresh", check_table_refresh },
+    { "compact", check_compact },
+    { "lazy", check_lazy },
+    { "pyramid", check_pyramid },
+    { "fused", check_fused },
+    { "forward", check_forward },
+    { "guided", check_guided },
+    { "carve_to_size", check_carve_to_size },
+    { "enlarge", check_enlarge },
+    { "overlay", check_overlay },
+    { "png_round_trip", check_png_round_trip },
+    { "stream_read", check_stream_read },
+    { "seam_map", check_seam_map },
+    { "tiled", check_tiled },
+};
+#define DIFF_CHECK_COUNT ((int)(sizeof(checks) / sizeof(checks[0])))
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --cases N    random cases per check (default: %d)\n"
+        "  --seed S     seed of the random inputs (default: %d)\n"
+        "  --check NAME run only this check (default: all)\n"
+        "Checks:",
+        program, DIFF_DEFAULT_CASES, DIFF_DEFAULT_SEED);
+    for (int i = 0; i < DIFF_CHECK_COUNT; i++)
+        fprintf(stderr, " %s", checks[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv) {
+    int cases = DIFF_DEFAULT_CASES;
+    unsigned long long seed = DIFF_DEFAULT_SEED;
+    const char* only = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+
+        if (strcmp(arg, "--cases") == 0 && has_value)
+            cases = atoi(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && has_value)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--check") == 0 && has_value)
+            only = argv[++i];
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cases < 1 || seed == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("Vector kernel: %s\n", energy_kernel_name());
+    int failed = 0, ran = 0;
+    for (int i = 0; i < DIFF_CHECK_COUNT; i++) {
+        if (only && strcmp(only, checks[i].name) != 0)
+            continue;
+        rng_state = seed;
+        int failures = checks[i].run(cases);
+        printf("%-14s %s\n", checks[i].name, failures == 0 ? "ok" : "FAILED");
+        failed += failures != 0;
+        ran++;
+    }
+    if (ran == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (failed > 0)
+        printf("%d of %d checks failed with --seed %llu --cases %d\n", failed, ran, seed, cases);
+    return failed == 0 ? 0 : 1;
+}